@@ -22,6 +22,25 @@
 // by setting 'LOG_ENABLE' macro here. Using macros also make code more
 // clean and lessen the burden of user to keep function arguments in 
 // right order.
+//
+// Every macro logs the arguments of a libhdfs call by their usual
+// names, e.g. LOG_READ() logs fs, file, position, buf and length, and
+// every call has a LOG_*_RET(ret) logging what it returned: the file
+// for open, the file info (0 if none) for getfileinfo, the number of
+// entries for listdir (-1 on error), and the usual return otherwise.
+//
+// The logger also counts what it costs the process and saves it to a
+// stats file next to the log, which tstat reads (see LoggerStats.h).
+// With LOG_CAPTURE it also records the thread's CPU time and context
+// switches with every record, so the time of a call can be split into
+// work on CPU and waiting. Each costs a system call per record.
+//
+// Logger::SITES in LOG_CAPTURE records where every LOG_SITE_SAMPLING-th
+// open or read of a thread came from, so treader -s can add up bytes
+// and latency by call site. The site is the stack of the call, hashed,
+// or a tag the application set for the thread with LOG_TAG(), which is
+// cheaper. Frames are symbolized once per site, and need the traced
+// program linked with -rdynamic to show function names.
 
 #ifndef LIBHDFSPP_LOG_H_
 #define LIBHDFSPP_LOG_H_
@@ -32,10 +51,19 @@ namespace hdfs {
 
 #define LOG_ENABLE true
 #define LOG_PATH "PUT_LOG_PATH_HERE"
+#define LOG_STATS_INTERVAL 1000     //ms between saves of <log>.stats, 0 for none
+#define LOG_CAPTURE 0               //Logger::CPU_TIME | Logger::SWITCHES | Logger::SITES, 0 for none
+#define LOG_SITE_SAMPLING 64        //every nth open or read of a thread
 
 #define LOG_START() do {\
   if (LOG_ENABLE)\
-  Logging::startLog(LOG_PATH);\
+  Logging::startLog(LOG_PATH, LOG_STATS_INTERVAL, LOG_CAPTURE, \
+      LOG_SITE_SAMPLING);\
+} while(0)
+
+#define LOG_TAG(tag) do {\
+  if (LOG_ENABLE)\
+  Logging::setTag(tag);\
 } while(0)
 
 #define LOG_OPEN() do {\
@@ -69,6 +97,66 @@ namespace hdfs {
   Logging::logMessage(Logger::READ_RET, ret);\
 } while(0)
 
+#define LOG_WRITE() do {\
+  if (LOG_ENABLE)\
+  Logging::logMessage(Logger::WRITE, fs, file, buffer, length);\
+} while(0)
+
+#define LOG_WRITE_RET(ret) do {\
+  if (LOG_ENABLE)\
+  Logging::logMessage(Logger::WRITE_RET, ret);\
+} while(0)
+
+#define LOG_FLUSH() do {\
+  if (LOG_ENABLE)\
+  Logging::logMessage(Logger::FLUSH, fs, file);\
+} while(0)
+
+#define LOG_FLUSH_RET(ret) do {\
+  if (LOG_ENABLE)\
+  Logging::logMessage(Logger::FLUSH_RET, ret);\
+} while(0)
+
+#define LOG_HSYNC() do {\
+  if (LOG_ENABLE)\
+  Logging::logMessage(Logger::HSYNC, fs, file);\
+} while(0)
+
+#define LOG_HSYNC_RET(ret) do {\
+  if (LOG_ENABLE)\
+  Logging::logMessage(Logger::HSYNC_RET, ret);\
+} while(0)
+
+#define LOG_SEEK() do {\
+  if (LOG_ENABLE)\
+  Logging::logMessage(Logger::SEEK, fs, file, desiredPos);\
+} while(0)
+
+#define LOG_SEEK_RET(ret) do {\
+  if (LOG_ENABLE)\
+  Logging::logMessage(Logger::SEEK_RET, ret);\
+} while(0)
+
+#define LOG_GETFILEINFO() do {\
+  if (LOG_ENABLE)\
+  Logging::logMessage(Logger::GETFILEINFO, fs, path);\
+} while(0)
+
+#define LOG_GETFILEINFO_RET(ret) do {\
+  if (LOG_ENABLE)\
+  Logging::logMessage(Logger::GETFILEINFO_RET, ret);\
+} while(0)
+
+#define LOG_LISTDIR() do {\
+  if (LOG_ENABLE)\
+  Logging::logMessage(Logger::LISTDIR, fs, path);\
+} while(0)
+
+#define LOG_LISTDIR_RET(ret) do {\
+  if (LOG_ENABLE)\
+  Logging::logMessage(Logger::LISTDIR_RET, ret);\
+} while(0)
+
 }
 
 #endif
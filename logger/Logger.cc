@@ -20,7 +20,10 @@
 #include <thread>
 #include <ctime>
 #include <unistd.h>
+#include <sys/resource.h>
 #include <fcntl.h>
+#include <cstdlib>
+#include <execinfo.h>
 #include <pthread.h>
 #include <google/protobuf/io/coded_stream.h>
 
@@ -31,15 +34,26 @@ namespace pbio = google::protobuf::io;
 
 Logger ioLogger;
 
+#define SKIPPED_FRAMES 3        //getSite and both logMessage
+
+static thread_local long sampled_calls = 0;
+static thread_local std::string site_tag;
+
 Logger::Logger()
   : mutex_()
+  , path_()
   , current_day_(-1)
+  , capture_(0)
+  , sampling_(1)
+  , sites_()
+  , stats_()
   , logFile_(nullptr)
 {
 }
 
 Logger::~Logger()
 {
+  stats_.stop();
   if (logFile_ != nullptr) {
     logFile_->Close();
     delete logFile_;
@@ -54,6 +68,7 @@ bool Logger::startLog(const char* logFile)
   mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
   int logFileFd = open(logFile, O_CREAT | O_WRONLY | O_TRUNC, mode);
   
+  path_ = logFile;
   if (logFileFd == -1) return false;
   logFile_ = new pbio::FileOutputStream(logFileFd);
   
@@ -62,7 +77,22 @@ bool Logger::startLog(const char* logFile)
 
 bool Logger::logMessage(FuncType type, va_list &va)
 {
+  long entered = LoggerStats::now();
+
+  // usage is taken as close to the traced call as possible, so the
+  // logger's own work falls outside of the call
+  Usage usage = {-1, -1, -1};
+  bool returned = type % 2 == 1;     //a return follows its call
+  if (returned) getUsage(usage);
+  Site site;
+  getSite(type, site);
+
+  stats_.enterWait();
   std::lock_guard<std::mutex> lock(mutex_);
+  stats_.leaveWait();
+  long locked = LoggerStats::now();
+  stats_.lock(locked - entered);
+  if (!returned) getUsage(usage);
   
   hadoop::hdfs::log msg; 
   msg.set_time(getTime());
@@ -104,13 +134,130 @@ bool Logger::logMessage(FuncType type, va_list &va)
       msg.set_type(hadoop::hdfs::log_FuncType_READ_RET);
       msg.add_argument(va_arg(va, long));
       break;
+    case WRITE:
+      msg.set_type(hadoop::hdfs::log_FuncType_WRITE);
+      msg.add_argument(va_arg(va, long));
+      msg.add_argument(va_arg(va, long));
+      msg.add_argument(va_arg(va, long));
+      msg.add_argument(va_arg(va, long));
+      break;
+    case WRITE_RET:
+      msg.set_type(hadoop::hdfs::log_FuncType_WRITE_RET);
+      msg.add_argument(va_arg(va, long));
+      break;
+    case FLUSH:
+      msg.set_type(hadoop::hdfs::log_FuncType_FLUSH);
+      msg.add_argument(va_arg(va, long));
+      msg.add_argument(va_arg(va, long));
+      break;
+    case FLUSH_RET:
+      msg.set_type(hadoop::hdfs::log_FuncType_FLUSH_RET);
+      msg.add_argument(va_arg(va, long));
+      break;
+    case HSYNC:
+      msg.set_type(hadoop::hdfs::log_FuncType_HSYNC);
+      msg.add_argument(va_arg(va, long));
+      msg.add_argument(va_arg(va, long));
+      break;
+    case HSYNC_RET:
+      msg.set_type(hadoop::hdfs::log_FuncType_HSYNC_RET);
+      msg.add_argument(va_arg(va, long));
+      break;
+    case SEEK:
+      msg.set_type(hadoop::hdfs::log_FuncType_SEEK);
+      msg.add_argument(va_arg(va, long));
+      msg.add_argument(va_arg(va, long));
+      msg.add_argument(va_arg(va, long));
+      break;
+    case SEEK_RET:
+      msg.set_type(hadoop::hdfs::log_FuncType_SEEK_RET);
+      msg.add_argument(va_arg(va, long));
+      break;
+    case GETFILEINFO:
+      msg.set_type(hadoop::hdfs::log_FuncType_GETFILEINFO);
+      msg.add_argument(va_arg(va, long));
+      msg.set_path(va_arg(va, char*)); 
+      break;
+    case GETFILEINFO_RET:
+      msg.set_type(hadoop::hdfs::log_FuncType_GETFILEINFO_RET);
+      msg.add_argument(va_arg(va, long));
+      break;
+    case LISTDIR:
+      msg.set_type(hadoop::hdfs::log_FuncType_LISTDIR);
+      msg.add_argument(va_arg(va, long));
+      msg.set_path(va_arg(va, char*)); 
+      break;
+    case LISTDIR_RET:
+      msg.set_type(hadoop::hdfs::log_FuncType_LISTDIR_RET);
+      msg.add_argument(va_arg(va, long));
+      break;
   }
   va_end(va);
 
-  if (!writeDelimitedLog(msg)) return false;
-  logFile_->Flush();
+  if (usage.cpu >= 0) msg.set_cputime(usage.cpu);
+  if (usage.voluntary >= 0) {
+    msg.set_voluntaryswitches(usage.voluntary);
+    msg.set_involuntaryswitches(usage.involuntary);
+  }
+  if (site.id != 0) addSite(site, msg);
+
+  // a record that failed to write may be partly written, either way
+  // it is lost
+  bool ok = writeDelimitedLog(msg);
+  long written = LoggerStats::now();
+  if (ok) {
+    int size = msg.GetCachedSize();
+    stats_.write(written - locked, 
+        pbio::CodedOutputStream::VarintSize32(size) + size);
+    ok = logFile_->Flush();
+    stats_.flush(LoggerStats::now() - written);
+  }
+  if (!ok) {
+    stats_.error();
+    stats_.drop();
+  }
+  stats_.call(LoggerStats::now() - entered);
   
-  return true;
+  return ok;
+}
+
+void Logger::drop()
+{
+  stats_.drop();
+}
+
+void Logger::setCapture(int capture)
+{
+  capture_ = capture;
+
+  // the first backtrace loads the unwinder, better not in a traced call
+  if (capture_ & SITES) {
+    void* frame;
+    backtrace(&frame, 1);
+  }
+}
+
+void Logger::setSampling(long every)
+{
+  sampling_ = every > 0 ? every : 1;
+}
+
+void Logger::setTag(const char* tag)
+{
+  site_tag = tag != nullptr ? tag : "";
+}
+
+/* Stats are saved next to the log every interval in milliseconds */
+void Logger::startStats(long interval)
+{
+  if (interval > 0) {
+    stats_.start(path_ + ".stats", path_, interval);
+  }
+}
+
+const LoggerStats &Logger::stats() const
+{
+  return stats_;
 }
 
 bool Logger::writeDelimitedLog(::hadoop::hdfs::log &msg)
@@ -133,6 +280,16 @@ bool Logger::writeDelimitedLog(::hadoop::hdfs::log &msg)
   return true;
 }
 
+bool Logger::writeDelimitedLog(const std::string &record)
+{
+  pbio::CodedOutputStream output(logFile_);
+
+  output.WriteVarint32(record.size());
+  output.WriteRaw(record.data(), record.size());
+
+  return !output.HadError();
+}
+
 long Logger::getTime()
 {
   struct timespec now; 
@@ -155,3 +312,78 @@ long Logger::getTime()
   return nano_second; 
 }
 
+/* Call site of every sampled open or read of the calling thread: its
+ * tag if it set one, its stack otherwise. Both are hashed with FNV-1a,
+ * and the id is never 0. Never inlined, so the frames to skip are
+ * known. */
+__attribute__((noinline)) void Logger::getSite(FuncType type, Site &site) const
+{
+  site.id = 0;
+  site.depth = 0;
+  if (!(capture_ & SITES) || (type != OPEN && type != READ) 
+      || ++sampled_calls % sampling_ != 0) {
+    return;
+  }
+
+  uint64_t hash = 14695981039346656037ULL;
+  auto mix = [&hash](const unsigned char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+      hash = (hash ^ data[i]) * 1099511628211ULL;
+    }
+  };
+
+  if (!site_tag.empty()) {
+    mix((const unsigned char*)site_tag.data(), site_tag.size());
+  } else {
+    void* frames[SITE_FRAMES + SKIPPED_FRAMES];
+    int depth = backtrace(frames, SITE_FRAMES + SKIPPED_FRAMES);
+    for (int i = SKIPPED_FRAMES; i < depth; ++i) {
+      site.frames[site.depth++] = frames[i];
+    }
+    mix((const unsigned char*)site.frames, site.depth * sizeof(void*));
+  }
+
+  site.id = hash != 0 ? hash : 1;
+}
+
+/* Frames are symbolized only the first time a site is logged, under
+ * the logger lock */
+void Logger::addSite(const Site &site, ::hadoop::hdfs::log &msg)
+{
+  msg.set_site(site.id);
+  if (!sites_.insert(site.id).second) {
+    return;
+  }
+
+  if (site.depth == 0) {
+    msg.add_frame(site_tag.empty() ? "?" : site_tag);
+    return;
+  }
+
+  char** symbols = backtrace_symbols(site.frames, site.depth);
+  for (int i = 0; i < site.depth; ++i) {
+    msg.add_frame(symbols != nullptr ? symbols[i] : "?");
+  }
+  free(symbols);
+}
+
+/* Totals of the calling thread, left -1 if not captured */
+void Logger::getUsage(Usage &usage) const
+{
+  if (capture_ & CPU_TIME) {
+    struct timespec cpu;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu) == 0) {
+      usage.cpu = cpu.tv_sec * 1000000000L + cpu.tv_nsec;
+    }
+  }
+
+#ifdef RUSAGE_THREAD
+  if (capture_ & SWITCHES) {
+    struct rusage thread;
+    if (getrusage(RUSAGE_THREAD, &thread) == 0) {
+      usage.voluntary = thread.ru_nvcsw;
+      usage.involuntary = thread.ru_nivcsw;
+    }
+  }
+#endif
+}
@@ -21,9 +21,15 @@
 
 #include <cstdarg>
 #include <mutex>
+#include <string>
+#include <cstdint>
+#include <unordered_set>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 
 #include "log.pb.h"
+#include "LoggerStats.h"
+
+#define SITE_FRAMES 8           //frames of a call site kept
 
 namespace hdfs
 {
@@ -37,21 +43,66 @@ class Logger
     CLOSE,
     CLOSE_RET,
     READ,
-    READ_RET
+    READ_RET,
+    WRITE,
+    WRITE_RET,
+    FLUSH,
+    FLUSH_RET,
+    HSYNC,
+    HSYNC_RET,
+    SEEK,
+    SEEK_RET,
+    GETFILEINFO,
+    GETFILEINFO_RET,
+    LISTDIR,
+    LISTDIR_RET
   } FuncType;
 
+  typedef enum {        //thread counters to capture with every record
+    CPU_TIME = 1,
+    SWITCHES = 2,       //context switches
+    SITES = 4           //call sites of sampled opens and reads
+  } Capture;
+
   Logger ();
   virtual ~Logger ();
 
   bool startLog(const char* logFile);
   bool logMessage(FuncType type, va_list &va);
   bool writeDelimitedLog(::hadoop::hdfs::log &msg);
+  bool writeDelimitedLog(const std::string &record);  //already serialized
+  void drop();                    //count a record not logged
+  void setCapture(int capture);   //Capture flags, before logging starts
+  void setSampling(long every);   //every nth open or read of a thread
+  static void setTag(const char* tag);  //of calling thread, null for none
+  void startStats(long interval);
+  const LoggerStats &stats() const;
 
  private:
+  struct Usage {
+    long cpu;
+    long voluntary;
+    long involuntary;
+  };
+
+  struct Site {
+    uint64_t id;        //0 if not sampled
+    int depth;
+    void* frames[SITE_FRAMES];
+  };
+
   long getTime();       //get time in nanosecond and refresh current day
+  void getUsage(Usage &usage) const;
+  void getSite(FuncType type, Site &site) const;
+  void addSite(const Site &site, ::hadoop::hdfs::log &msg);
 
   std::mutex mutex_;
+  std::string path_;
   int current_day_;
+  int capture_;
+  long sampling_;
+  std::unordered_set<uint64_t> sites_;    //written to the log already
+  LoggerStats stats_;
   ::google::protobuf::io::FileOutputStream* logFile_;
 };
 
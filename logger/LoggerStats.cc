@@ -0,0 +1,302 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ctime>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "LoggerStats.h"
+
+#define STATS_MAGIC "libhdfspp-logger-stats"
+#define STATS_VERSION 1
+
+using namespace hdfs;
+
+LoggerStats::LoggerStats()
+  : mutex_()
+  , waiting_(0)
+  , max_waiting_(0)
+  , stopping_(false)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  start_ = now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+LoggerStats::~LoggerStats()
+{
+  stop();
+}
+
+long LoggerStats::now()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+int LoggerStats::bucketOf(uint64_t ns)
+{
+  int bucket = 0;
+  while (ns > 1 && bucket < CALL_BUCKETS - 1) {
+    ns >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+void LoggerStats::call(long ns)
+{
+  Counters &counters = local();
+  add(counters.call_ns, ns);
+  add(counters.calls[bucketOf(ns)], 1);
+}
+
+void LoggerStats::lock(long ns)
+{
+  add(local().lock_ns, ns);
+}
+
+void LoggerStats::write(long ns, uint64_t bytes)
+{
+  Counters &counters = local();
+  add(counters.write_ns, ns);
+  add(counters.records, 1);
+  add(counters.bytes, bytes);
+}
+
+void LoggerStats::flush(long ns)
+{
+  add(local().flush_ns, ns);
+}
+
+void LoggerStats::drop()
+{
+  add(local().dropped, 1);
+}
+
+void LoggerStats::error()
+{
+  add(local().errors, 1);
+}
+
+void LoggerStats::enterWait()
+{
+  long waiting = ++waiting_;
+  long peak = max_waiting_.load(std::memory_order_relaxed);
+  while (waiting > peak && 
+      !max_waiting_.compare_exchange_weak(peak, waiting)) {
+  }
+}
+
+void LoggerStats::leaveWait()
+{
+  --waiting_;
+}
+
+LoggerStats::Snapshot LoggerStats::snapshot(const std::string &log) const
+{
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+
+  Snapshot snapshot;
+  snapshot.pid = (int)getpid();
+  snapshot.log = log;
+  snapshot.start = start_;
+  snapshot.time = now.tv_sec * 1000000000L + now.tv_nsec;
+  snapshot.waiting = waiting_;
+  snapshot.max_waiting = max_waiting_;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &counters : threads_) {
+    Counts counts;
+    counts.thread = counters->thread;
+    counts.records = counters->records;
+    counts.bytes = counters->bytes;
+    counts.call_ns = counters->call_ns;
+    counts.lock_ns = counters->lock_ns;
+    counts.write_ns = counters->write_ns;
+    counts.flush_ns = counters->flush_ns;
+    counts.dropped = counters->dropped;
+    counts.errors = counters->errors;
+    for (int i = 0; i < CALL_BUCKETS; ++i) {
+      counts.calls[i] = counters->calls[i];
+    }
+    snapshot.threads.push_back(counts);
+  }
+
+  return snapshot;
+}
+
+/* Written aside and renamed over, so readers never see half a file */
+bool LoggerStats::save(const std::string &path, const std::string &log) const
+{
+  std::string temp = path + ".tmp";
+  std::ofstream out(temp.c_str());
+
+  snapshot(log).save(out);
+  out.close();
+  if (out.fail()) {
+    return false;
+  }
+
+  return std::rename(temp.c_str(), path.c_str()) == 0;
+}
+
+void LoggerStats::start(const std::string &path, const std::string &log, 
+    long interval)
+{
+  stop();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  stopping_ = false;
+  saver_ = std::thread(&LoggerStats::run, this, path, log, interval);
+}
+
+void LoggerStats::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  stop_cv_.notify_all();
+
+  if (saver_.joinable()) {
+    saver_.join();
+  }
+}
+
+void LoggerStats::add(std::atomic<uint64_t> &counter, uint64_t value)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + value, 
+      std::memory_order_relaxed);
+}
+
+/* Counters of the calling thread, looked up once per thread */
+LoggerStats::Counters &LoggerStats::local()
+{
+  static thread_local const LoggerStats* owner = nullptr;
+  static thread_local Counters* counters = nullptr;
+
+  if (owner == this) {
+    return *counters;
+  }
+
+  long thread = (long)pthread_self();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  counters = nullptr;
+  for (auto &other : threads_) {
+    if (other->thread == thread) counters = other.get();
+  }
+  if (counters == nullptr) {
+    threads_.push_back(std::unique_ptr<Counters>(new Counters()));
+    counters = threads_.back().get();
+    counters->thread = thread;
+  }
+  owner = this;
+
+  return *counters;
+}
+
+/* Saves every interval, and once more when stopped */
+void LoggerStats::run(std::string path, std::string log, long interval)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (!stopping_) {
+    stop_cv_.wait_for(lock, std::chrono::milliseconds(interval));
+    lock.unlock();
+    save(path, log);
+    lock.lock();
+  }
+}
+
+void LoggerStats::Snapshot::save(std::ostream &out) const
+{
+  out << STATS_MAGIC << " " << STATS_VERSION << "\n";
+  out << "pid " << pid << "\n";
+  out << "log " << log << "\n";
+  out << "time " << start << " " << time << "\n";
+  out << "waiting " << waiting << " " << max_waiting << "\n";
+  out << "threads " << threads.size() << "\n";
+
+  for (auto &counts : threads) {
+    int used = 0;
+    for (int i = 0; i < CALL_BUCKETS; ++i) {
+      if (counts.calls[i] > 0) used++;
+    }
+
+    out << counts.thread << " " << counts.records << " " << counts.bytes;
+    out << " " << counts.call_ns << " " << counts.lock_ns << " ";
+    out << counts.write_ns << " " << counts.flush_ns << " " << counts.dropped;
+    out << " " << counts.errors << " " << used;
+    for (int i = 0; i < CALL_BUCKETS; ++i) {
+      if (counts.calls[i] > 0) out << " " << i << ":" << counts.calls[i];
+    }
+    out << "\n";
+  }
+}
+
+bool LoggerStats::Snapshot::load(std::istream &in)
+{
+  std::string magic, key;
+  int version;
+  size_t count;
+
+  if (!(in >> magic >> version) || magic != STATS_MAGIC 
+      || version != STATS_VERSION) {
+    return false;
+  }
+  if (!(in >> key >> pid) || key != "pid" || !(in >> key) || key != "log") {
+    return false;
+  }
+  in.ignore(1);
+  std::getline(in, log);
+  if (!(in >> key >> start >> time) || key != "time" 
+      || !(in >> key >> waiting >> max_waiting) || key != "waiting"
+      || !(in >> key >> count) || key != "threads") {
+    return false;
+  }
+
+  threads.resize(count);
+  for (auto &counts : threads) {
+    int used;
+
+    if (!(in >> counts.thread >> counts.records >> counts.bytes 
+          >> counts.call_ns >> counts.lock_ns >> counts.write_ns 
+          >> counts.flush_ns >> counts.dropped >> counts.errors >> used)) {
+      return false;
+    }
+    for (int i = 0; i < CALL_BUCKETS; ++i) counts.calls[i] = 0;
+    for (int i = 0; i < used; ++i) {
+      int bucket;
+      char colon;
+      uint64_t calls;
+
+      if (!(in >> bucket >> colon >> calls) || colon != ':') return false;
+      if (bucket < 0 || bucket >= CALL_BUCKETS) return false;
+      counts.calls[bucket] = calls;
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,132 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// LoggerStats counts what tracing costs the traced process. Every
+// thread calling the logger gets its own counters on first use and is
+// the only one writing them, as relaxed atomics, so counting takes no
+// lock: records and bytes written, time spent in the log call, time
+// waiting for the logger lock, time writing and flushing, records
+// dropped and write errors, and a log2 histogram of log call time.
+// How many threads wait for the lock at once is the backlog of the
+// logger, kept with its peak.
+//
+// A background thread saves a snapshot every interval to a text file,
+// replacing it by rename, so a tool can read it at any time without
+// stopping the process and never sees half of one (see tstat).
+
+#ifndef LIBHDFSPP_LOGGERSTATS_H_
+#define LIBHDFSPP_LOGGERSTATS_H_
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <condition_variable>
+
+#define CALL_BUCKETS 40         //log2 of ns, up to 2^40 ns
+
+namespace hdfs
+{
+
+class LoggerStats
+{
+ public:
+  // Counters of one thread as saved
+  struct Counts {
+    long thread;
+    uint64_t records;
+    uint64_t bytes;
+    uint64_t call_ns;       //in the log call, all of it
+    uint64_t lock_ns;       //waiting for the logger lock
+    uint64_t write_ns;      //serializing and writing
+    uint64_t flush_ns;
+    uint64_t dropped;       //records not written
+    uint64_t errors;        //failed writes and flushes
+    uint64_t calls[CALL_BUCKETS];   //by log2 of call ns
+  };
+
+  struct Snapshot {
+    int pid;
+    std::string log;
+    long start;             //realtime ns when counting started
+    long time;              //realtime ns of the snapshot
+    long waiting;
+    long max_waiting;
+    std::vector<Counts> threads;
+
+    void save(std::ostream &out) const;
+    bool load(std::istream &in);
+  };
+
+  LoggerStats();
+  virtual ~LoggerStats();
+
+  static long now();                  //monotonic ns
+  static int bucketOf(uint64_t ns);
+
+  void call(long ns);
+  void lock(long ns);
+  void write(long ns, uint64_t bytes);
+  void flush(long ns);
+  void drop();
+  void error();
+  void enterWait();
+  void leaveWait();
+
+  Snapshot snapshot(const std::string &log) const;
+  bool save(const std::string &path, const std::string &log) const;
+  void start(const std::string &path, const std::string &log, long interval);
+  void stop();
+
+ private:
+  struct Counters {
+    long thread;
+    std::atomic<uint64_t> records;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> call_ns;
+    std::atomic<uint64_t> lock_ns;
+    std::atomic<uint64_t> write_ns;
+    std::atomic<uint64_t> flush_ns;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> errors;
+    std::atomic<uint64_t> calls[CALL_BUCKETS];
+  };
+
+  static void add(std::atomic<uint64_t> &counter, uint64_t value);
+  Counters &local();
+  void run(std::string path, std::string log, long interval);
+
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Counters>> threads_;
+  std::atomic<long> waiting_;
+  std::atomic<long> max_waiting_;
+  long start_;
+
+  std::condition_variable stop_cv_;
+  bool stopping_;
+  std::thread saver_;
+};
+
+} /* hdfs */ 
+
+#endif
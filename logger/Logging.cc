@@ -30,20 +30,27 @@ extern Logger ioLogger;
 std::string Logging::logFilePath("");
 bool Logging::failed = false;
 
-void Logging::startLog(const char* logFile)
+/* Stats are saved even if the log fails, to show records are dropped */
+void Logging::startLog(const char* logFile, long statsInterval, int capture, 
+    long sampling)
 {
   logFilePath = logFile;
   appendPid(logFilePath);
 
+  ioLogger.setCapture(capture);
+  ioLogger.setSampling(sampling);
+
   if (!ioLogger.startLog(logFilePath.c_str())) {
     std::cerr << "Failed to start IO logger." << std::endl;
     failed = true;
   }
+  ioLogger.startStats(statsInterval);
 }
 
 void Logging::logMessage(Logger::FuncType type, ...)
 {
   if (failed) {
+    ioLogger.drop();
     return;
   }
 
@@ -53,6 +60,13 @@ void Logging::logMessage(Logger::FuncType type, ...)
   va_end(va);
 }
 
+/* Attribute sampled calls of this thread to the tag rather than the
+ * stack, until it is set to null */
+void Logging::setTag(const char* tag)
+{
+  Logger::setTag(tag);
+}
+
 void Logging::appendPid(std::string &str)
 {
   int pid = (int) getpid();
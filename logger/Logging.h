@@ -32,8 +32,10 @@ class Logging
   Logging ();
   virtual ~Logging ();
 
-  static void startLog(const char* logFile);
+  static void startLog(const char* logFile, long statsInterval = 0, 
+      int capture = 0, long sampling = 1);
   static void logMessage(Logger::FuncType type, ...);
+  static void setTag(const char* tag);
 
  private:
   static void appendPid(std::string &str);
@@ -0,0 +1,341 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+#include <algorithm>
+
+#include "AccessProfile.h"
+
+#define MAX_STRIDES 64
+
+using namespace hdfs;
+
+AccessProfile::AccessProfile(size_t max_files)
+  : max_files_(std::max(max_files, (size_t)1))
+  , streams_by_pattern_()
+  , reads_by_pattern_()
+  , bytes_by_pattern_()
+  , sizes_()
+  , last_read_(-1)
+{
+}
+
+AccessProfile::~AccessProfile()
+{
+}
+
+const char* AccessProfile::patternName(Pattern pattern)
+{
+  switch (pattern) {
+    case SEQUENTIAL:
+      return "sequential";
+    case STRIDED:
+      return "strided";
+    case REREAD:
+      return "re-read";
+    case RANDOM:
+      return "random";
+    case SINGLE:
+      return "single";
+    default:
+      return "unknown";
+  }
+}
+
+void AccessProfile::add(const hadoop::hdfs::log &msg, long time)
+{
+  switch (msg.type()) {
+    case hadoop::hdfs::log_FuncType_OPEN:
+      opening_[msg.threadid()] = msg.path();
+      break;
+    case hadoop::hdfs::log_FuncType_OPEN_RET: {
+      if (msg.argument_size() < 1) break;
+
+      // a handle opened again without close starts a new stream
+      auto old = streams_.find(msg.argument(0));
+      if (old != streams_.end()) {
+        close(old->second);
+        streams_.erase(old);
+      }
+
+      Stream &stream = streams_[msg.argument(0)];
+      stream = Stream();
+      auto path = opening_.find(msg.threadid());
+      if (path != opening_.end()) {
+        stream.path = path->second;
+        opening_.erase(path);
+      }
+      break;
+    }
+    case hadoop::hdfs::log_FuncType_READ: {
+      if (msg.argument_size() < 5) break;
+
+      // files opened before the log started have no path
+      auto stream = streams_.find(msg.argument(1));
+      if (stream == streams_.end()) {
+        stream = streams_.insert(std::make_pair(msg.argument(1), Stream())).first;
+      }
+      read(stream->second, msg.argument(2), msg.argument(4), time);
+      break;
+    }
+    case hadoop::hdfs::log_FuncType_CLOSE: {
+      if (msg.argument_size() < 2) break;
+
+      auto stream = streams_.find(msg.argument(1));
+      if (stream != streams_.end()) {
+        close(stream->second);
+        streams_.erase(stream);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void AccessProfile::finish()
+{
+  for (auto &stream : streams_) {
+    close(stream.second);
+  }
+  streams_.clear();
+  opening_.clear();
+}
+
+void AccessProfile::print(std::ostream &out, size_t top) const
+{
+  auto mb = [](long bytes) { return bytes / 1024.0 / 1024.0; };
+  auto size = [](long bytes) {
+    const char* units[] = {"", "K", "M", "G", "T", "P", "E"};
+    int unit = 0;
+    while (bytes >= 1024 && bytes % 1024 == 0) {
+      bytes /= 1024;
+      unit++;
+    }
+    return std::to_string(bytes) + units[unit];
+  };
+  auto summary = [&out](const Histogram &h, double scale) {
+    out << "  mean: " << h.mean() / scale;
+    out << " p50: " << h.percentile(50) / scale;
+    out << " p90: " << h.percentile(90) / scale;
+    out << " p99: " << h.percentile(99) / scale;
+    out << " max: " << h.max() / scale << std::endl;
+  };
+
+  long streams = 0;
+  for (int p = 0; p < NUM_PATTERNS; ++p) {
+    streams += streams_by_pattern_[p];
+  }
+
+  out << "Access patterns of " << streams << " streams:" << std::endl;
+  out << "  pattern\tstreams\treads\tMB" << std::endl;
+  for (int p = 0; p < NUM_PATTERNS; ++p) {
+    out << "  " << patternName((Pattern)p) << "\t" << streams_by_pattern_[p];
+    out << "\t" << reads_by_pattern_[p] << "\t" << mb(bytes_by_pattern_[p]);
+    out << std::endl;
+  }
+
+  if (!strides_.empty()) {
+    std::vector<std::pair<long, long>> strides(strides_.begin(), strides_.end());
+    std::sort(strides.begin(), strides.end(), 
+        [](const std::pair<long, long> &l, const std::pair<long, long> &r) {
+          return l.second > r.second;
+        });
+    out << "Common strides:";
+    for (size_t i = 0; i < strides.size() && i < 5; ++i) {
+      out << " " << strides[i].first << " (" << strides[i].second << ")";
+    }
+    out << std::endl;
+  }
+
+  out << "\nRequest sizes (bytes) of " << request_sizes_.count() << " reads:";
+  out << std::endl;
+  summary(request_sizes_, 1);
+  out << "  size\t";
+  for (int p = 0; p < NUM_PATTERNS; ++p) {
+    out << "\t" << patternName((Pattern)p);
+  }
+  out << std::endl;
+  for (int b = 0; b < SIZE_BUCKETS; ++b) {
+    long count = 0;
+    for (int p = 0; p < NUM_PATTERNS; ++p) count += sizes_[p][b];
+    if (count == 0) continue;
+
+    out << "  " << size(1L << b) << "-" << size(1L << (b + 1)) << "\t";
+    for (int p = 0; p < NUM_PATTERNS; ++p) {
+      out << "\t" << sizes_[p][b];
+    }
+    out << std::endl;
+  }
+
+  out << "\nTime between reads (us):" << std::endl;
+  summary(gaps_, 1000);
+  out << "Time between reads of a stream (us):" << std::endl;
+  summary(stream_gaps_, 1000);
+
+  std::vector<std::pair<std::string, FileCount>> files(files_.begin(), 
+      files_.end());
+  std::sort(files.begin(), files.end(), 
+      [](const std::pair<std::string, FileCount> &l, 
+        const std::pair<std::string, FileCount> &r) {
+        return l.second.bytes != r.second.bytes ? 
+          l.second.bytes > r.second.bytes : l.first < r.first;
+      });
+
+  out << "\nHot files by MB read, top " << std::min(top, files.size());
+  out << " of " << files.size() << " tracked:" << std::endl;
+  out << "  MB\terror\treads\tstreams\tpattern\tpath" << std::endl;
+  for (size_t i = 0; i < files.size() && i < top; ++i) {
+    const FileCount &file = files[i].second;
+    int pattern = 0;
+    for (int p = 1; p < NUM_PATTERNS; ++p) {
+      if (file.patterns[p] > file.patterns[pattern]) pattern = p;
+    }
+
+    out << "  " << mb(file.bytes) << "\t" << mb(file.error) << "\t";
+    out << file.reads << "\t" << file.streams << "\t";
+    out << patternName((Pattern)pattern) << "\t" << files[i].first;
+    out << std::endl;
+  }
+}
+
+int AccessProfile::sizeBucket(long size)
+{
+  if (size <= 0) {
+    return 0;
+  }
+
+  return std::min(63 - __builtin_clzll(size), SIZE_BUCKETS - 1);
+}
+
+void AccessProfile::read(Stream &stream, long offset, long length, long time)
+{
+  if (last_read_ >= 0) {
+    gaps_.record(time - last_read_);
+  }
+  last_read_ = time;
+  request_sizes_.record(length);
+  stream.sizes[sizeBucket(length)]++;
+
+  if (stream.reads > 0) {
+    long delta = offset - stream.last_offset;
+
+    stream_gaps_.record(time - stream.last_time);
+    if (offset == stream.last_end) {
+      stream.counts[SEQUENTIAL]++;
+    } else if (delta != 0 && delta == stream.last_delta) {
+      stream.counts[STRIDED]++;
+    } else if (overlaps(stream, offset, offset + length)) {
+      stream.counts[REREAD]++;
+    } else {
+      stream.counts[RANDOM]++;
+    }
+
+    if (offset != stream.last_end) {
+      if (stream.votes == 0) {
+        stream.stride = delta;
+        stream.votes = 1;
+      } else {
+        stream.votes += delta == stream.stride ? 1 : -1;
+      }
+    }
+
+    stream.last_delta = delta;
+  }
+
+  long* recent = stream.recent[stream.reads % RECENT];
+  recent[0] = offset;
+  recent[1] = offset + length;
+  stream.reads++;
+  stream.bytes += length;
+  stream.last_time = time;
+  stream.last_offset = offset;
+  stream.last_end = offset + length;
+}
+
+bool AccessProfile::overlaps(const Stream &stream, long offset, long end)
+{
+  long reads = std::min(stream.reads, (long)RECENT);
+
+  for (long i = 0; i < reads; ++i) {
+    if (offset < stream.recent[i][1] && end > stream.recent[i][0]) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void AccessProfile::close(Stream &stream)
+{
+  if (stream.reads == 0) {
+    return;
+  }
+
+  Pattern pattern = SINGLE;
+  if (stream.reads > 1) {
+    pattern = SEQUENTIAL;
+    for (int p = SEQUENTIAL + 1; p <= RANDOM; ++p) {
+      if (stream.counts[p] > stream.counts[pattern]) pattern = (Pattern)p;
+    }
+  }
+
+  if (pattern == STRIDED && 
+      (strides_.size() < MAX_STRIDES || strides_.count(stream.stride))) {
+    strides_[stream.stride]++;
+  }
+
+  streams_by_pattern_[pattern]++;
+  reads_by_pattern_[pattern] += stream.reads;
+  bytes_by_pattern_[pattern] += stream.bytes;
+  for (int b = 0; b < SIZE_BUCKETS; ++b) {
+    sizes_[pattern][b] += stream.sizes[b];
+  }
+
+  if (stream.path != "") {
+    countFile(stream, pattern);
+  }
+}
+
+/* Space-Saving: a file not counted yet takes over the counter with the
+ * fewest bytes, and everything counted there becomes its error. */
+void AccessProfile::countFile(const Stream &stream, Pattern pattern)
+{
+  auto file = files_.find(stream.path);
+
+  if (file == files_.end()) {
+    FileCount count = FileCount();
+
+    if (files_.size() >= max_files_) {
+      auto least = by_bytes_.begin();
+      count.bytes = least->first;
+      count.error = least->first;
+      files_.erase(least->second);
+      by_bytes_.erase(least);
+    }
+    file = files_.insert(std::make_pair(stream.path, count)).first;
+  } else {
+    by_bytes_.erase(std::make_pair(file->second.bytes, stream.path));
+  }
+
+  file->second.bytes += stream.bytes;
+  by_bytes_.insert(std::make_pair(file->second.bytes, stream.path));
+  file->second.reads += stream.reads;
+  file->second.streams++;
+  file->second.patterns[pattern]++;
+}
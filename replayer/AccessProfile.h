@@ -0,0 +1,123 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// AccessProfile tells how files of a log are read. Reads between an
+// open and a close of a file form a stream, and every read is compared
+// with the one before it in the stream: it is sequential if it starts
+// where the last one ended, strided if it moved as far as the last one
+// did, a re-read if it overlaps one of the last reads of the stream,
+// and random otherwise. When the stream is closed it takes the pattern
+// most of its reads have. Request sizes are counted per pattern, and
+// the time between reads is kept both for the whole log and within
+// streams.
+//
+// Memory only grows with files open at a time: hot files are ranked
+// with the Space-Saving algorithm among a fixed number of counters,
+// whose counts may be overestimated by at most the reported error.
+// Counters are kept ordered by bytes, so the one to take over is found
+// in logarithmic time.
+
+#ifndef LIBHDFSPP_ACCESSPROFILE_H_
+#define LIBHDFSPP_ACCESSPROFILE_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <ostream>
+#include <unordered_map>
+
+#include "log.pb.h"
+#include "Histogram.h"
+
+namespace hdfs
+{
+
+class AccessProfile
+{
+ public:
+  typedef enum {
+    SEQUENTIAL,
+    STRIDED,
+    REREAD,
+    RANDOM,
+    SINGLE,     //stream of one read
+    NUM_PATTERNS
+  } Pattern;
+
+  AccessProfile(size_t max_files);
+  virtual ~AccessProfile();
+
+  static const char* patternName(Pattern pattern);
+
+  void add(const hadoop::hdfs::log &msg, long time); //ns since start of log
+  void finish();    //close streams left open
+  void print(std::ostream &out, size_t top) const;
+
+ private:
+  static const int SIZE_BUCKETS = 48;   //powers of two
+  static const int RECENT = 16;         //reads checked for re-reads
+
+  struct Stream {
+    std::string path;
+    long reads;
+    long bytes;
+    long last_time;
+    long last_offset;
+    long last_end;
+    long last_delta;
+    long recent[RECENT][2];   //offset and end of the last reads
+    long counts[RANDOM + 1];
+    long stride;          //majority vote among strides
+    long votes;
+    long sizes[SIZE_BUCKETS];
+  };
+
+  struct FileCount {
+    long bytes;
+    long error;           //bytes possibly counted for other files
+    long reads;
+    long streams;
+    long patterns[NUM_PATTERNS];
+  };
+
+  static int sizeBucket(long size);
+
+  static bool overlaps(const Stream &stream, long offset, long end);
+  void read(Stream &stream, long offset, long length, long time);
+  void close(Stream &stream);
+  void countFile(const Stream &stream, Pattern pattern);
+
+  size_t max_files_;
+  std::unordered_map<long, std::string> opening_;   //path by thread
+  std::unordered_map<long, Stream> streams_;        //by handle
+  std::unordered_map<std::string, FileCount> files_;
+  std::set<std::pair<long, std::string>> by_bytes_;  //files_ by bytes
+  long streams_by_pattern_[NUM_PATTERNS];
+  long reads_by_pattern_[NUM_PATTERNS];
+  long bytes_by_pattern_[NUM_PATTERNS];
+  long sizes_[NUM_PATTERNS][SIZE_BUCKETS];
+  std::map<long, long> strides_;    //streams by their stride
+  long last_read_;
+  Histogram request_sizes_;
+  Histogram gaps_;                  //between reads of the log
+  Histogram stream_gaps_;           //between reads of a stream
+};
+
+} /* hdfs */ 
+
+#endif
@@ -0,0 +1,144 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "Channel.h"
+
+#define BUFSIZE 4096
+
+using namespace hdfs;
+
+Channel::Channel(int fd)
+  : fd_(fd)
+{
+  // lines are small and answered at once, don't let them wait
+  int one = 1;
+  setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+Channel::~Channel()
+{
+  if (fd_ != -1) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+std::unique_ptr<Channel> Channel::connect(const std::string &host, int port)
+{
+  struct addrinfo hints;
+  struct addrinfo* result = nullptr;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  std::string service = std::to_string(port);
+  if (getaddrinfo(host.c_str(), service.c_str(), &hints, &result) != 0) {
+    return nullptr;
+  }
+
+  int fd = -1;
+  for (auto addr = result; addr != nullptr; addr = addr->ai_next) {
+    fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    if (fd == -1) continue;
+    if (::connect(fd, addr->ai_addr, addr->ai_addrlen) == 0) break;
+
+    ::close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(result);
+
+  if (fd == -1) {
+    return nullptr;
+  }
+  return std::unique_ptr<Channel>(new Channel(fd));
+}
+
+int Channel::listen(int port)
+{
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd == -1) {
+    return -1;
+  }
+
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+
+  if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1 
+      || ::listen(fd, SOMAXCONN) == -1) {
+    ::close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+std::unique_ptr<Channel> Channel::accept(int socket)
+{
+  int fd = ::accept(socket, nullptr, nullptr);
+  if (fd == -1) {
+    return nullptr;
+  }
+
+  return std::unique_ptr<Channel>(new Channel(fd));
+}
+
+bool Channel::sendLine(const std::string &line)
+{
+  std::string data = line + "\n";
+  size_t sent = 0;
+
+  while (sent < data.size()) {
+    ssize_t ret = send(fd_, data.data() + sent, data.size() - sent, 
+        MSG_NOSIGNAL);
+    if (ret <= 0) return false;
+    sent += ret;
+  }
+
+  return true;
+}
+
+bool Channel::readLine(std::string &line)
+{
+  size_t pos;
+  char buf[BUFSIZE];
+
+  while ((pos = buffer_.find('\n')) == std::string::npos) {
+    ssize_t ret = recv(fd_, buf, sizeof(buf), 0);
+    if (ret <= 0) return false;
+    buffer_.append(buf, ret);
+  }
+
+  line = buffer_.substr(0, pos);
+  buffer_.erase(0, pos + 1);
+
+  return true;
+}
@@ -0,0 +1,54 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A TCP connection carrying lines of text, used by coordinator and
+// workers of a distributed replay to talk to each other.
+
+#ifndef LIBHDFSPP_CHANNEL_H_
+#define LIBHDFSPP_CHANNEL_H_
+
+#include <memory>
+#include <string>
+
+namespace hdfs
+{
+
+class Channel
+{
+ public:
+  Channel(int fd);
+  virtual ~Channel();
+
+  static std::unique_ptr<Channel> connect(const std::string &host, int port);
+  static int listen(int port);        //returns socket or -1
+  static std::unique_ptr<Channel> accept(int socket);
+
+  bool sendLine(const std::string &line);
+  bool readLine(std::string &line);   //without trailing new line
+
+ private:
+  Channel(const Channel&);
+  Channel& operator=(const Channel&);
+
+  int fd_;
+  std::string buffer_;
+};
+
+} /* hdfs */ 
+
+#endif
@@ -0,0 +1,59 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ClientGate.h"
+
+using namespace hdfs;
+
+ClientGate::ClientGate(unsigned clients, long think_time)
+  : think_time_(think_time)
+{
+  for (unsigned i = 0; i < clients; ++i) {
+    ready_.push(Clock::now());
+  }
+}
+
+ClientGate::~ClientGate()
+{
+}
+
+void ClientGate::enter()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (true) {
+    free_.wait(lock, [this] { return !ready_.empty(); });
+
+    // a client that finishes meanwhile may be ready sooner
+    auto at = ready_.top();
+    if (at <= Clock::now()) {
+      ready_.pop();
+      return;
+    }
+    free_.wait_until(lock, at);
+  }
+}
+
+void ClientGate::leave()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ready_.push(Clock::now() + std::chrono::nanoseconds(think_time_));
+  }
+  free_.notify_one();
+}
@@ -0,0 +1,59 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// ClientGate runs a closed loop load with a fixed number of virtual
+// clients. Every operation is sent by a free client, which is busy
+// until the operation is done and then thinks for a while before it
+// sends the next one. When all clients are busy or thinking the next
+// operation waits, so offered load follows how fast operations finish.
+
+#ifndef LIBHDFSPP_CLIENTGATE_H_
+#define LIBHDFSPP_CLIENTGATE_H_
+
+#include <chrono>
+#include <mutex>
+#include <queue>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+namespace hdfs
+{
+
+class ClientGate
+{
+ public:
+  ClientGate(unsigned clients, long think_time);  //think time in ns
+  virtual ~ClientGate();
+
+  void enter();   //block until a client is free and done thinking
+  void leave();   //the client starts to think
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  long think_time_;
+  std::mutex mutex_;
+  std::condition_variable free_;
+  std::priority_queue<Clock::time_point, std::vector<Clock::time_point>, 
+    std::greater<Clock::time_point>> ready_;  //when idle clients may go
+};
+
+} /* hdfs */ 
+
+#endif
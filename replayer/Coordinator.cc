@@ -0,0 +1,231 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <unistd.h>
+
+#include "Coordinator.h"
+#include "LogReader.h"
+
+#define PING_ROUNDS 16
+#define START_DELAY (1000L * 1000000)   //leave workers 1s to get ready
+
+using namespace hdfs;
+
+long hdfs::wallClock()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+Coordinator::Coordinator(int port, int workers)
+  : port_(port)
+  , workers_(workers > 0 ? workers : 1)
+{
+  for (auto &worker : workers_) {
+    worker.records = 0;
+    worker.offset = 0;
+    worker.rtt = 0;
+  }
+}
+
+Coordinator::~Coordinator()
+{
+}
+
+bool Coordinator::run(const char* logPath, ReplayStats &stats)
+{
+  if (!countThreads(logPath)) {
+    std::cerr << "Failed to read log " << logPath << std::endl;
+    return false;
+  }
+  partition();
+
+  std::cout << "Waiting for " << workers_.size() << " workers on port ";
+  std::cout << port_ << "." << std::endl;
+  if (!acceptWorkers()) {
+    std::cerr << "Failed to accept workers." << std::endl;
+    return false;
+  }
+
+  for (int rank = 0; rank < (int)workers_.size(); ++rank) {
+    if (!assign(rank) || !syncClock(workers_[rank])) {
+      std::cerr << "Lost worker #" << rank << std::endl;
+      return false;
+    }
+  }
+
+  long start = wallClock() + START_DELAY;
+  for (auto &worker : workers_) {
+    if (!worker.channel->sendLine("START " + std::to_string(start + worker.offset))) {
+      return false;
+    }
+  }
+  std::cout << "Start replaying file operations." << std::endl;
+
+  bool ok = true;
+  for (int rank = 0; rank < (int)workers_.size(); ++rank) {
+    if (!collect(rank, stats)) {
+      std::cerr << "Failed to get results of worker #" << rank << std::endl;
+      ok = false;
+    }
+  }
+
+  return ok;
+}
+
+/* Count records of every traced thread */
+bool Coordinator::countThreads(const char* logPath)
+{
+  LogReader reader(logPath);
+  std::unique_ptr<hadoop::hdfs::log> msg;
+  std::unordered_map<long, long> counts;
+
+  while ((msg = reader.next()) != nullptr) {
+    counts[msg->threadid()]++;
+  }
+
+  bool eof = reader.isEOF();
+  reader.close();
+  if (!eof) {
+    return false;
+  }
+
+  for (auto &count : counts) {
+    threads_.push_back(std::make_pair(count.second, count.first));
+  }
+
+  return true;
+}
+
+bool Coordinator::acceptWorkers()
+{
+  int socket = Channel::listen(port_);
+  if (socket == -1) {
+    return false;
+  }
+
+  std::string line;
+  for (auto &worker : workers_) {
+    worker.channel = Channel::accept(socket);
+    if (worker.channel == nullptr 
+        || !worker.channel->readLine(line) || line != "HELLO") {
+      close(socket);
+      return false;
+    }
+  }
+
+  close(socket);
+  return true;
+}
+
+/* Busiest thread goes first to the least loaded worker */
+void Coordinator::partition()
+{
+  std::sort(threads_.begin(), threads_.end(), 
+      [](const std::pair<long, long> &l, const std::pair<long, long> &r) {
+        return l.first > r.first;
+      });
+
+  for (auto &thread : threads_) {
+    auto least = std::min_element(workers_.begin(), workers_.end(), 
+        [](const Worker &l, const Worker &r) { return l.records < r.records; });
+
+    least->threads.push_back(thread.second);
+    least->records += thread.first;
+  }
+}
+
+bool Coordinator::assign(int rank)
+{
+  Worker &worker = workers_[rank];
+  std::ostringstream threads;
+
+  threads << "THREADS " << worker.threads.size();
+  for (long thread : worker.threads) {
+    threads << " " << thread;
+  }
+
+  std::cout << "Worker #" << rank << ": " << worker.threads.size();
+  std::cout << " threads, " << worker.records << " records." << std::endl;
+
+  return worker.channel->sendLine("ASSIGN " + std::to_string(rank) + " " 
+      + std::to_string(workers_.size())) 
+    && worker.channel->sendLine(threads.str());
+}
+
+/* Keep the estimate from the round trip least disturbed by delays */
+bool Coordinator::syncClock(Worker &worker)
+{
+  worker.rtt = -1;
+
+  for (int i = 0; i < PING_ROUNDS; ++i) {
+    std::string line, kind;
+    long sent = wallClock(), echoed, remote;
+
+    if (!worker.channel->sendLine("PING " + std::to_string(sent))) return false;
+    if (!worker.channel->readLine(line)) return false;
+    long received = wallClock();
+
+    std::istringstream fields(line);
+    if (!(fields >> kind >> echoed >> remote) || kind != "PONG" || echoed != sent) {
+      return false;
+    }
+
+    long rtt = received - sent;
+    if (worker.rtt == -1 || rtt < worker.rtt) {
+      worker.rtt = rtt;
+      worker.offset = remote - (sent + rtt / 2);
+    }
+  }
+
+  return true;
+}
+
+bool Coordinator::collect(int rank, ReplayStats &stats)
+{
+  Worker &worker = workers_[rank];
+  std::ostringstream result;
+  std::string line;
+
+  if (!worker.channel->readLine(line) || line != "RESULT") {
+    return false;
+  }
+  do {
+    if (!worker.channel->readLine(line)) return false;
+    result << line << "\n";
+  } while (line != "end");
+
+  std::istringstream in(result.str());
+  ReplayStats worker_stats(1);
+  if (!worker_stats.load(in)) {
+    return false;
+  }
+
+  std::cout << "Worker #" << rank << ": " << worker_stats.operations();
+  std::cout << " operations in " << worker_stats.elapsed() << " seconds, ";
+  std::cout << "clock offset " << worker.offset / 1000 << " us, ";
+  std::cout << "round trip " << worker.rtt / 1000 << " us." << std::endl;
+
+  std::istringstream again(result.str());
+  return stats.load(again);
+}
@@ -0,0 +1,89 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Coordinator of a distributed replay. It splits a merged log among
+// worker processes by traced thread, so every worker replays the
+// operations of a set of original threads, starts all workers at the
+// same moment and puts their results together.
+//
+// Coordinator and workers talk over TCP in lines of text:
+//
+//   worker       coordinator
+//   HELLO    ->
+//            <-  ASSIGN <rank> <workers>
+//            <-  THREADS <n> <thread id> ...
+//            <-  PING <coordinator time>               (repeated)
+//   PONG <coordinator time> <worker time> ->
+//            <-  START <start time in worker clock>
+//   ... replay ...
+//   RESULT   ->
+//   <lines of ReplayStats::save> ->
+//
+// Times are wall clock nanoseconds since epoch. The offset of a worker's
+// clock is estimated from the PING with the shortest round trip, and
+// the start time is sent in the worker's own clock, so the start
+// barrier holds even if clocks of the hosts differ.
+//
+// Threads are given out greedily, the busiest thread first to the
+// worker with fewest records, which keeps workers evenly loaded.
+
+#ifndef LIBHDFSPP_COORDINATOR_H_
+#define LIBHDFSPP_COORDINATOR_H_
+
+#include <vector>
+
+#include "Channel.h"
+#include "ReplayStats.h"
+
+namespace hdfs
+{
+
+class Coordinator
+{
+ public:
+  Coordinator(int port, int workers);
+  virtual ~Coordinator();
+
+  bool run(const char* logPath, ReplayStats &stats);
+
+ private:
+  struct Worker {
+    std::unique_ptr<Channel> channel;
+    std::vector<long> threads;
+    long records;
+    long offset;      //worker clock minus coordinator clock
+    long rtt;
+  };
+
+  bool countThreads(const char* logPath);
+  bool acceptWorkers();
+  void partition();
+  bool assign(int rank);
+  bool syncClock(Worker &worker);
+  bool collect(int rank, ReplayStats &stats);
+
+  int port_;
+  std::vector<Worker> workers_;
+  std::vector<std::pair<long, long>> threads_;   //records and thread id
+};
+
+long wallClock();     //wall clock time in nanosecond
+
+} /* hdfs */ 
+
+#endif
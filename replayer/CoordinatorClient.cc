@@ -0,0 +1,122 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdlib>
+#include <sstream>
+#include <iostream>
+
+#include "Coordinator.h"
+#include "CoordinatorClient.h"
+
+using namespace hdfs;
+
+CoordinatorClient::CoordinatorClient()
+  : rank_(-1)
+  , threads_(new std::unordered_set<long>())
+  , start_(0)
+{
+}
+
+CoordinatorClient::~CoordinatorClient()
+{
+}
+
+bool CoordinatorClient::join(const std::string &address)
+{
+  size_t colon = address.rfind(':');
+  if (colon == std::string::npos) {
+    std::cerr << "Coordinator address must be host:port." << std::endl;
+    return false;
+  }
+
+  channel_ = Channel::connect(address.substr(0, colon), 
+      std::atoi(address.substr(colon + 1).c_str()));
+  if (channel_ == nullptr || !channel_->sendLine("HELLO")) {
+    std::cerr << "Failed to connect to coordinator " << address << std::endl;
+    return false;
+  }
+
+  std::string line;
+  while (channel_->readLine(line)) {
+    std::istringstream fields(line);
+    std::string kind;
+    fields >> kind;
+
+    if (kind == "ASSIGN") {
+      int workers;
+      if (!(fields >> rank_ >> workers)) break;
+      std::cout << "Joined as worker #" << rank_ << " of " << workers;
+      std::cout << "." << std::endl;
+    } else if (kind == "THREADS") {
+      long count, thread;
+      if (!(fields >> count)) break;
+      for (long i = 0; i < count && fields >> thread; ++i) {
+        threads_->insert(thread);
+      }
+    } else if (kind == "PING") {
+      std::string sent;
+      fields >> sent;
+      if (!channel_->sendLine("PONG " + sent + " " + std::to_string(wallClock()))) {
+        break;
+      }
+    } else if (kind == "START") {
+      if (fields >> start_) return rank_ >= 0;
+      break;
+    } else {
+      break;
+    }
+  }
+
+  std::cerr << "Lost connection to coordinator." << std::endl;
+  return false;
+}
+
+bool CoordinatorClient::sendResults(const ReplayStats &stats)
+{
+  std::ostringstream result;
+  stats.save(result);
+
+  std::istringstream lines(result.str());
+  std::string line;
+
+  if (!channel_->sendLine("RESULT")) {
+    return false;
+  }
+  while (std::getline(lines, line)) {
+    if (!channel_->sendLine(line)) return false;
+  }
+
+  return true;
+}
+
+int CoordinatorClient::rank() const
+{
+  return rank_;
+}
+
+std::shared_ptr<const std::unordered_set<long>> CoordinatorClient::threads() const
+{
+  return threads_;
+}
+
+std::chrono::system_clock::time_point CoordinatorClient::start() const
+{
+  return std::chrono::system_clock::time_point(
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+        std::chrono::nanoseconds(start_)));
+}
@@ -0,0 +1,58 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The worker side of a distributed replay, see Coordinator.h for the
+// protocol. A worker joins the coordinator, learns which traced threads
+// it replays and when to start, and reports its results at the end.
+
+#ifndef LIBHDFSPP_COORDINATORCLIENT_H_
+#define LIBHDFSPP_COORDINATORCLIENT_H_
+
+#include <chrono>
+#include <memory>
+#include <unordered_set>
+
+#include "Channel.h"
+#include "ReplayStats.h"
+
+namespace hdfs
+{
+
+class CoordinatorClient
+{
+ public:
+  CoordinatorClient();
+  virtual ~CoordinatorClient();
+
+  bool join(const std::string &address);    //"host:port"
+  bool sendResults(const ReplayStats &stats);
+
+  int rank() const;
+  std::shared_ptr<const std::unordered_set<long>> threads() const;
+  std::chrono::system_clock::time_point start() const;
+
+ private:
+  std::unique_ptr<Channel> channel_;
+  int rank_;
+  std::shared_ptr<std::unordered_set<long>> threads_;
+  long start_;
+};
+
+} /* hdfs */ 
+
+#endif
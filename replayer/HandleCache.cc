@@ -0,0 +1,106 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HandleCache.h"
+
+using namespace hdfs;
+
+HandleCache::HandleCache(size_t capacity)
+  : capacity_(capacity)
+  , hits_(0)
+  , misses_(0)
+  , evictions_(0)
+{
+}
+
+HandleCache::~HandleCache()
+{
+}
+
+bool HandleCache::take(const std::string &path, ReplayBackend::File &file)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto found = paths_.find(path);
+  if (found == paths_.end()) {
+    misses_++;
+    return false;
+  }
+
+  file = found->second->second;
+  entries_.erase(found->second);
+  paths_.erase(found);
+  hits_++;
+  return true;
+}
+
+bool HandleCache::put(const std::string &path, ReplayBackend::File file, 
+    ReplayBackend::File &evicted)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  entries_.push_front(std::make_pair(path, file));
+  paths_.insert(std::make_pair(path, entries_.begin()));
+  if (entries_.size() <= capacity_) {
+    return false;
+  }
+
+  // the oldest entry is last, find it among entries of its path
+  auto oldest = std::prev(entries_.end());
+  auto range = paths_.equal_range(oldest->first);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == oldest) {
+      paths_.erase(it);
+      break;
+    }
+  }
+
+  evicted = oldest->second;
+  entries_.pop_back();
+  evictions_++;
+  return true;
+}
+
+std::list<ReplayBackend::File> HandleCache::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::list<ReplayBackend::File> files;
+
+  for (auto &entry : entries_) {
+    files.push_back(entry.second);
+  }
+  entries_.clear();
+  paths_.clear();
+
+  return files;
+}
+
+long HandleCache::hits() const
+{
+  return hits_;
+}
+
+long HandleCache::misses() const
+{
+  return misses_;
+}
+
+long HandleCache::evictions() const
+{
+  return evictions_;
+}
@@ -0,0 +1,69 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// HandleCache keeps files open after the log closes them, so that a
+// later open of the same path reuses the file instead of asking the
+// backend again. Least recently closed files are closed for real once
+// more than capacity files are kept. Comparing a replay with and
+// without the cache shows how much time goes into opening files.
+
+#ifndef LIBHDFSPP_HANDLECACHE_H_
+#define LIBHDFSPP_HANDLECACHE_H_
+
+#include <list>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <unordered_map>
+
+#include "ReplayBackend.h"
+
+namespace hdfs
+{
+
+class HandleCache
+{
+ public:
+  HandleCache(size_t capacity);
+  virtual ~HandleCache();
+
+  bool take(const std::string &path, ReplayBackend::File &file);
+  bool put(const std::string &path, ReplayBackend::File file, 
+      ReplayBackend::File &evicted);  //true if a file must be closed
+  std::list<ReplayBackend::File> clear();
+
+  long hits() const;
+  long misses() const;
+  long evictions() const;
+
+ private:
+  typedef std::pair<std::string, ReplayBackend::File> Entry;
+
+  size_t capacity_;
+  std::mutex mutex_;
+  std::list<Entry> entries_;    //most recently closed first
+  std::unordered_multimap<std::string, std::list<Entry>::iterator> paths_;
+  long hits_;
+  long misses_;
+  long evictions_;
+};
+
+} /* hdfs */ 
+
+#endif
@@ -0,0 +1,110 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <functional>
+
+#include "HandleTable.h"
+
+using namespace hdfs;
+
+HandleTable::Handle::Handle(ReplayBackend::File file, const std::string &path, 
+    int flags)
+  : file(file)
+  , path(path)
+  , flags(flags)
+  , refs(1)
+  , issued(0)
+  , served(0)
+{
+}
+
+HandleTable::HandleTable(unsigned shards)
+{
+  if (shards == 0) shards = 1;
+
+  for (unsigned i = 0; i < shards; ++i) {
+    shards_.push_back(std::unique_ptr<Shard>(new Shard()));
+  }
+}
+
+HandleTable::~HandleTable()
+{
+}
+
+HandleTable::HandlePtr HandleTable::create(ReplayBackend::File file, 
+    const std::string &path, int flags)
+{
+  return std::make_shared<Handle>(file, path, flags);
+}
+
+HandleTable::HandlePtr HandleTable::put(const Key &key, HandlePtr handle)
+{
+  Shard &shard = shardOf(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  HandlePtr &slot = shard.handles[key];
+  HandlePtr replaced = std::move(slot);
+  slot = std::move(handle);
+  return replaced;
+}
+
+HandleTable::HandlePtr HandleTable::acquire(const Key &key)
+{
+  Shard &shard = shardOf(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  auto handle = shard.handles.find(key);
+  if (handle == shard.handles.end()) {
+    return nullptr;
+  }
+
+  handle->second->refs++;
+  return handle->second;
+}
+
+HandleTable::HandlePtr HandleTable::remove(const Key &key)
+{
+  Shard &shard = shardOf(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  auto handle = shard.handles.find(key);
+  if (handle == shard.handles.end()) {
+    return nullptr;
+  }
+
+  HandlePtr removed = std::move(handle->second);
+  shard.handles.erase(handle);
+  return removed;
+}
+
+bool HandleTable::release(const HandlePtr &handle)
+{
+  return --handle->refs == 0;
+}
+
+size_t HandleTable::KeyHash::operator()(const Key &key) const
+{
+  // handles are addresses, drop the low bits that are always the same
+  size_t hash = std::hash<long>()(key.second >> 4);
+  return hash ^ (std::hash<int>()(key.first) * 0x9e3779b97f4a7c15UL);
+}
+
+HandleTable::Shard& HandleTable::shardOf(const Key &key)
+{
+  return *shards_[KeyHash()(key) % shards_.size()];
+}
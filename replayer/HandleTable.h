@@ -0,0 +1,97 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// HandleTable translates file handles recorded in the log into files
+// opened by replayer. It is split into shards, each with its own lock,
+// so that main thread adding and removing handles and workers looking
+// them up rarely wait for each other.
+//
+// A handle is reference counted: the table holds one reference and
+// every call in flight on the file holds another. Removing a handle on
+// CLOSE only drops the table's reference, and whoever drops the last
+// reference closes the file, so a close waits for the calls on its own
+// file rather than for every call in flight. Reads are positioned and
+// may run at once; writes, flushes, hsyncs and seeks use the position
+// of the stream, so each takes a ticket when it is handed out and waits
+// for its turn, which keeps them in the order of the log. A handle
+// put over another key gives the caller the table's reference to the
+// one it replaces, so that its file can be closed.
+
+#ifndef LIBHDFSPP_HANDLETABLE_H_
+#define LIBHDFSPP_HANDLETABLE_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "ReplayBackend.h"
+
+namespace hdfs
+{
+
+class HandleTable
+{
+ public:
+  typedef std::pair<int, long> Key;   //tenant and handle in the log
+
+  struct Handle {
+    ReplayBackend::File file;
+    std::string path;
+    int flags;                //of open
+    std::atomic<int> refs;
+    long issued;              //stream calls handed out, by main thread
+    long served;              //stream calls done, guarded by stream
+    std::mutex stream;
+    std::condition_variable turn;
+
+    Handle(ReplayBackend::File file, const std::string &path, int flags);
+  };
+  typedef std::shared_ptr<Handle> HandlePtr;
+
+  HandleTable(unsigned shards);
+  virtual ~HandleTable();
+
+  HandlePtr create(ReplayBackend::File file, const std::string &path, 
+      int flags);
+  HandlePtr put(const Key &key, HandlePtr handle); //gives back the one replaced
+  HandlePtr acquire(const Key &key);  //take a reference for a call
+  HandlePtr remove(const Key &key);   //caller gets the table's reference
+  static bool release(const HandlePtr &handle); //true if it was the last
+
+ private:
+  struct KeyHash {
+    size_t operator()(const Key &key) const;
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<Key, HandlePtr, KeyHash> handles;
+  };
+
+  Shard& shardOf(const Key &key);
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+} /* hdfs */ 
+
+#endif
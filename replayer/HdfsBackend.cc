@@ -0,0 +1,110 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cerrno>
+
+#include "HdfsBackend.h"
+
+using namespace hdfs;
+
+HdfsBackend::HdfsBackend()
+  : fs_(nullptr)
+{
+}
+
+HdfsBackend::~HdfsBackend()
+{
+  if (fs_ != nullptr) {
+    hdfsDisconnect(fs_);
+    fs_ = nullptr;
+  }
+}
+
+bool HdfsBackend::connect(const char* host, int port)
+{
+  fs_ = hdfsConnect(host, port);
+  return fs_ != nullptr;
+}
+
+ReplayBackend::File HdfsBackend::open(const std::string &path, int flags, 
+    int bufferSize, short replication, int blockSize)
+{
+  hdfsFile file = hdfsOpenFile(fs_, path.c_str(), 
+      flags, bufferSize, replication, blockSize);
+
+  return file == nullptr ? BAD_FILE : reinterpret_cast<File>(file);
+}
+
+long HdfsBackend::pread(File file, long offset, char* buffer, size_t length)
+{
+  return hdfsPread(fs_, reinterpret_cast<hdfsFile>(file), 
+      (off_t)offset, 
+      reinterpret_cast<void*>(buffer), 
+      length);
+}
+
+int HdfsBackend::close(File file)
+{
+  return hdfsCloseFile(fs_, reinterpret_cast<hdfsFile>(file));
+}
+
+long HdfsBackend::write(File file, const char* buffer, size_t length)
+{
+  return hdfsWrite(fs_, reinterpret_cast<hdfsFile>(file), 
+      reinterpret_cast<const void*>(buffer), 
+      length);
+}
+
+int HdfsBackend::flush(File file)
+{
+  return hdfsFlush(fs_, reinterpret_cast<hdfsFile>(file));
+}
+
+int HdfsBackend::hsync(File file)
+{
+  return hdfsHSync(fs_, reinterpret_cast<hdfsFile>(file));
+}
+
+int HdfsBackend::seek(File file, long offset)
+{
+  return hdfsSeek(fs_, reinterpret_cast<hdfsFile>(file), (off_t)offset);
+}
+
+int HdfsBackend::getFileInfo(const std::string &path)
+{
+  hdfsFileInfo* info = hdfsGetPathInfo(fs_, path.c_str());
+  if (info == nullptr) {
+    return -1;
+  }
+
+  hdfsFreeFileInfo(info, 1);
+  return 0;
+}
+
+long HdfsBackend::listDir(const std::string &path)
+{
+  int entries = 0;
+  errno = 0;
+  hdfsFileInfo* infos = hdfsListDirectory(fs_, path.c_str(), &entries);
+  if (infos == nullptr) {
+    return errno == 0 ? 0 : -1;   //an empty directory has no list
+  }
+
+  hdfsFreeFileInfo(infos, entries);
+  return entries;
+}
@@ -0,0 +1,55 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays file operations against HDFS through libhdfs++.
+
+#ifndef LIBHDFSPP_HDFSBACKEND_H_
+#define LIBHDFSPP_HDFSBACKEND_H_
+
+#include "libhdfs++/chdfs.h"
+#include "ReplayBackend.h"
+
+namespace hdfs
+{
+
+class HdfsBackend : public ReplayBackend
+{
+ public:
+  HdfsBackend();
+  virtual ~HdfsBackend();
+
+  bool connect(const char* host, int port);
+
+  virtual File open(const std::string &path, int flags, int bufferSize, 
+      short replication, int blockSize);
+  virtual long pread(File file, long offset, char* buffer, size_t length);
+  virtual int close(File file);
+  virtual long write(File file, const char* buffer, size_t length);
+  virtual int flush(File file);
+  virtual int hsync(File file);
+  virtual int seek(File file, long offset);
+  virtual int getFileInfo(const std::string &path);
+  virtual long listDir(const std::string &path);
+
+ private:
+  hdfsFS fs_;
+};
+
+} /* hdfs */ 
+
+#endif
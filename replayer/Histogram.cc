@@ -0,0 +1,206 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <limits>
+
+#include "Histogram.h"
+
+#define SUB_BITS 5
+#define SUB_BUCKETS (1 << SUB_BITS)
+#define NUM_BUCKETS ((64 - SUB_BITS + 1) * SUB_BUCKETS)
+
+using namespace hdfs;
+
+Histogram::Histogram()
+  : buckets_(NUM_BUCKETS, 0)
+  , count_(0)
+  , min_(std::numeric_limits<uint64_t>::max())
+  , max_(0)
+  , sum_(0)
+{
+}
+
+Histogram::~Histogram()
+{
+}
+
+void Histogram::record(long value)
+{
+  uint64_t v = value < 0 ? 0 : (uint64_t)value;
+
+  buckets_[bucketOf(v)]++;
+  count_++;
+  sum_ += v;
+  if (v < min_) min_ = v;
+  if (v > max_) max_ = v;
+}
+
+void Histogram::merge(const Histogram &other)
+{
+  for (int i = 0; i < NUM_BUCKETS; ++i) {
+    buckets_[i] += other.buckets_[i];
+  }
+
+  count_ += other.count_;
+  sum_ += other.sum_;
+  if (other.min_ < min_) min_ = other.min_;
+  if (other.max_ > max_) max_ = other.max_;
+}
+
+void Histogram::reset()
+{
+  buckets_.assign(NUM_BUCKETS, 0);
+  count_ = 0;
+  min_ = std::numeric_limits<uint64_t>::max();
+  max_ = 0;
+  sum_ = 0;
+}
+
+/* Only non-empty buckets are saved, as "index:count" pairs */
+void Histogram::save(std::ostream &out) const
+{
+  int used = 0;
+  for (int i = 0; i < NUM_BUCKETS; ++i) {
+    if (buckets_[i] > 0) used++;
+  }
+
+  out << count_ << " " << min_ << " " << max_ << " " << (uint64_t)sum_;
+  out << " " << used;
+  for (int i = 0; i < NUM_BUCKETS; ++i) {
+    if (buckets_[i] > 0) out << " " << i << ":" << buckets_[i];
+  }
+}
+
+bool Histogram::load(std::istream &in)
+{
+  Histogram other;
+  uint64_t sum;
+  int used;
+
+  if (!(in >> other.count_ >> other.min_ >> other.max_ >> sum >> used)) {
+    return false;
+  }
+  other.sum_ = sum;
+
+  for (int i = 0; i < used; ++i) {
+    int bucket;
+    char colon;
+    uint64_t count;
+
+    if (!(in >> bucket >> colon >> count) || colon != ':') return false;
+    if (bucket < 0 || bucket >= NUM_BUCKETS) return false;
+    other.buckets_[bucket] = count;
+  }
+
+  merge(other);
+  return true;
+}
+
+uint64_t Histogram::count() const
+{
+  return count_;
+}
+
+long Histogram::min() const
+{
+  return count_ == 0 ? 0 : (long)min_;
+}
+
+long Histogram::max() const
+{
+  return (long)max_;
+}
+
+double Histogram::mean() const
+{
+  return count_ == 0 ? 0 : sum_ / count_;
+}
+
+long Histogram::percentile(double p) const
+{
+  if (count_ == 0) {
+    return 0;
+  }
+
+  // rank of the wanted value, counting from 1
+  uint64_t rank = (uint64_t)(p / 100 * count_ + 0.5);
+  if (rank < 1) rank = 1;
+  if (rank >= count_) return (long)max_;
+
+  uint64_t seen = 0;
+  for (int i = 0; i < NUM_BUCKETS; ++i) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      uint64_t value = valueOf(i);
+      if (value < min_) value = min_;
+      if (value > max_) value = max_;
+      return (long)value;
+    }
+  }
+
+  return (long)max_;
+}
+
+/* Largest gap between the cumulative shares of both histograms at any
+ * bucket, the Kolmogorov-Smirnov statistic of their distributions */
+double Histogram::distance(const Histogram &other) const
+{
+  if (count_ == 0 || other.count_ == 0) {
+    return 0;
+  }
+
+  uint64_t seen = 0, other_seen = 0;
+  double largest = 0;
+  for (int i = 0; i < NUM_BUCKETS; ++i) {
+    seen += buckets_[i];
+    other_seen += other.buckets_[i];
+    double gap = (double)seen / count_ - (double)other_seen / other.count_;
+    if (gap < 0) gap = -gap;
+    if (gap > largest) largest = gap;
+  }
+
+  return largest;
+}
+
+/* Values below 2^SUB_BITS get their own bucket, larger values share a
+ * bucket with values having the same leading SUB_BITS + 1 bits. */
+int Histogram::bucketOf(uint64_t value)
+{
+  if (value < SUB_BUCKETS) {
+    return (int)value;
+  }
+
+  int exponent = 63 - __builtin_clzll(value);
+  int shift = exponent - SUB_BITS;
+  int sub = (int)((value >> shift) - SUB_BUCKETS);
+
+  return (shift + 1) * SUB_BUCKETS + sub;
+}
+
+/* Middle of the value range covered by a bucket */
+uint64_t Histogram::valueOf(int bucket)
+{
+  if (bucket < SUB_BUCKETS) {
+    return bucket;
+  }
+
+  int shift = bucket / SUB_BUCKETS - 1;
+  uint64_t low = (uint64_t)(bucket % SUB_BUCKETS + SUB_BUCKETS) << shift;
+
+  return low + (((uint64_t)1 << shift) >> 1);
+}
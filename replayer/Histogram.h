@@ -0,0 +1,70 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A fixed size log-linear histogram for non-negative values such as
+// latencies in nanosecond. Every power of two is split into 32 linear
+// sub-buckets, so any recorded value can be recovered with a relative
+// error below 3% while the whole histogram stays in 16KB of memory,
+// no matter how many values are recorded. Histogram is not thread
+// safe; each thread should record into its own copy and merge them
+// afterwards.
+
+#ifndef LIBHDFSPP_HISTOGRAM_H_
+#define LIBHDFSPP_HISTOGRAM_H_
+
+#include <cstdint>
+#include <vector>
+#include <istream>
+#include <ostream>
+
+namespace hdfs
+{
+
+class Histogram
+{
+ public:
+  Histogram();
+  virtual ~Histogram();
+
+  void record(long value);            //negative values are counted as 0
+  void merge(const Histogram &other);
+  void reset();
+  void save(std::ostream &out) const;   //one line of text
+  bool load(std::istream &in);          //merge a saved histogram
+
+  uint64_t count() const;
+  long min() const;
+  long max() const;
+  double mean() const;
+  long percentile(double p) const;    //p is in [0, 100]
+  double distance(const Histogram &other) const;
+
+ private:
+  static int bucketOf(uint64_t value);
+  static uint64_t valueOf(int bucket);
+
+  std::vector<uint64_t> buckets_;
+  uint64_t count_;
+  uint64_t min_;
+  uint64_t max_;
+  double sum_;
+};
+
+} /* hdfs */ 
+
+#endif
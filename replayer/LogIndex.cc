@@ -0,0 +1,191 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fstream>
+#include <algorithm>
+#include <sys/stat.h>
+
+#include "LogIndex.h"
+#include "LogReader.h"
+
+#define INDEX_MAGIC "libhdfspp-log-index"
+#define INDEX_VERSION 2
+
+using namespace hdfs;
+
+LogIndex::LogIndex()
+  : start_date_(0)
+  , start_time_(0)
+  , first_(0)
+  , size_(0)
+{
+}
+
+LogIndex::~LogIndex()
+{
+}
+
+/* FNV-1a, to be the same wherever the index is read */
+static uint64_t hashOf(const std::string &record)
+{
+  uint64_t hash = 14695981039346656037ULL;
+
+  for (unsigned char c : record) {
+    hash = (hash ^ c) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+std::string LogIndex::pathOf(const std::string &log)
+{
+  return log + ".idx";
+}
+
+bool LogIndex::build(const std::string &log, long block)
+{
+  LogReader reader(log.c_str());
+  std::string record;
+  hadoop::hdfs::log msg;
+  long records = 0;
+  long in_block = 0;
+  long last = -1;
+  TraceClock clock;
+
+  entries_.clear();
+  while (true) {
+    long offset = reader.offset();
+    if (!reader.nextRaw(record)) break;
+    if (!msg.ParseFromString(record)) {
+      reader.close();
+      return false;
+    }
+    if (records == 0) first_ = hashOf(record);
+
+    // the return of a compact op is at the offset of its call, and a
+    // block can only start where a record of its own does
+    long time = clock.since(msg);
+    records++;
+    if (entries_.empty() || (in_block >= block && offset != last)) {
+      entries_.push_back(Entry{offset, time, time});
+      in_block = 0;
+    } else {
+      entries_.back().min_time = std::min(entries_.back().min_time, time);
+      entries_.back().max_time = std::max(entries_.back().max_time, time);
+    }
+    in_block++;
+    last = offset;
+  }
+
+  bool ok = reader.isEOF();
+  size_ = reader.offset();
+  start_date_ = clock.startDate();
+  start_time_ = clock.startTime();
+  reader.close();
+
+  return ok;
+}
+
+bool LogIndex::save(const std::string &path) const
+{
+  std::ofstream out(path.c_str());
+
+  out << INDEX_MAGIC << " " << INDEX_VERSION << " " << size_ << " ";
+  out << start_date_ << " " << start_time_ << " " << first_ << " ";
+  out << entries_.size() << "\n";
+  for (auto &entry : entries_) {
+    out << entry.offset << " " << entry.min_time << " ";
+    out << entry.max_time << "\n";
+  }
+  out.close();
+
+  return !out.fail();
+}
+
+/* An index of a log that shrank, or whose first record is not the
+ * one of the log, is rejected */
+bool LogIndex::load(const std::string &path, const std::string &log)
+{
+  std::ifstream in(path.c_str());
+  std::string magic;
+  int version;
+  size_t count;
+  struct stat info;
+
+  if (!(in >> magic >> version >> size_ >> start_date_ >> start_time_ 
+        >> first_ >> count) 
+      || magic != INDEX_MAGIC || version != INDEX_VERSION) {
+    return false;
+  }
+  if (stat(log.c_str(), &info) != 0 || info.st_size < size_) {
+    return false;
+  }
+
+  LogReader reader(log.c_str());
+  std::string record;
+  hadoop::hdfs::log msg;
+  bool same = reader.nextRaw(record) && msg.ParseFromString(record) 
+    && msg.date() == start_date_ && msg.time() == start_time_ 
+    && hashOf(record) == first_;
+  reader.close();
+  if (size_ > 0 && !same) {
+    return false;
+  }
+
+  entries_.resize(count);
+  for (auto &entry : entries_) {
+    if (!(in >> entry.offset >> entry.min_time >> entry.max_time)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int LogIndex::startDate() const
+{
+  return start_date_;
+}
+
+long LogIndex::startTime() const
+{
+  return start_time_;
+}
+
+/* Records of later blocks may still be earlier than time when the log
+ * is not quite in order, so the first block reaching it is taken. */
+long LogIndex::offsetBefore(long time) const
+{
+  for (auto &entry : entries_) {
+    if (entry.max_time >= time) {
+      return entry.offset;
+    }
+  }
+
+  return entries_.empty() ? 0 : size_;
+}
+
+long LogIndex::timeAt(long offset) const
+{
+  for (auto &entry : entries_) {
+    if (entry.offset == offset) {
+      return entry.min_time;
+    }
+  }
+
+  return 0;
+}
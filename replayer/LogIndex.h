@@ -0,0 +1,74 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// LogIndex is a sparse index of a log kept next to it as <log>.idx. It
+// has an entry for every block of records: where the block starts in
+// the file, and the earliest and latest time of its records counted
+// from the first record of the log. Tools can then seek straight to the
+// part of a log they need instead of reading it from the start. Times
+// are bounded per block, so slightly unordered logs are indexed right.
+//
+// The index records how large the log was, and the time and a hash of
+// its first record. It stays usable for the part indexed if the log has
+// grown since; an index whose first record is not that of the log, as
+// when the log was written again, is rejected.
+
+#ifndef LIBHDFSPP_LOGINDEX_H_
+#define LIBHDFSPP_LOGINDEX_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace hdfs
+{
+
+class LogIndex
+{
+ public:
+  struct Entry {
+    long offset;
+    long min_time;
+    long max_time;
+  };
+
+  LogIndex();
+  virtual ~LogIndex();
+
+  static std::string pathOf(const std::string &log);
+
+  bool build(const std::string &log, long block);  //records per entry
+  bool save(const std::string &path) const;
+  bool load(const std::string &path, const std::string &log);
+
+  int startDate() const;
+  long startTime() const;
+  long offsetBefore(long time) const; //start of first block reaching time
+  long timeAt(long offset) const;     //earliest of the block at offset
+
+ private:
+  int start_date_;
+  long start_time_;
+  uint64_t first_;      //hash of the first record
+  long size_;           //of the log indexed
+  std::vector<Entry> entries_;
+};
+
+} /* hdfs */ 
+
+#endif
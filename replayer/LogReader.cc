@@ -17,12 +17,14 @@
  */
 
 #include <fcntl.h>
+#include <cstring>
 #include <unistd.h>
 #include <google/protobuf/io/coded_stream.h>
 
 #include "LogReader.h"
 
 #define BUFSIZE 32
+#define NS_PER_DAY (24L * 3600 * 1000000000)
 
 using namespace hdfs;
 namespace pbio = ::google::protobuf::io;
@@ -30,7 +32,13 @@ namespace pbio = ::google::protobuf::io;
 LogReader::LogReader()
   : isOK_(false)
   , isEOF_(false)
+  , compact_(false)
+  , logFd_(-1)
+  , base_(0)
   , logFile_(nullptr)
+  , held_()
+  , holding_(false)
+  , held_offset_(0)
 {
 }
 
@@ -68,7 +76,25 @@ bool LogReader::setPath(const char* logPath)
   if (logFd == -1) {
     return false;
   }
+  // the first record of a log is never empty, so the header of a
+  // compact log can not be mistaken for one
+  const size_t magic = std::strlen(COMPACT_MAGIC);
+  std::string header(2 + magic, '\0');
+  compact_ = pread(logFd, &header[0], header.size(), 0) == (ssize_t)header.size() 
+    && header[0] == 0 && (size_t)header[1] == magic 
+    && header.compare(2, magic, COMPACT_MAGIC) == 0;
+  base_ = compact_ ? header.size() : 0;
+  if (lseek(logFd, base_, SEEK_SET) != base_) {
+    ::close(logFd);
+    return false;
+  }
+
+  logFd_ = logFd;
   logFile_ = new pbio::FileInputStream(logFd);
+  isOK_ = true;
+  isEOF_ = false;
+  holding_ = false;
+  joiner_.reset();
 
   return true;
 }
@@ -78,23 +104,226 @@ std::unique_ptr<hadoop::hdfs::log> LogReader::next()
   if (isEOF_ || (!isOK_)) {
     return nullptr;
   }
+  if (compact_) {
+    return nextSplit();
+  }
   
+  std::unique_ptr<hadoop::hdfs::log> msg(new hadoop::hdfs::log());
+  if (!read(*msg)) return nullptr;
+   
+  return msg;
+}
+
+/* Call of the next op of a compact log, then its return */
+std::unique_ptr<hadoop::hdfs::log> LogReader::nextSplit()
+{
+  std::unique_ptr<hadoop::hdfs::log> msg(new hadoop::hdfs::log());
+  if (holding_) {
+    msg->Swap(&held_);
+    holding_ = false;
+    return msg;
+  }
+
+  hadoop::hdfs::op op;
+  held_offset_ = offset();
+  if (!read(op)) return nullptr;
+
+  bool has_call;
+  OpJoiner::split(op, *msg, has_call, held_, holding_);
+  if (!has_call) {
+    msg->Swap(&held_);    //a return without its call
+    holding_ = false;
+  }
+  return msg;
+}
+
+/* Next op of a compact log, or the next call of a log joined with its
+ * return. The records of a log are read ahead until the call's return
+ * is in, and calls in flight at the end come without one. */
+bool LogReader::nextOp(hadoop::hdfs::op &op)
+{
+  if (!isOK_) {
+    return false;
+  }
+  if (compact_) {
+    return !isEOF_ && read(op);
+  }
+
+  if (joiner_ == nullptr) {
+    joiner_.reset(new OpJoiner());
+  }
+  while (!joiner_->pop(op)) {
+    hadoop::hdfs::log msg;
+    if (isEOF_ || !read(msg)) {
+      if (!isEOF_) return false;    //not a record
+      joiner_->finish();
+      return joiner_->pop(op);
+    }
+    joiner_->push(msg);
+  }
+
+  return true;
+}
+
+bool LogReader::isCompact() const
+{
+  return compact_;
+}
+
+/* Sets EOF at a clean end of file, returns false without it if the
+ * record is cut short or does not parse */
+bool LogReader::read(::google::protobuf::Message &msg)
+{
   pbio::CodedInputStream input(logFile_);
   uint32_t size;
 
   if (!input.ReadVarint32(&size)) {
     isEOF_ = true;
-    return nullptr;
+    return false;
   }
   
   pbio::CodedInputStream::Limit limit = input.PushLimit(size);
-  std::unique_ptr<hadoop::hdfs::log> msg(new hadoop::hdfs::log());
-  
-  if (!msg->MergeFromCodedStream(&input)) return nullptr;
-  if (!input.ConsumedEntireMessage()) return nullptr; 
-
+  msg.Clear();
+  if (!msg.MergeFromCodedStream(&input)) return false;
+  if (!input.ConsumedEntireMessage()) return false; 
   input.PopLimit(limit);
-   
-  return msg;
+
+  return true;
 }
 
+/* Cut the next record out of the log without parsing it, so that
+ * parsing can be left to other threads. */
+bool LogReader::nextRaw(std::string &record)
+{
+  if (isEOF_ || (!isOK_)) {
+    return false;
+  }
+  if (compact_) {
+    auto msg = nextSplit();
+    return msg != nullptr && msg->SerializeToString(&record);
+  }
+
+  pbio::CodedInputStream input(logFile_);
+  uint32_t size;
+
+  if (!input.ReadVarint32(&size)) {
+    isEOF_ = true;
+    return false;
+  }
+
+  return input.ReadString(&record, size);
+}
+
+long LogReader::offset() const
+{
+  if (logFile_ == nullptr) {
+    return 0;
+  }
+  if (holding_) {
+    return held_offset_;
+  }
+
+  return base_ + logFile_->ByteCount();
+}
+
+/* Start reading again from another place of the file. The stream does
+ * not own the file, so it is replaced without closing the file. */
+bool LogReader::seek(long offset)
+{
+  long header = 2 + std::strlen(COMPACT_MAGIC);
+  if (compact_ && offset < header) {
+    offset = header;    //the start of a compact log is its first op
+  }
+  if (!isOK_ || lseek(logFd_, offset, SEEK_SET) != offset) {
+    return false;
+  }
+
+  delete logFile_;
+  logFile_ = new pbio::FileInputStream(logFd_);
+  base_ = offset;
+  isEOF_ = false;
+  holding_ = false;
+  joiner_.reset();
+
+  return true;
+}
+
+long hdfs::timeSince(int start_date, long start_time, 
+    const hadoop::hdfs::log &msg)
+{
+  int days = msg.date() - start_date;
+  if (days < -1) days += start_date == 365 ? 366 : 365;
+
+  return days * NS_PER_DAY + msg.time() - start_time;
+}
+
+TraceClock::TraceClock()
+  : started_(false)
+  , start_date_(0)
+  , start_time_(0)
+  , last_date_(0)
+  , year_(0)
+  , last_year_(0)
+{
+}
+
+TraceClock::TraceClock(int start_date, long start_time)
+  : started_(true)
+  , start_date_(start_date)
+  , start_time_(start_time)
+  , last_date_(start_date)
+  , year_(-start_date)
+  , last_year_(-start_date)
+{
+}
+
+int TraceClock::startDate() const
+{
+  return start_date_;
+}
+
+long TraceClock::startTime() const
+{
+  return start_time_;
+}
+
+long TraceClock::since(const hadoop::hdfs::log &msg)
+{
+  return since(msg.date(), msg.time());
+}
+
+long TraceClock::since(int date, long time)
+{
+  if (!started_) {
+    *this = TraceClock(date, time);
+  }
+
+  return daysTo(date) * NS_PER_DAY + time - start_time_;
+}
+
+long TraceClock::daysTo(int date)
+{
+  if (date < last_date_ - 1) {
+    last_year_ = year_;
+    year_ += last_date_ == 365 ? 366 : 365;
+    last_date_ = date;
+  } else if (last_date_ == 0 && date >= 364 && year_ != last_year_) {
+    return last_year_ + date;   //a slightly unordered record of the year before
+  } else if (date > last_date_) {
+    last_date_ = date;
+  }
+
+  return year_ + date;
+}
+
+/* Continues at a record known to be about the given nanoseconds from
+ * the start, less than half a day off, e.g. from an index of the log. */
+void TraceClock::resume(const hadoop::hdfs::log &msg, long about)
+{
+  long days = (about + start_time_ - msg.time() + NS_PER_DAY / 2) / NS_PER_DAY;
+
+  started_ = true;
+  last_date_ = msg.date();
+  year_ = days - msg.date();
+  last_year_ = year_;
+}
@@ -18,14 +18,27 @@
 
 // This class works as a reader to log, which includes a log file and 
 // a index file.
+//
+// A log may also be compact, with every call joined to its return in
+// one op (see OpJoiner.h and tcompact). Either kind can be read either
+// way: next() and nextRaw() give the calls and returns of a compact log
+// as records again, each return right after its call, so threads are
+// no longer interleaved in time order; nextOp() joins the records of a
+// log as it goes. Offsets of a compact log are of ops, so while the
+// return of an op is still to come the offset is that of its op.
 
 #ifndef LIBHDFSPP_READER_H_
 #define LIBHDFSPP_READER_H_ 
 
 #include <memory>
+#include <string>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 
 #include "log.pb.h"
+#include "OpJoiner.h"
+
+// A compact log starts with an empty record and one holding this
+#define COMPACT_MAGIC "libhdfspp-ops 1"
 
 namespace hdfs
 {
@@ -41,11 +54,62 @@ class LogReader
   bool isEOF();
   bool setPath(const char* logPath); 
   std::unique_ptr<hadoop::hdfs::log> next();
+  bool nextRaw(std::string &record);   //serialized record, not parsed
+  bool nextOp(hadoop::hdfs::op &op);
+  bool isCompact() const;
+  long offset() const;                 //of the next record, or of its op
+  bool seek(long offset);              //offset must start a record
 
  private:
+  bool read(::google::protobuf::Message &msg);
+  std::unique_ptr<hadoop::hdfs::log> nextSplit();
+
   bool isOK_;
   bool isEOF_;
+  bool compact_;
+  int logFd_;
+  long base_;           //offset the stream started from
   ::google::protobuf::io::FileInputStream* logFile_;
+  hadoop::hdfs::log held_;      //return of a split op
+  bool holding_;
+  long held_offset_;            //of the op it was split from
+  std::shared_ptr<OpJoiner> joiner_;
+};
+
+// Nanoseconds elapsed between a reference point of a trace and the
+// given record, for intervals shorter than a day such as a call and its
+// return. Logs only keep the day of year; a day earlier by more than one
+// is taken to be in the next year, which is a leap year if the reference
+// point is on day 365. Use a TraceClock for times across a whole trace.
+long timeSince(int start_date, long start_time, const hadoop::hdfs::log &msg);
+
+// TraceClock gives the nanoseconds from the first record of a trace, or
+// another reference point, to records given in log order. It follows
+// the day of year of the records one by one and counts a new year when
+// the day falls back by more than one (one day back is just a slightly
+// unordered log). The year left was a leap year if the trace had a
+// record on its day 365, which a trace starting on that day has; a leap
+// year without a record on its last day is taken one day short.
+class TraceClock
+{
+ public:
+  TraceClock();                               //starts at the first record
+  TraceClock(int start_date, long start_time);
+
+  int startDate() const;
+  long startTime() const;
+  long since(const hadoop::hdfs::log &msg);
+  long since(int date, long time);
+  long daysTo(int date);                      //from the start date, if started
+  void resume(const hadoop::hdfs::log &msg, long about); //after a seek
+
+ private:
+  bool started_;
+  int start_date_;
+  long start_time_;
+  int last_date_;       //latest day of the current year
+  long year_;           //days from start date to the current year
+  long last_year_;      //and to the year before, if there was one
 };
 
 } /* hdfs */ 
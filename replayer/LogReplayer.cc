@@ -16,273 +16,1124 @@
  * limitations under the License.
  */
 
-// Log replayer replays file operations by reading log file. All
-// open and close operations would be done in main thread. Other
-// operations will be performed in seperate threads. And there is a
-// background thread printing bandwidth information every second.
+// Log replayer replays file operations by reading log file against a
+// backend, which is HDFS by default but can also be local files or a
+// simulated store (see ReplayBackend.h). The log is decoded on its
+// own thread and handed over through a bounded ring, so memory stays
+// flat however long the log is. Opens are done on the main thread,
+// which dispatches the log, and every other call is performed by a
+// pool of worker threads; a background thread prints throughput every
+// second. Files are looked up in a sharded handle table, and a file
+// closed by the log is only closed once the calls in flight on it are
+// done, by the main thread or by the worker finishing the last call.
+// Writes, flushes, hsyncs and seeks go to workers like reads, but the
+// calls on one file are done one at a time in the order of the log,
+// since they use the position of its stream. Getfileinfo and listdir
+// go to workers as well. Optionally closed files are kept open and
+// reused by later opens of the same path, which takes open overhead
+// out of the replay; files opened for writing are never kept.
+//
+// Writes would overwrite the traced data if replayed on its own paths,
+// so files the log opened for writing are only opened, and written,
+// with -e, which needs the data set moved with -p or -r. Otherwise
+// their opens and calls are skipped and counted, before they are paced,
+// so they take neither tokens of a target rate nor a client.
+//
+// Latency of every operation is recorded without locking, and a summary
+// with percentiles can be saved as JSON or CSV when replay is done.
+//
+// In wait mode every operation is dispatched at an absolute deadline
+// computed from the start of the trace, optionally sped up or slowed
+// down by a factor. How late operations were dispatched compared to
+// their deadline is reported at the end of replay.
+//
+// To find how much load a cluster takes, operations of the trace can
+// instead be sent at a target rate of operations or bytes per second,
+// fixed or ramping up (open loop, see TokenBucket.h), or by a fixed
+// number of virtual clients that think between operations (closed
+// loop, see ClientGate.h). Either way the trace supplies the mix and
+// sizes of operations. In open loop the latency of a read also counts
+// the time it waited for a worker, so an overloaded backend shows.
+// Opens and closes are paced on the dispatching thread, which a full
+// worker queue also stalls, and tokens missed then are not made up, so
+// the rate actually offered is reported next to the target.
+//
+// Reads can also be merged or read ahead before they are replayed, to
+// see what such a change of the client would gain (see ReadShaper.h).
+//
+// To scale load up, the log can be replayed as several tenants at
+// once. Each tenant decodes the log on its own, has its own namespace
+// of file handles, can read its own copy of the data set under a
+// per-tenant folder, and can be started later than the others.
+//
+// Replay can also be spread over processes on many hosts. One replayer
+// runs as coordinator and splits the log among workers by traced
+// thread; every worker replays its share and the coordinator puts the
+// results together (see Coordinator.h).
 
-#include <map>
-#include <mutex>
+#include <atomic>
+#include <random>
+#include <algorithm>
 #include <chrono>
 #include <vector>
 #include <thread>
+#include <cstdlib>
 #include <iostream>
+#include <fcntl.h>
 #include <unistd.h>
 
-#include "libhdfs++/chdfs.h"
-#include "LogReader.h"
-
-//constant
-static const int MB = 1024 * 1024;
+#include "Coordinator.h"
+#include "ClientGate.h"
+#include "CoordinatorClient.h"
+#include "HandleCache.h"
+#include "HandleTable.h"
+#include "ReadShaper.h"
+#include "ReplayBackend.h"
+#include "ReplayStats.h"
+#include "Scheduler.h"
+#include "TokenBucket.h"
+#include "TraceDecoder.h"
+#include "WorkerPool.h"
 
 //program options
 static bool wait_before_new_thread = false;
+static double speed = 1.0;
 static std::string parent_folder = "";
+static std::string backend_spec = "hdfs";
+static size_t ring_depth = 65536;     //decoded operations waiting for dispatch
+static size_t decode_ahead = 1024;    //operations held for reordering
+static int tenants = 1;
+static std::string tenant_folder = "";
+static double tenant_delay = 0;       //milliseconds between tenants
+static double tenant_jitter = 0;      //milliseconds
+static int coordinator_port = 0;      //run as coordinator if set
+static int workers = 1;
+static std::string coordinator_address = "";   //run as worker if set
+static std::string result_file = "";
 static unsigned max_threads = std::thread::hardware_concurrency() * 2;
+static bool sequential = false;
+static size_t keep_open = 0;          //files kept open after close
+static double rate[3] = {0, 0, 0};    //start, end and ramp seconds
+static bool rate_in_bytes = false;
+static unsigned clients = 0;
+static double think_time = 0;         //milliseconds
+static std::string shaping = "";
+static bool replay_writes = false;
 
 //global variables
-static std::mutex mtx;
-static bool need_count = true;
-static int read_bytes = 0;
-static double run_time = 0;
-static hdfsFS fs = nullptr;
-static std::map<long, hdfsFile> files;
-static std::vector<std::unique_ptr<hadoop::hdfs::log>> jobs;
-
-void getReadInfo(int bytes, double seconds);
+static std::atomic<bool> need_count(true);
+static unsigned main_slot = 0;    //stats slot of main thread
+static std::unique_ptr<hdfs::ReplayBackend> backend;
+static hdfs::HandleTable files(64);
+static std::unique_ptr<hdfs::HandleCache> cache;
+static std::unique_ptr<hdfs::TokenBucket> limiter;
+static std::unique_ptr<hdfs::ClientGate> gate;
+static std::unique_ptr<hdfs::ReadShaper> shaper;
+static std::unique_ptr<hdfs::ReplayStats> stats;
+static std::atomic<long> skipped(0);  //write opens and calls not replayed
+static std::atomic<long> offered(0);  //ops or bytes let through by limiter
+
+void printUsage(const char* name);
+void printLateness(const hdfs::Histogram &lateness);
 void printBandwidth();
-void handleJobs();
-void handleOpen(const hadoop::hdfs::log &msg);
-void handleOpenRet(const hadoop::hdfs::log &msg);
-void handleRead(const hadoop::hdfs::log &msg);
-void handleClose(const hadoop::hdfs::log &msg);
+void printCache();
+long nanoSince(std::chrono::steady_clock::time_point start);
+bool parseSize(const char* arg, size_t &size);
+bool parseMillis(const char* arg, double &millis);
+bool parseRate(const char* arg);
+std::vector<long> tenantShifts();
+std::string replayPath(const hdfs::ReplayOp &op);
+bool coordinate(const char* logPath);
+void openLazily(const hdfs::ReplayOp &op);
+bool isCall(const hdfs::ReplayOp &op);
+bool isReadOnly(int flags);
+hdfs::ReplayStats::OpType statOf(hadoop::hdfs::log_FuncType type);
+void replay(const hdfs::ReplayOp &op, hdfs::WorkerPool &pool);
+bool isSkipped(const hdfs::ReplayOp &op);
+void skip(const hdfs::ReplayOp &op);
+void pace(const hdfs::ReplayOp &op);
+void dispatch(const hdfs::ReplayOp &op, hdfs::WorkerPool &pool);
+void handleOpen(const hdfs::ReplayOp &op);
+void handleOpenRet(const hdfs::ReplayOp &op);
+void putFile(const hdfs::HandleTable::Key &key, 
+    const hdfs::HandleTable::HandlePtr &handle);
+hdfs::ReplayBackend::File openFile(const hdfs::ReplayOp &op);
+hdfs::HandleTable::HandlePtr acquireFile(const hdfs::ReplayOp &op);
+void handleRead(long position, long length, 
+    const hdfs::HandleTable::HandlePtr &handle, unsigned slot, 
+    std::chrono::steady_clock::time_point issued);
+void handleStream(hadoop::hdfs::log_FuncType type, long position, 
+    long length, long ticket, const hdfs::HandleTable::HandlePtr &handle, 
+    unsigned slot, std::chrono::steady_clock::time_point issued);
+void handleMetadata(hadoop::hdfs::log_FuncType type, 
+    const std::string &path, unsigned slot, 
+    std::chrono::steady_clock::time_point issued);
+void handleClose(const hdfs::ReplayOp &op);
+void closeFile(const hdfs::HandleTable::HandlePtr &handle, unsigned slot);
+void closeCached();
 
 int main(int argc, char* argv[]) {
   int opt;
 
-  while((opt = getopt(argc, argv, "swp:")) != -1) {
+  while((opt = getopt(argc, argv, "swx:p:o:b:q:a:n:r:d:j:C:k:W:K:R:B:c:t:g:e")) != -1) {
     switch (opt) {
       case 's':
         need_count = false;
+        sequential = true;
         max_threads = 1;
         break;
       case 'w':
         wait_before_new_thread = true;
         break;
+      case 'x':
+        wait_before_new_thread = true;
+        speed = std::atof(optarg);
+        if (speed <= 0) {
+          std::cerr << "Speed factor must be positive." << std::endl;
+          return 1;
+        }
+        break;
       case 'p':
         parent_folder = optarg;
         break;
+      case 'o':
+        result_file = optarg;
+        break;
+      case 'b':
+        backend_spec = optarg;
+        break;
+      case 'q':
+        if (!parseSize(optarg, ring_depth)) {
+          std::cerr << "Ring depth must be a positive number." << std::endl;
+          return 1;
+        }
+        break;
+      case 'a':
+        if (!parseSize(optarg, decode_ahead)) {
+          std::cerr << "Decode-ahead must be a positive number." << std::endl;
+          return 1;
+        }
+        break;
+      case 'n':
+        tenants = std::atoi(optarg);
+        if (tenants <= 0) {
+          std::cerr << "Number of tenants must be positive." << std::endl;
+          return 1;
+        }
+        break;
+      case 'r':
+        tenant_folder = optarg;
+        break;
+      case 'd':
+        if (!parseMillis(optarg, tenant_delay)) {
+          std::cerr << "Tenant delay must be a non-negative number." << std::endl;
+          return 1;
+        }
+        break;
+      case 'j':
+        if (!parseMillis(optarg, tenant_jitter)) {
+          std::cerr << "Tenant jitter must be a non-negative number." << std::endl;
+          return 1;
+        }
+        break;
+      case 'C':
+        coordinator_port = std::atoi(optarg);
+        if (coordinator_port <= 0) {
+          std::cerr << "Coordinator port must be positive." << std::endl;
+          return 1;
+        }
+        break;
+      case 'k':
+        workers = std::atoi(optarg);
+        if (workers <= 0) {
+          std::cerr << "Number of workers must be positive." << std::endl;
+          return 1;
+        }
+        break;
+      case 'W':
+        coordinator_address = optarg;
+        break;
+      case 'K':
+        if (!parseSize(optarg, keep_open)) {
+          std::cerr << "Number of files kept open must be positive." << std::endl;
+          return 1;
+        }
+        break;
+      case 'R':
+      case 'B':
+        rate_in_bytes = opt == 'B';
+        if (!parseRate(optarg)) {
+          std::cerr << "Rate must be <rate> or <rate>:<end rate>:<seconds>." << std::endl;
+          return 1;
+        }
+        break;
+      case 'c':
+        if (std::atoi(optarg) <= 0) {
+          std::cerr << "Number of clients must be positive." << std::endl;
+          return 1;
+        }
+        clients = std::atoi(optarg);
+        break;
+      case 't':
+        if (!parseMillis(optarg, think_time)) {
+          std::cerr << "Think time must be a non-negative number." << std::endl;
+          return 1;
+        }
+        break;
+      case 'g':
+        shaping = optarg;
+        break;
+      case 'e':
+        replay_writes = true;
+        break;
       default:
-        std::cout << "Usage: " << argv[0] << " [-s] [-w] [-p parent-folder]";
-        std::cout << " <log file> " << "<host> <port>" << std::endl;
-        std::cout << "Options:" << std::endl;
-        std::cout << "  -s          Enable sequential mode. All file operations are executed sequentially." << std::endl;
-        std::cout << "  -w          Enable wait mode. Replayer will reproduce time gap between original file operations." << std::endl;
-        std::cout << "  -p <arg>    Specify the parent foder for the data set." << std::endl;
+        printUsage(argv[0]);
         return 0;
     }
   }
 
-  if (optind >= argc) {
-        std::cout << "Usage: " << argv[0] << " [-s] [-w] [-p parent-folder]";
-        std::cout << " <log file> " << "<host> <port>" << std::endl;
-        std::cout << "Options:" << std::endl;
-        std::cout << "  -s          Enable sequential mode. All file operations are executed sequentially." << std::endl;
-        std::cout << "  -w          Enable wait mode. Replayer will reproduce time gap between original file operations." << std::endl;
-        std::cout << "  -p <arg>    Specify the parent foder for the data set." << std::endl;
-        return 0;
+  if (coordinator_port > 0) {
+    if (optind >= argc) {
+      printUsage(argv[0]);
+      return 0;
+    }
+    return coordinate(argv[optind]) ? 0 : 1;
+  }
+
+  if ((rate[0] > 0) + (clients > 0) + wait_before_new_thread > 1) {
+    std::cerr << "Wait mode, target rate and clients can not be combined." << std::endl;
+    return 1;
+  }
+  if (replay_writes && parent_folder == "" && tenant_folder == "") {
+    std::cerr << "Writes are only replayed into a folder given with -p or -r." << std::endl;
+    return 1;
   }
 
-  hdfs::LogReader reader(argv[optind]);
-  fs = hdfsConnect(argv[optind + 1], std::atoi(argv[optind + 2])); 
+  bool need_server = hdfs::ReplayBackend::nameOf(backend_spec) == "hdfs";
+  if (optind + (need_server ? 2 : 0) >= argc) {
+    printUsage(argv[0]);
+    return 0;
+  }
 
-  int index(0);
-  std::unique_ptr<hadoop::hdfs::log> msg;
+  // every tenant gets a share of the ring depth, but not too little
+  std::vector<std::unique_ptr<hdfs::TraceDecoder>> decoders;
+  std::vector<long> shifts = tenantShifts();
+  size_t depth = std::max(ring_depth / tenants, (size_t)1024);
+  for (int i = 0; i < tenants; ++i) {
+    decoders.push_back(std::unique_ptr<hdfs::TraceDecoder>(
+          new hdfs::TraceDecoder(argv[optind], depth, i, shifts[i])));
+  }
+  backend = hdfs::ReplayBackend::create(backend_spec, 
+      need_server ? argv[optind + 1] : nullptr, 
+      need_server ? std::atoi(argv[optind + 2]) : 0);
+  if (backend == nullptr) {
+    return 1;
+  }
+  if (shaping != "") {
+    shaper = hdfs::ReadShaper::create(shaping);
+    if (shaper == nullptr) {
+      return 1;
+    }
+  }
+  if (keep_open > 0) {
+    cache.reset(new hdfs::HandleCache(keep_open));
+  }
+  if (rate[0] > 0) {
+    double scale = rate_in_bytes ? 1024 * 1024 : 1;
+    limiter.reset(new hdfs::TokenBucket(rate[0] * scale, rate[1] * scale, 
+          rate[2], 0.01));
+  }
+  if (clients > 0) {
+    gate.reset(new hdfs::ClientGate(clients, (long)(think_time * 1000000)));
+    max_threads = std::max(max_threads, clients);  //no read waits for a worker
+  }
+
+  hdfs::CoordinatorClient client;
+  if (coordinator_address != "") {
+    if (!client.join(coordinator_address)) {
+      return 1;
+    }
+    for (auto &decoder : decoders) {
+      decoder->setPartition(client.threads());
+    }
+  }
+
+  hdfs::ReplayOp decoded, ready;
   std::chrono::time_point<std::chrono::system_clock> start, end;
+  hdfs::Scheduler scheduler(wait_before_new_thread, speed, decode_ahead, 
+      tenants);
+  std::vector<bool> live(tenants, true);
+  hdfs::WorkerPool pool(max_threads, ring_depth);
+  main_slot = pool.size();
+  stats.reset(new hdfs::ReplayStats(main_slot + 1));
+
+  for (auto &decoder : decoders) {
+    decoder->start();
+  }
+
+  // all workers start at the same moment, and at the start of trace
+  if (coordinator_address != "") {
+    auto wait = client.start() - std::chrono::system_clock::now();
+    auto at = std::chrono::steady_clock::now() + 
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(wait);
+
+    std::this_thread::sleep_until(at);
+    scheduler.startAt(at, 0);
+  }
 
   std::cout << "Start replaying file operations." << std::endl;
   start = std::chrono::system_clock::now();
+  stats->start();
+  if (limiter != nullptr) limiter->start();
   std::thread count_thread(printBandwidth);
 
-  while((msg = reader.next()) != nullptr) {
-    switch (msg->type()) {
-      case hadoop::hdfs::log_FuncType_OPEN:
-        handleOpen(*msg);
-        break;
-      case hadoop::hdfs::log_FuncType_OPEN_RET:
-        handleOpenRet(*msg);
-        break;
-      case hadoop::hdfs::log_FuncType_CLOSE:
-        handleJobs(); //handle all jobs in vector and join the work threads here
-        handleClose(*msg);
-        break;
-      case hadoop::hdfs::log_FuncType_CLOSE_RET:
-        break;
-      case hadoop::hdfs::log_FuncType_READ:
-        jobs.push_back(std::move(msg));
-        break;
-      case hadoop::hdfs::log_FuncType_READ_RET:
+  // An operation is only dispatched when every tenant still decoding
+  // has a full window in scheduler, so tenants are merged in time order.
+  while (true) {
+    for (int i = 0; i < tenants; ++i) {
+      while (live[i] && scheduler.needs(i)) {
+        if (decoders[i]->next(decoded)) {
+          scheduler.push(decoded);
+        } else {
+          live[i] = false;
+        }
+      }
+    }
+
+    // merged reads are due once held long enough, which may be before
+    // the next op, so they are given out at their own deadline
+    while (shaper != nullptr) {
+      long due = shaper->nextDeadline();
+      if (due < 0 || (!scheduler.empty() && due > scheduler.nextTime())) {
         break;
-      default:
-        std::cerr << "#" << (index + 1); 
-        std::cerr << ": Unknown file operation." << std::endl;
-    } 
+      }
+      scheduler.waitUntil(due);
+      shaper->releaseUntil(due);
+      while (shaper->pop(ready)) {
+        replay(ready, pool);
+      }
+    }
+
+    if (!scheduler.pop(ready)) break;
+    if (shaper != nullptr) {
+      shaper->push(ready);
+      while (shaper->pop(ready)) {
+        replay(ready, pool);
+      }
+    } else {
+      replay(ready, pool);
+    }
+  }
+  if (shaper != nullptr) {
+    shaper->flush();    //reads still held at the end of log
+    while (shaper->pop(ready)) {
+      replay(ready, pool);
+    }
+  }
+  pool.drain();
+  closeCached();
 
-    index++;
+  long records = 0;
+  int failed = -1;    //tenant whose decoder failed
+  for (int i = 0; i < tenants; ++i) {
+    decoders[i]->join();
+    records += decoders[i]->kept();
+    if (failed < 0 && decoders[i]->failed()) failed = i;
   }
+
   end = std::chrono::system_clock::now();
+  stats->finish();
   std::chrono::duration<double> time = end - start;
   need_count = false;
   count_thread.join();
 
-  if (!reader.isEOF()) {
-    std::cerr << "Failed to parse log #" << (++index) << std::endl;
+  if (failed >= 0) {
+    std::cerr << "Failed to parse log #" << (decoders[failed]->records() + 1);
+    if (tenants > 1) std::cerr << " of tenant " << failed;
+    std::cerr << std::endl;
   } else {
     std::cout << "Total time: " << time.count() << " seconds. ";
-    std::cout << "Total file operations: " << index / 2 << "." << std::endl; 
+    std::cout << "Total file operations: " << records / 2 << "." << std::endl; 
+    stats->print(std::cout);
+    if (wait_before_new_thread) {
+      printLateness(scheduler.lateness());
+      stats->setLateness(scheduler.lateness());
+    }
+    if (cache != nullptr) {
+      printCache();
+    }
+    if (shaper != nullptr) {
+      shaper->print(std::cout);
+    }
+    if (limiter != nullptr) {
+      std::cout << "Offered rate: " << offered / time.count() 
+        / (rate_in_bytes ? 1024 * 1024 : 1);
+      std::cout << (rate_in_bytes ? " MB/s" : " ops/s") << " overall." << std::endl;
+    }
+    if (skipped > 0) {
+      std::cout << "Skipped " << skipped << " opens for writing and calls";
+      std::cout << " on them, replay them with -e." << std::endl;
+    }
+
+    if (result_file != "" && !stats->write(result_file)) {
+      std::cerr << "Failed to write results to " << result_file << std::endl;
+    }
+    if (coordinator_address != "" && !client.sendResults(*stats)) {
+      std::cerr << "Failed to send results to coordinator." << std::endl;
+    }
   }
 
-  reader.close();
-  hdfsDisconnect(fs);
+  backend.reset();
 
   return 0;
 }
 
-/* Pass read info to the thread */
-void getReadInfo(int bytes, double seconds)
+void printUsage(const char* name)
+{
+  std::cout << "Usage: " << name << " [-s] [-w] [-x speed] [-p parent-folder] [-o result-file]";
+  std::cout << " [-b backend] <log file> " << "[<host> <port>]" << std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout << "  -s          Enable sequential mode. All file operations are executed sequentially." << std::endl;
+  std::cout << "  -w          Enable wait mode. Replayer will reproduce time gap between original file operations." << std::endl;
+  std::cout << "  -x <arg>    Enable wait mode with time gaps divided by a speed factor, e.g. 0.5, 2 or 10." << std::endl;
+  std::cout << "  -p <arg>    Specify the parent foder for the data set." << std::endl;
+  std::cout << "  -o <arg>    Save latency and throughput results to a JSON file, or CSV if named *.csv." << std::endl;
+  std::cout << "  -b <arg>    Specify the backend: hdfs (default, needs host and port), posix, or" << std::endl;
+  std::cout << "              sim[:latency=us,jitter=us,bandwidth=MB/s,open=us,close=us,meta=us]." << std::endl;
+  std::cout << "  -q <arg>    Specify how many decoded operations may wait for dispatch. Default 65536." << std::endl;
+  std::cout << "  -a <arg>    Specify how many operations are decoded ahead for reordering. Default 1024." << std::endl;
+  std::cout << "  -n <arg>    Replay the log as the given number of concurrent tenants." << std::endl;
+  std::cout << "  -r <arg>    Specify a per-tenant folder under the parent folder, '%d' is replaced by tenant number." << std::endl;
+  std::cout << "  -d <arg>    Start every tenant the given milliseconds of trace time after the previous one." << std::endl;
+  std::cout << "  -j <arg>    Delay every tenant by a random time of up to the given milliseconds." << std::endl;
+  std::cout << "  -C <arg>    Run as coordinator of a distributed replay, listening on the given port." << std::endl;
+  std::cout << "  -k <arg>    Specify the number of workers the coordinator waits for. Default 1." << std::endl;
+  std::cout << "  -W <arg>    Run as worker of the coordinator at the given host:port." << std::endl;
+  std::cout << "  -K <arg>    Keep up to the given number of closed files open for reuse by later opens." << std::endl;
+  std::cout << "  -R <arg>    Send operations at a target rate in ops/s, or ramp with <rate>:<end rate>:<seconds>." << std::endl;
+  std::cout << "  -B <arg>    Send reads at a target rate in MB/s, or ramp with <rate>:<end rate>:<seconds>." << std::endl;
+  std::cout << "  -c <arg>    Send operations from the given number of clients, each waiting for its last one." << std::endl;
+  std::cout << "  -t <arg>    Specify the think time of clients in milliseconds. Default 0." << std::endl;
+  std::cout << "  -g <arg>    Merge reads with coalesce[:size=KB,gap=bytes,hold=ms], or read ahead" << std::endl;
+  std::cout << "              with readahead[:size=KB], and report what it saves." << std::endl;
+  std::cout << "  -e          Replay opens for writing and writes, only into a folder given with -p or -r." << std::endl;
+}
+
+/* Print how late operations were dispatched compared to their deadline */
+void printLateness(const hdfs::Histogram &lateness)
 {
-  mtx.lock();
-  read_bytes += bytes;
-  run_time += seconds;
-  mtx.unlock();
+  auto us = [](long ns) { return ns / 1000.0; };
+
+  std::cout << "Dispatch lateness (us) of " << lateness.count();
+  std::cout << " operations at " << speed << "x speed:" << std::endl;
+  std::cout << "  mean: " << lateness.mean() / 1000;
+  std::cout << " p50: " << us(lateness.percentile(50));
+  std::cout << " p90: " << us(lateness.percentile(90));
+  std::cout << " p99: " << us(lateness.percentile(99));
+  std::cout << " p99.9: " << us(lateness.percentile(99.9));
+  std::cout << " max: " << us(lateness.max()) << std::endl;
 }
 
-/* Calculate and print bandwidth info */
+/* Calculate and print throughput info */
 void printBandwidth()
 {
+  if (!need_count) {
+    return;
+  }
+
+  double unit = rate_in_bytes ? 1024 * 1024 : 1;
+  long last = 0;
+  auto next = std::chrono::steady_clock::now() + std::chrono::seconds(1);
   while(need_count) {
-    mtx.lock(); 
-    if (run_time > 0) {
-      std::cout << "Current bandwidth: ";
-      std::cout << read_bytes / run_time / MB << " MB/s" << std::endl; 
-      read_bytes = 0;
-      run_time = 0; 
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    if (std::chrono::steady_clock::now() >= next) {
+      stats->sample(std::cout);
+      if (limiter != nullptr) {
+        long now = offered;
+        std::cout << "Offered rate: " << (now - last) / unit;
+        std::cout << (rate_in_bytes ? " MB/s" : " ops/s") << ", target ";
+        std::cout << limiter->rate() / unit << std::endl;
+        last = now;
+      }
+      next += std::chrono::seconds(1);
     }
-    mtx.unlock();
+  }
+
+  stats->sample(std::cout);   //the last partial interval
+}
+
+/* Print how often opens were served by files kept open */
+void printCache()
+{
+  long opens = cache->hits() + cache->misses();
 
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+  std::cout << "Files kept open: " << keep_open << ". Opens reused: ";
+  std::cout << cache->hits() << " of " << opens;
+  if (opens > 0) {
+    std::cout << " (" << cache->hits() * 100.0 / opens << "%)";
   }
+  std::cout << ", closed early: " << cache->evictions() << "." << std::endl;
 }
 
-/* spawn threads to handle file operation and wait them to finish */
-void handleJobs()
+bool parseSize(const char* arg, size_t &size)
 {
-  if (jobs.empty()) {
-    return;
+  long value = std::atol(arg);
+  if (value <= 0) {
+    return false;
   }
 
-  std::vector<std::thread> threads;
-  long last_time = jobs[0]->time();
+  size = (size_t)value;
+  return true;
+}
 
-  for (int i = 0; i < (int)jobs.size(); ++i) {
-    if (wait_before_new_thread) {
-      long time = jobs[i]->time();
-      std::this_thread::sleep_for(std::chrono::nanoseconds(time - last_time));
-      last_time = time;
+bool parseMillis(const char* arg, double &millis)
+{
+  char* end = nullptr;
+  double value = std::strtod(arg, &end);
+  if (end == arg || *end != '\0' || value < 0) {
+    return false;
+  }
+
+  millis = value;
+  return true;
+}
+
+/* Parse a target rate, which ramps if an end rate and time are given */
+bool parseRate(const char* arg)
+{
+  char* end = nullptr;
+  rate[0] = std::strtod(arg, &end);
+  rate[1] = rate[0];
+  rate[2] = 0;
+
+  if (*end == ':') {
+    char* from = end + 1;
+    rate[1] = std::strtod(from, &end);
+    if (end == from || *end != ':') return false;
+    from = end + 1;
+    rate[2] = std::strtod(from, &end);
+    if (end == from || rate[2] < 0) return false;
+  }
+
+  return end != arg && *end == '\0' && rate[0] > 0 && rate[1] > 0;
+}
+
+/* Time in nanosecond by which operations of every tenant are delayed.
+ * Jitter uses a fixed seed so that runs are repeatable. */
+std::vector<long> tenantShifts()
+{
+  std::vector<long> shifts;
+  std::mt19937 random(1);
+  std::uniform_real_distribution<double> jitter(0, tenant_jitter);
+
+  for (int i = 0; i < tenants; ++i) {
+    double millis = i * tenant_delay;
+    if (tenant_jitter > 0) millis += jitter(random);
+    shifts.push_back((long)(millis * 1000000));
+  }
+
+  return shifts;
+}
+
+/* Path of a file for the tenant, under parent and tenant folder */
+std::string replayPath(const hdfs::ReplayOp &op)
+{
+  std::string folder = parent_folder;
+
+  if (tenant_folder != "") {
+    std::string tenant = tenant_folder;
+    std::string number = std::to_string(op.tenant);
+    size_t pos = tenant.find("%d");
+
+    if (pos != std::string::npos) {
+      tenant.replace(pos, 2, number);
+    } else {
+      tenant.append(number);
     }
+    folder = folder == "" ? tenant : folder + "/" + tenant;
+  }
 
-    switch (jobs[i]->type()) {
-      case hadoop::hdfs::log_FuncType_READ:
-        threads.push_back(std::thread(handleRead, *jobs[i])); 
-        break;
-      default:
-        ;
+  std::string path = op.path;
+  if (folder != "") {
+    if (path.at(0) == '/') {
+      path = "/" +  folder + path;
+    } else {
+      path = folder + "/" + path;
     }
+  }
+
+  return path;
+}
 
-    if (threads.size() == max_threads) { //avoid too many requests to hdfs
-      for (int i = 0; i < (int)threads.size(); ++i) {
-        threads[i].join(); 
+/* Split the log among workers and put their results together */
+bool coordinate(const char* logPath)
+{
+  hdfs::ReplayStats results(1);
+  hdfs::Coordinator coordinator(coordinator_port, workers);
+
+  if (!coordinator.run(logPath, results)) {
+    return false;
+  }
+
+  results.print(std::cout);
+  if (result_file != "" && !results.write(result_file)) {
+    std::cerr << "Failed to write results to " << result_file << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+long nanoSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+/* Whether a record is a call rather than the return of one, calls
+ * have even types */
+bool isCall(const hdfs::ReplayOp &op)
+{
+  return op.type % 2 == 0;
+}
+
+bool isReadOnly(int flags)
+{
+  return (flags & O_ACCMODE) == O_RDONLY;
+}
+
+hdfs::ReplayStats::OpType statOf(hadoop::hdfs::log_FuncType type)
+{
+  switch (type) {
+    case hadoop::hdfs::log_FuncType_WRITE:
+      return hdfs::ReplayStats::WRITE;
+    case hadoop::hdfs::log_FuncType_FLUSH:
+      return hdfs::ReplayStats::FLUSH;
+    case hadoop::hdfs::log_FuncType_HSYNC:
+      return hdfs::ReplayStats::HSYNC;
+    case hadoop::hdfs::log_FuncType_SEEK:
+      return hdfs::ReplayStats::SEEK;
+    case hadoop::hdfs::log_FuncType_GETFILEINFO:
+      return hdfs::ReplayStats::GETFILEINFO;
+    case hadoop::hdfs::log_FuncType_LISTDIR:
+      return hdfs::ReplayStats::LISTDIR;
+    default:
+      return hdfs::ReplayStats::READ;
+  }
+}
+
+/* Replay an operation, unless it is on a file opened for writing that
+ * is not replayed; such calls neither take tokens nor a client. */
+void replay(const hdfs::ReplayOp &op, hdfs::WorkerPool &pool)
+{
+  if (isSkipped(op)) {
+    skip(op);
+    return;
+  }
+
+  pace(op);
+  dispatch(op, pool);
+}
+
+/* Whether a call is an open for writing, or a call on a file opened
+ * for writing, while writes are not replayed (see -e) */
+bool isSkipped(const hdfs::ReplayOp &op)
+{
+  if (replay_writes || !isCall(op)) {
+    return false;
+  }
+
+  switch (op.type) {
+    case hadoop::hdfs::log_FuncType_OPEN:
+      return !isReadOnly(op.flags);
+    case hadoop::hdfs::log_FuncType_READ:
+    case hadoop::hdfs::log_FuncType_CLOSE:
+    case hadoop::hdfs::log_FuncType_WRITE:
+    case hadoop::hdfs::log_FuncType_FLUSH:
+    case hadoop::hdfs::log_FuncType_HSYNC:
+    case hadoop::hdfs::log_FuncType_SEEK: {
+      auto handle = files.acquire(std::make_pair(op.tenant, op.handle));
+      if (handle == nullptr) {
+        return op.path != "" && !isReadOnly(op.flags);  //to open lazily
       }
+      bool skipped = handle->file == hdfs::ReplayBackend::BAD_FILE 
+        && !isReadOnly(handle->flags);
+      hdfs::HandleTable::release(handle);   //the table still holds it
+      return skipped;
+    }
+    default:
+      return false;
+  }
+}
 
-      threads.clear(); 
+/* Keep track of a file not opened, so that calls on it and its close
+ * are known to be skipped as well */
+void skip(const hdfs::ReplayOp &op)
+{
+  switch (op.type) {
+    case hadoop::hdfs::log_FuncType_OPEN:
+      handleOpen(op);     //counted by openFile
+      break;
+    case hadoop::hdfs::log_FuncType_CLOSE:
+      handleClose(op);
+      break;
+    default: {
+      auto handle = files.acquire(std::make_pair(op.tenant, op.handle));
+      if (handle == nullptr) {
+        openLazily(op);
+      } else {
+        hdfs::HandleTable::release(handle);
+      }
+      skipped++;
+      break;
     }
   }
+}
 
-  for (int i = 0; i < (int)threads.size(); ++i) {
-    threads[i].join(); 
+/* Hold a call back until target rate or a free client allows it. The
+ * client is given back by dispatch once the call is done. */
+void pace(const hdfs::ReplayOp &op)
+{
+  if (!isCall(op)) {
+    return;
   }
 
-  jobs.clear();
+  if (limiter != nullptr) {
+    if (!rate_in_bytes) {
+      limiter->take(1);
+      offered++;
+    } else if (op.type == hadoop::hdfs::log_FuncType_READ 
+        || op.type == hadoop::hdfs::log_FuncType_WRITE) {
+      limiter->take(op.length);
+      offered += op.length;
+    }
+  }
+  if (gate != nullptr) {
+    gate->enter();
+  }
 }
 
-void handleOpen(const hadoop::hdfs::log &msg)
+/* Perform an operation handed out by scheduler. Opens and closes are
+ * done in main thread, every other call is passed to the workers. */
+void dispatch(const hdfs::ReplayOp &op, hdfs::WorkerPool &pool)
 {
-  std::string path = msg.path();
-  if (parent_folder != "") {
-    if (path.at(0) == '/') {
-      path = "/" +  parent_folder + path;
-    } else {
-      path = parent_folder + "/" + path;
+  switch (op.type) {
+    case hadoop::hdfs::log_FuncType_OPEN:
+      handleOpen(op);
+      if (gate != nullptr) gate->leave();
+      break;
+    case hadoop::hdfs::log_FuncType_OPEN_RET:
+      handleOpenRet(op);
+      break;
+    case hadoop::hdfs::log_FuncType_CLOSE:
+      if (sequential) pool.drain();
+      handleClose(op);
+      if (gate != nullptr) gate->leave();
+      break;
+    case hadoop::hdfs::log_FuncType_CLOSE_RET:
+      break;
+    case hadoop::hdfs::log_FuncType_READ: {
+      // The read holds a reference to the file until it is done, so a
+      // close in the mean time leaves the file open for it.
+      auto handle = acquireFile(op);
+      if (handle == nullptr) break;
+
+      long position = op.position;
+      long length = op.length;
+      auto issued = std::chrono::steady_clock::now();
+      pool.submit([position, length, handle, issued](unsigned slot) { 
+          handleRead(position, length, handle, slot, issued); 
+          if (gate != nullptr) gate->leave();
+      });
+      break;
     }
-  }
+    case hadoop::hdfs::log_FuncType_WRITE:
+    case hadoop::hdfs::log_FuncType_FLUSH:
+    case hadoop::hdfs::log_FuncType_HSYNC:
+    case hadoop::hdfs::log_FuncType_SEEK: {
+      auto handle = acquireFile(op);
+      if (handle == nullptr) break;
+
+      hadoop::hdfs::log_FuncType type = op.type;
+      long position = op.position;
+      long length = op.length;
+      long ticket = handle->issued++;
+      auto issued = std::chrono::steady_clock::now();
+      pool.submit([type, position, length, ticket, handle, issued](unsigned slot) { 
+          handleStream(type, position, length, ticket, handle, slot, issued); 
+          if (gate != nullptr) gate->leave();
+      });
+      break;
+    }
+    case hadoop::hdfs::log_FuncType_GETFILEINFO:
+    case hadoop::hdfs::log_FuncType_LISTDIR: {
+      hadoop::hdfs::log_FuncType type = op.type;
+      std::string path = replayPath(op);
+      auto issued = std::chrono::steady_clock::now();
+      pool.submit([type, path, issued](unsigned slot) { 
+          handleMetadata(type, path, slot, issued); 
+          if (gate != nullptr) gate->leave();
+      });
+      break;
+    }
+    case hadoop::hdfs::log_FuncType_READ_RET:
+    case hadoop::hdfs::log_FuncType_WRITE_RET:
+    case hadoop::hdfs::log_FuncType_FLUSH_RET:
+    case hadoop::hdfs::log_FuncType_HSYNC_RET:
+    case hadoop::hdfs::log_FuncType_SEEK_RET:
+    case hadoop::hdfs::log_FuncType_GETFILEINFO_RET:
+    case hadoop::hdfs::log_FuncType_LISTDIR_RET:
+      break;
+    default:
+      std::cerr << "Unknown file operation." << std::endl;
+  } 
+}
 
-  hdfsFile file = hdfsOpenFile(fs, path.c_str(), 
-      (int)msg.argument(1), 
-      (int)msg.argument(2), 
-      (short)msg.argument(3), 
-      (int)msg.argument(4));
+void handleOpen(const hdfs::ReplayOp &op)
+{
+  hdfs::ReplayBackend::File file = openFile(op);
 
   // Using thread id as key to temporarily store file here is safe.
   // In the same thread all operations are sequential, thus a OPEN
   // must be followed by an OPEN_RET. It's impossible in a single
   // thread to have multiple OPENs on halfway without return. In
   // addition, the value of thread id can hardly be equal to an
-  // address value. So we don't need to worry about file being
-  // overwritten by other things.
-  files[msg.threadid()] = file;
+  // address value. Should a file be there anyway, putFile closes it.
+  putFile(std::make_pair(op.tenant, op.thread), 
+      files.create(file, replayPath(op), op.flags));
 }
 
-void handleOpenRet(const hadoop::hdfs::log &msg)
+/* Open a file for a call on it, the call carries path and flags of
+ * open */
+void openLazily(const hdfs::ReplayOp &op)
 {
-  files[msg.argument(0)] = files[msg.threadid()];
-  files.erase(msg.threadid());// safely delete the item
+  hdfs::ReplayBackend::File file = openFile(op);
+
+  putFile(std::make_pair(op.tenant, op.handle), 
+      files.create(file, replayPath(op), op.flags));
 }
 
-void handleRead(const hadoop::hdfs::log &msg)
+/* Open a file on backend, or take it from files kept open */
+hdfs::ReplayBackend::File openFile(const hdfs::ReplayOp &op)
 {
-  auto file = files.find(msg.argument(1));
-  if (file != files.end()) {
-    size_t buf_size = msg.argument(4);
-    char* buffer = new char[buf_size];
-    auto start = std::chrono::system_clock::now();
-
-    auto ret = hdfsPread(fs, file->second, 
-        (off_t)msg.argument(2), 
-        reinterpret_cast<void*>(buffer), 
-        buf_size);
-
-    auto end = std::chrono::system_clock::now();
-    std::chrono::duration<double> elapsed = end - start;
-    getReadInfo(ret, elapsed.count());
-
-    delete[] buffer;
-  } else {
-    std::cerr << "Read: file " 
-      << msg.argument(1) 
-      << "not found." << std::endl;
+  std::string path = replayPath(op);
+  hdfs::ReplayBackend::File file;
+  auto start = std::chrono::steady_clock::now();
+
+  if (!replay_writes && !isReadOnly(op.flags)) {
+    skipped++;
+    return hdfs::ReplayBackend::BAD_FILE;
+  }
+
+  if (cache == nullptr || !isReadOnly(op.flags) || !cache->take(path, file)) {
+    file = backend->open(path, 
+        op.flags, op.buffer_size, op.replication, op.block_size);
+  }
+
+  stats->record(main_slot, hdfs::ReplayStats::OPEN, nanoSince(start), 0);
+  if (file == hdfs::ReplayBackend::BAD_FILE) {
+    stats->recordError(main_slot, hdfs::ReplayStats::OPEN);
+  }
+
+  return file;
+}
+
+void handleOpenRet(const hdfs::ReplayOp &op)
+{
+  auto handle = files.remove(std::make_pair(op.tenant, op.thread));
+  if (handle != nullptr) {
+    putFile(std::make_pair(op.tenant, op.handle), handle);
+  }
+}
+
+/* Put a file in the table. A file the log never closed whose handle is
+ * reused is closed once the calls in flight on it are done. */
+void putFile(const hdfs::HandleTable::Key &key, 
+    const hdfs::HandleTable::HandlePtr &handle)
+{
+  auto replaced = files.put(key, handle);
+  if (replaced != nullptr && hdfs::HandleTable::release(replaced)) {
+    closeFile(replaced, main_slot);
+  }
+}
+
+/* Take a reference to the file a call is on, opening it if the log
+ * opened it on a thread replayed elsewhere. Gives the client back and
+ * returns null if there is no file to call. */
+hdfs::HandleTable::HandlePtr acquireFile(const hdfs::ReplayOp &op)
+{
+  auto handle = files.acquire(std::make_pair(op.tenant, op.handle));
+  if (handle == nullptr && op.path != "") {
+    openLazily(op);   //opened by a thread replayed by another worker
+    handle = files.acquire(std::make_pair(op.tenant, op.handle));
+  }
+  if (handle == nullptr) {
+    std::cerr << hadoop::hdfs::log_FuncType_Name(op.type) << ": file " 
+      << op.handle 
+      << " not found." << std::endl;
+    if (gate != nullptr) gate->leave();
+    return nullptr;
+  }
+  if (handle->file == hdfs::ReplayBackend::BAD_FILE) {
+    if (!replay_writes && !isReadOnly(handle->flags)) {
+      skipped++;    //not opened, see -e
+    } else {
+      stats->recordError(main_slot, statOf(op.type));
+    }
+    hdfs::HandleTable::release(handle);
+    if (gate != nullptr) gate->leave();
+    return nullptr;   //open failed, it has been counted already
+  }
+
+  return handle;
+}
+
+void handleRead(long position, long length, 
+    const hdfs::HandleTable::HandlePtr &handle, unsigned slot, 
+    std::chrono::steady_clock::time_point issued)
+{
+  size_t buf_size = length;
+  char* buffer = new char[buf_size];
+
+  // in open loop a read is late once it waits for a worker
+  auto start = limiter != nullptr ? issued : std::chrono::steady_clock::now();
+
+  auto ret = backend->pread(handle->file, position, buffer, buf_size);
+
+  stats->record(slot, hdfs::ReplayStats::READ, nanoSince(start), ret);
+  if (ret < 0) {
+    stats->recordError(slot, hdfs::ReplayStats::READ);
+  }
+
+  delete[] buffer;
+  if (hdfs::HandleTable::release(handle)) {
+    closeFile(handle, slot);  //the log closed it while reading
+  }
+}
+
+/* Write, flush, hsync or seek on the stream of a file. Calls on one
+ * file wait for their ticket, so they are done one at a time and in
+ * the order they were handed out. Workers take jobs in that order too,
+ * so the call whose turn it is always has a worker. */
+void handleStream(hadoop::hdfs::log_FuncType type, long position, 
+    long length, long ticket, const hdfs::HandleTable::HandlePtr &handle, 
+    unsigned slot, std::chrono::steady_clock::time_point issued)
+{
+  std::unique_ptr<char[]> buffer;
+  if (type == hadoop::hdfs::log_FuncType_WRITE) {
+    buffer.reset(new char[length]());
+  }
+
+  long ret;
+  long bytes = 0;
+  {
+    std::unique_lock<std::mutex> lock(handle->stream);
+    handle->turn.wait(lock, [&handle, ticket] { 
+        return handle->served == ticket; 
+    });
+    auto start = limiter != nullptr ? issued : std::chrono::steady_clock::now();
+
+    switch (type) {
+      case hadoop::hdfs::log_FuncType_WRITE:
+        ret = backend->write(handle->file, buffer.get(), (size_t)length);
+        bytes = ret;
+        break;
+      case hadoop::hdfs::log_FuncType_FLUSH:
+        ret = backend->flush(handle->file);
+        break;
+      case hadoop::hdfs::log_FuncType_HSYNC:
+        ret = backend->hsync(handle->file);
+        break;
+      default:
+        ret = backend->seek(handle->file, position);
+        break;
+    }
+
+    stats->record(slot, statOf(type), nanoSince(start), bytes);
+    handle->served++;
+  }
+  handle->turn.notify_all();
+
+  // a write returns bytes written, the others 0 on success
+  if (ret < 0 || (type != hadoop::hdfs::log_FuncType_WRITE && ret != 0)) {
+    stats->recordError(slot, statOf(type));
+  }
+
+  if (hdfs::HandleTable::release(handle)) {
+    closeFile(handle, slot);  //the log closed it meanwhile
   }
 }
 
-void handleClose(const hadoop::hdfs::log &msg)
+void handleMetadata(hadoop::hdfs::log_FuncType type, 
+    const std::string &path, unsigned slot, 
+    std::chrono::steady_clock::time_point issued)
 {
-  auto file = files.find(msg.argument(1));
-  if (file != files.end()) {
-    auto ret = hdfsCloseFile(fs, file->second);
-    (void)ret;//make gcc happy
+  auto start = limiter != nullptr ? issued : std::chrono::steady_clock::now();
+  bool failed;
+
+  if (type == hadoop::hdfs::log_FuncType_GETFILEINFO) {
+    failed = backend->getFileInfo(path) != 0;
   } else {
+    failed = backend->listDir(path) < 0;
+  }
+
+  stats->record(slot, statOf(type), nanoSince(start), 0);
+  if (failed) {
+    stats->recordError(slot, statOf(type));
+  }
+}
+
+void handleClose(const hdfs::ReplayOp &op)
+{
+  auto handle = files.remove(std::make_pair(op.tenant, op.handle));
+  if (handle == nullptr) {
     std::cerr << "Close: file " 
-      << msg.argument(1) 
+      << op.handle 
       << "not found." << std::endl;
+    return;
+  }
+
+  if (hdfs::HandleTable::release(handle)) {
+    closeFile(handle, main_slot);
   }
 }
 
+/* Close a file nobody uses any more, or keep it open for reuse */
+void closeFile(const hdfs::HandleTable::HandlePtr &handle, unsigned slot)
+{
+  hdfs::ReplayBackend::File file = handle->file;
+  if (file == hdfs::ReplayBackend::BAD_FILE) {
+    return;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  hdfs::ReplayBackend::File evicted_file;
+  bool evicted = false;
+  int ret = 0;
+
+  if (cache == nullptr || !isReadOnly(handle->flags)) {
+    ret = backend->close(file);
+  } else {
+    evicted = cache->put(handle->path, file, evicted_file);
+  }
+
+  stats->record(slot, hdfs::ReplayStats::CLOSE, nanoSince(start), 0);
+  if (ret != 0) {
+    stats->recordError(slot, hdfs::ReplayStats::CLOSE);
+  }
+  if (evicted) {
+    backend->close(evicted_file);   //not a close in the log, not counted
+  }
+}
+
+/* Close files kept open when replay is done */
+void closeCached()
+{
+  if (cache == nullptr) {
+    return;
+  }
+
+  for (auto file : cache->clear()) {
+    backend->close(file);
+  }
+}
@@ -0,0 +1,269 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "MissRatioCurve.h"
+
+#define TWO_TO_64 18446744073709551616.0
+#define SUB_BITS 4
+#define NUM_BUCKETS ((64 - SUB_BITS + 1) * (1 << SUB_BITS))
+
+using namespace hdfs;
+
+MissRatioCurve::MissRatioCurve(long block_size, double rate, size_t max_keys, 
+    long interval)
+  : block_size_(block_size)
+  , max_keys_(std::max(max_keys, (size_t)1))
+  , interval_(interval)
+  , threshold_(rate >= 1 ? UINT64_MAX : (uint64_t)(rate * TWO_TO_64))
+  , marks_(std::max(max_keys_ * 4, (size_t)1024) + 1, 0)
+  , clock_(0)
+  , references_(0)
+  , distances_(NUM_BUCKETS, 0)
+  , cold_(0)
+  , sampled_(0)
+  , adjustment_(0)
+  , current_(0)
+  , touched_(0)
+{
+}
+
+MissRatioCurve::~MissRatioCurve()
+{
+}
+
+/* Every block from offset to offset + length is an access */
+void MissRatioCurve::access(uint64_t file, long offset, long length, 
+    long time)
+{
+  if (length <= 0) {
+    return;
+  }
+
+  long interval = time / interval_;
+  while (current_ < interval) {
+    working_set_.push_back(touched_ / rate());
+    touched_ = 0;
+    current_++;
+  }
+
+  long last = (offset + length - 1) / block_size_;
+  for (long block = offset / block_size_; block <= last; ++block) {
+    references_++;
+    accessBlock(mix(file ^ mix((uint64_t)block)));
+  }
+}
+
+/* Close the last interval and make up for sampling error. The number
+ * of sampled accesses should be rate times all accesses, the difference
+ * is put among accesses with the shortest reuse distance (SHARDS-adj). */
+void MissRatioCurve::finish()
+{
+  working_set_.push_back(touched_ / rate());
+  touched_ = 0;
+  current_++;
+
+  adjustment_ = references_ * rate() - sampled_;
+  distances_[0] = std::max(distances_[0] + adjustment_, 0.0);
+}
+
+void MissRatioCurve::print(std::ostream &out) const
+{
+  double total = cold_;
+  size_t used = 0;
+  for (size_t i = 0; i < distances_.size(); ++i) {
+    total += distances_[i];
+    if (distances_[i] > 0) used = i + 1;
+  }
+
+  out << "Block size " << block_size_ << ": " << references_;
+  out << " block accesses, sampled at rate " << rate();
+  out << " with " << blocks_.size() << " blocks tracked, adjusted by ";
+  out << adjustment_ << "." << std::endl;
+  out << "cache_bytes miss_ratio" << std::endl;
+  if (total <= 0) {
+    return;
+  }
+
+  // misses of a cache of a bucket's lower bound in blocks are the
+  // accesses in that bucket and above, four points per doubling
+  double misses = total;
+  for (size_t i = 0; i <= used && i < distances_.size(); ++i) {
+    uint64_t blocks = lowerBound(i);
+    bool point = i < (1 << SUB_BITS) ? (blocks & (blocks - 1)) == 0 
+      : i % 4 == 0 || i == used;
+
+    if (blocks > 0 && point) {
+      out << blocks * block_size_ << " " << misses / total << std::endl;
+    }
+    misses -= distances_[i];
+  }
+}
+
+void MissRatioCurve::printWorkingSet(std::ostream &out) const
+{
+  out << "Working set of block size " << block_size_ << " every ";
+  out << interval_ / 1000000000.0 << " s:" << std::endl;
+  out << "time_s blocks bytes" << std::endl;
+
+  for (size_t i = 0; i < working_set_.size(); ++i) {
+    long blocks = (long)(working_set_[i] + 0.5);
+    out << i * interval_ / 1000000000.0 << " " << blocks << " ";
+    out << blocks * block_size_ << std::endl;
+  }
+}
+
+/* splitmix64 finalizer, spreads keys over the whole hash space */
+uint64_t MissRatioCurve::mix(uint64_t value)
+{
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9UL;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebUL;
+  return value ^ (value >> 31);
+}
+
+/* Same layout as Histogram with fewer sub buckets */
+size_t MissRatioCurve::bucketOf(uint64_t distance)
+{
+  if (distance < (1 << SUB_BITS)) {
+    return (size_t)distance;
+  }
+
+  int exponent = 63 - __builtin_clzll(distance);
+  int shift = exponent - SUB_BITS;
+  int sub = (int)((distance >> shift) - (1 << SUB_BITS));
+
+  return (shift + 1) * (1 << SUB_BITS) + sub;
+}
+
+uint64_t MissRatioCurve::lowerBound(size_t bucket)
+{
+  if (bucket < (1 << SUB_BITS)) {
+    return bucket;
+  }
+
+  int shift = bucket / (1 << SUB_BITS) - 1;
+  return (uint64_t)(bucket % (1 << SUB_BITS) + (1 << SUB_BITS)) << shift;
+}
+
+void MissRatioCurve::accessBlock(uint64_t key)
+{
+  uint64_t hash = mix(key);
+  if (hash >= threshold_) {
+    return;
+  }
+
+  if (clock_ + 1 >= (long)marks_.size()) {
+    compact();
+  }
+  long now = ++clock_;
+
+  auto found = blocks_.find(key);
+  if (found != blocks_.end()) {
+    long distance = marksAfter(found->second.stamp);
+    distances_[bucketOf((uint64_t)(distance / rate()))] += 1;
+    mark(found->second.stamp, -1);
+  } else {
+    cold_ += 1;
+    found = blocks_.insert(std::make_pair(key, Block{0, -1})).first;
+    hashes_.push(std::make_pair(hash, key));
+  }
+
+  mark(now, 1);
+  found->second.stamp = now;
+  if (found->second.interval != current_) {
+    found->second.interval = current_;
+    touched_ += 1;
+  }
+  sampled_ += 1;
+
+  if (blocks_.size() > max_keys_) {
+    lowerRate();
+  }
+}
+
+/* Stop tracking blocks with the highest hash. Counts so far were taken
+ * at a higher rate and are scaled down to the new one. */
+void MissRatioCurve::lowerRate()
+{
+  double old_rate = rate();
+  threshold_ = hashes_.top().first;
+
+  while (!hashes_.empty() && hashes_.top().first >= threshold_) {
+    auto block = blocks_.find(hashes_.top().second);
+    mark(block->second.stamp, -1);
+    if (block->second.interval == current_) touched_ -= 1;
+    blocks_.erase(block);
+    hashes_.pop();
+  }
+
+  double ratio = rate() / old_rate;
+  for (auto &count : distances_) {
+    count *= ratio;
+  }
+  cold_ *= ratio;
+  sampled_ *= ratio;
+}
+
+void MissRatioCurve::mark(long stamp, int delta)
+{
+  for (long i = stamp; i < (long)marks_.size(); i += i & -i) {
+    marks_[i] += delta;
+  }
+}
+
+long MissRatioCurve::marksAfter(long stamp) const
+{
+  long after = 0;
+
+  for (long i = clock_; i > 0; i -= i & -i) {
+    after += marks_[i];
+  }
+  for (long i = stamp; i > 0; i -= i & -i) {
+    after -= marks_[i];
+  }
+
+  return after;
+}
+
+/* Stamps run out, number tracked blocks again from 1 in stamp order */
+void MissRatioCurve::compact()
+{
+  std::vector<std::pair<long, Block*>> order;
+  for (auto &block : blocks_) {
+    order.push_back(std::make_pair(block.second.stamp, &block.second));
+  }
+  std::sort(order.begin(), order.end(), 
+      [](const std::pair<long, Block*> &l, const std::pair<long, Block*> &r) {
+        return l.first < r.first;
+      });
+
+  std::fill(marks_.begin(), marks_.end(), 0);
+  clock_ = 0;
+  for (auto &block : order) {
+    block.second->stamp = ++clock_;
+    mark(clock_, 1);
+  }
+}
+
+double MissRatioCurve::rate() const
+{
+  return threshold_ / TWO_TO_64;
+}
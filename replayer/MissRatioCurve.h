@@ -0,0 +1,102 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// MissRatioCurve estimates the miss ratio of an LRU cache of every
+// size in one pass over a stream of block accesses, from the reuse
+// distance of every access: the number of other blocks accessed since
+// the same block was last accessed. An LRU cache misses exactly the
+// accesses whose reuse distance is at least its size in blocks.
+//
+// Only blocks whose hash falls under a threshold are tracked (SHARDS,
+// Waldspurger et al., FAST'15). With a sampling rate R, reuse distances
+// among sampled blocks are scaled by 1/R. At most 'max_keys' blocks are
+// tracked, the threshold is lowered to drop blocks with the highest
+// hash once there are more, and earlier counts are scaled down so that
+// they weigh as much as later ones. Memory thus stays bounded however
+// long the trace is. The number of distinct blocks accessed in every
+// interval of trace time, the working set, is estimated the same way.
+
+#ifndef LIBHDFSPP_MISSRATIOCURVE_H_
+#define LIBHDFSPP_MISSRATIOCURVE_H_
+
+#include <queue>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+#include <utility>
+#include <unordered_map>
+
+namespace hdfs
+{
+
+class MissRatioCurve
+{
+ public:
+  MissRatioCurve(long block_size, double rate, size_t max_keys, 
+      long interval);   //interval of working set in ns
+  virtual ~MissRatioCurve();
+
+  //time is ns since start of trace
+  void access(uint64_t file, long offset, long length, long time);
+  void finish();
+
+  void print(std::ostream &out) const;
+  void printWorkingSet(std::ostream &out) const;
+
+ private:
+  static const int SUB_BUCKETS = 16;
+
+  struct Block {
+    long stamp;       //when block was last accessed
+    long interval;    //interval block was last accessed in
+  };
+
+  static uint64_t mix(uint64_t value);
+  static size_t bucketOf(uint64_t distance);
+  static uint64_t lowerBound(size_t bucket);
+
+  void accessBlock(uint64_t key);
+  void lowerRate();
+  void mark(long stamp, int delta);
+  long marksAfter(long stamp) const;
+  void compact();
+  double rate() const;
+
+  long block_size_;
+  size_t max_keys_;
+  long interval_;
+  uint64_t threshold_;      //blocks with hash below are sampled
+  std::unordered_map<uint64_t, Block> blocks_;
+  std::priority_queue<std::pair<uint64_t, uint64_t>> hashes_; //hash and key
+  std::vector<long> marks_; //Fenwick tree of last access stamps
+  long clock_;
+
+  uint64_t references_;
+  std::vector<double> distances_;
+  double cold_;             //first access of a sampled block
+  double sampled_;
+  double adjustment_;
+
+  long current_;            //interval of the last access
+  double touched_;          //sampled blocks accessed in current interval
+  std::vector<double> working_set_;
+};
+
+} /* hdfs */ 
+
+#endif
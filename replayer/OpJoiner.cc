@@ -0,0 +1,327 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogReader.h"
+#include "OpJoiner.h"
+
+#define NS_PER_DAY (24L * 3600 * 1000000000)
+
+using namespace hdfs;
+
+/* Which arguments of a call have a field of their own in an op, -1 for
+ * none. The handle an open returns is taken from its return. */
+static void layoutOf(int type, int &handle, int &offset, int &length)
+{
+  handle = offset = length = -1;
+
+  switch (type) {
+    case hadoop::hdfs::log_FuncType_READ:
+      handle = 1;
+      offset = 2;
+      length = 4;
+      break;
+    case hadoop::hdfs::log_FuncType_WRITE:
+      handle = 1;
+      length = 3;
+      break;
+    case hadoop::hdfs::log_FuncType_SEEK:
+      handle = 1;
+      offset = 2;
+      break;
+    case hadoop::hdfs::log_FuncType_CLOSE:
+    case hadoop::hdfs::log_FuncType_FLUSH:
+    case hadoop::hdfs::log_FuncType_HSYNC:
+      handle = 1;
+      break;
+    default:
+      break;
+  }
+}
+
+OpJoiner::OpJoiner(size_t max_held, long max_wait)
+  : first_(0)
+  , max_held_(max_held)
+  , max_wait_(max_wait)
+  , unreturned_(0)
+  , lone_(0)
+  , released_(0)
+{
+}
+
+OpJoiner::~OpJoiner()
+{
+}
+
+void OpJoiner::push(const hadoop::hdfs::log &msg)
+{
+  bool call = msg.type() % 2 == 0;    //a return follows its call
+  auto calling = calling_.find(msg.threadid());
+
+  // a call in flight is done if its thread makes another call, and a
+  // return of another kind leaves both without their other half
+  if (calling != calling_.end() 
+      && (call || slotOf(calling->second).op.type() + 1 != msg.type())) {
+    slotOf(calling->second).done = true;
+    calling_.erase(calling);
+    calling = calling_.end();
+    unreturned_++;
+  }
+
+  if (call) {
+    slots_.push_back(Slot());
+    Slot &slot = slots_.back();
+    hadoop::hdfs::op &op = slot.op;
+    int handle, offset, length;
+
+    op.set_type(msg.type());
+    op.set_date(msg.date());
+    op.set_time(msg.time());
+    op.set_threadid(msg.threadid());
+    layoutOf(msg.type(), handle, offset, length);
+    for (int i = 0; i < msg.argument_size(); ++i) {
+      if (i == handle) {
+        op.set_handle(msg.argument(i));
+      } else if (i == offset) {
+        op.set_offset(msg.argument(i));
+      } else if (i == length) {
+        op.set_length(msg.argument(i));
+      } else {
+        op.add_argument(msg.argument(i));
+      }
+    }
+
+    if (msg.has_path()) {
+      op.set_path(msg.path());
+      op.set_pathid(idOf(msg.path()));
+    } else if (op.has_handle()) {
+      auto file = files_.find(op.handle());
+      if (file != files_.end()) op.set_pathid(file->second);
+    }
+    if (msg.has_site()) {
+      op.set_site(msg.site());
+      for (int i = 0; i < msg.frame_size(); ++i) {
+        op.add_frame(msg.frame(i));
+      }
+    }
+
+    if (msg.has_cputime()) op.set_callcputime(msg.cputime());
+    if (msg.has_voluntaryswitches()) {
+      op.set_callvoluntaryswitches(msg.voluntaryswitches());
+      op.set_callinvoluntaryswitches(msg.involuntaryswitches());
+    }
+
+    slot.done = false;
+    calling_[msg.threadid()] = first_ + slots_.size() - 1;
+    release(msg);
+    return;
+  }
+
+  if (calling == calling_.end()) {
+    slots_.push_back(Slot());
+    Slot &slot = slots_.back();
+    slot.op.set_type(msg.type());
+    slot.op.set_date(msg.date());
+    slot.op.set_time(msg.time());
+    slot.op.set_threadid(msg.threadid());
+    if (msg.argument_size() >= 1) slot.op.set_ret(msg.argument(0));
+    if (msg.has_cputime()) slot.op.set_callcputime(msg.cputime());
+    if (msg.has_voluntaryswitches()) {
+      slot.op.set_callvoluntaryswitches(msg.voluntaryswitches());
+      slot.op.set_callinvoluntaryswitches(msg.involuntaryswitches());
+    }
+    slot.done = true;
+    lone_++;
+    release(msg);
+    return;
+  }
+
+  Slot &slot = slotOf(calling->second);
+  hadoop::hdfs::op &op = slot.op;
+  calling_.erase(calling);
+
+  op.set_duration(timeSince(op.date(), op.time(), msg));
+  if (msg.date() != op.date()) op.set_retdate(msg.date());
+  if (msg.argument_size() >= 1) op.set_ret(msg.argument(0));
+  if (op.has_callcputime() && msg.has_cputime()) {
+    op.set_cputime(msg.cputime() - op.callcputime());
+  }
+  if (op.has_callvoluntaryswitches() && msg.has_voluntaryswitches()) {
+    op.set_voluntaryswitches(msg.voluntaryswitches() 
+        - op.callvoluntaryswitches());
+    op.set_involuntaryswitches(msg.involuntaryswitches() 
+        - op.callinvoluntaryswitches());
+  }
+
+  if (op.type() == hadoop::hdfs::log_FuncType_OPEN && op.has_ret()) {
+    op.set_handle(op.ret());
+    if (op.has_pathid()) files_[op.ret()] = op.pathid();
+  } else if (op.type() == hadoop::hdfs::log_FuncType_CLOSE 
+      && op.has_handle()) {
+    files_.erase(op.handle());
+  }
+  slot.done = true;
+}
+
+/* Give up on the oldest call if too many ops wait for it, or it has
+ * been in flight too long by the time of msg */
+void OpJoiner::release(const hadoop::hdfs::log &msg)
+{
+  if (slots_.empty() || slots_.front().done) {
+    return;
+  }
+
+  Slot &front = slots_.front();
+  if (slots_.size() <= max_held_ 
+      && timeSince(front.op.date(), front.op.time(), msg) <= max_wait_) {
+    return;
+  }
+
+  calling_.erase(front.op.threadid());  //only a call in flight is not done
+  front.done = true;
+  unreturned_++;
+  released_++;
+}
+
+void OpJoiner::finish()
+{
+  for (auto &calling : calling_) {
+    slotOf(calling.second).done = true;
+    unreturned_++;
+  }
+  calling_.clear();
+}
+
+bool OpJoiner::pop(hadoop::hdfs::op &op)
+{
+  if (slots_.empty() || !slots_.front().done) {
+    return false;
+  }
+
+  op.Swap(&slots_.front().op);
+  slots_.pop_front();
+  first_++;
+
+  return true;
+}
+
+uint64_t OpJoiner::unreturned() const
+{
+  return unreturned_;
+}
+
+uint64_t OpJoiner::lone() const
+{
+  return lone_;
+}
+
+uint64_t OpJoiner::released() const
+{
+  return released_;
+}
+
+/* The thread totals of the return are those at the call plus the
+ * call's share */
+void OpJoiner::split(const hadoop::hdfs::op &op, 
+    hadoop::hdfs::log &call, bool &has_call, 
+    hadoop::hdfs::log &ret, bool &has_ret)
+{
+  has_call = op.type() % 2 == 0;
+  has_ret = !has_call || op.has_duration();
+  call.Clear();
+  ret.Clear();
+
+  if (has_call) {
+    int handle, offset, length;
+    layoutOf(op.type(), handle, offset, length);
+    int count = op.argument_size() + (handle >= 0 && op.has_handle()) 
+      + (offset >= 0 && op.has_offset()) + (length >= 0 && op.has_length());
+    int next = 0;
+
+    call.set_type(op.type());
+    call.set_date(op.date());
+    call.set_time(op.time());
+    call.set_threadid(op.threadid());
+    for (int i = 0; i < count; ++i) {
+      if (i == handle && op.has_handle()) {
+        call.add_argument(op.handle());
+      } else if (i == offset && op.has_offset()) {
+        call.add_argument(op.offset());
+      } else if (i == length && op.has_length()) {
+        call.add_argument(op.length());
+      } else if (next < op.argument_size()) {
+        call.add_argument(op.argument(next++));
+      }
+    }
+    if (op.has_path()) call.set_path(op.path());
+    if (op.has_site()) {
+      call.set_site(op.site());
+      for (int i = 0; i < op.frame_size(); ++i) {
+        call.add_frame(op.frame(i));
+      }
+    }
+    if (op.has_callcputime()) call.set_cputime(op.callcputime());
+    if (op.has_callvoluntaryswitches()) {
+      call.set_voluntaryswitches(op.callvoluntaryswitches());
+      call.set_involuntaryswitches(op.callinvoluntaryswitches());
+    }
+  }
+
+  if (!has_ret) {
+    return;
+  }
+
+  long since = op.time() + (has_call ? op.duration() : 0);
+  ret.set_type(has_call ? (hadoop::hdfs::log_FuncType)(op.type() + 1) 
+      : op.type());
+  ret.set_date(op.has_retdate() ? op.retdate() : op.date());
+  ret.set_time(since % NS_PER_DAY);
+  ret.set_threadid(op.threadid());
+  if (op.has_ret()) ret.add_argument(op.ret());
+  if (!has_call) {
+    if (op.has_callcputime()) ret.set_cputime(op.callcputime());
+    if (op.has_callvoluntaryswitches()) {
+      ret.set_voluntaryswitches(op.callvoluntaryswitches());
+      ret.set_involuntaryswitches(op.callinvoluntaryswitches());
+    }
+    return;
+  }
+  if (op.has_cputime()) ret.set_cputime(op.callcputime() + op.cputime());
+  if (op.has_voluntaryswitches()) {
+    ret.set_voluntaryswitches(op.callvoluntaryswitches() 
+        + op.voluntaryswitches());
+    ret.set_involuntaryswitches(op.callinvoluntaryswitches() 
+        + op.involuntaryswitches());
+  }
+}
+
+int OpJoiner::idOf(const std::string &path)
+{
+  auto id = ids_.find(path);
+  if (id != ids_.end()) {
+    return id->second;
+  }
+
+  int next = (int)ids_.size();
+  ids_[path] = next;
+  return next;
+}
+
+OpJoiner::Slot& OpJoiner::slotOf(uint64_t sequence)
+{
+  return slots_[sequence - first_];
+}
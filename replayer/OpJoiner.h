@@ -0,0 +1,96 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// OpJoiner joins every call of a log with its return into one op (see
+// the op message of log.proto): the time and thread of the call, how
+// long it took, the file it was on, offset, bytes asked for and what
+// it returned. A thread makes one call at a time, so a return belongs
+// to the call in flight on its thread. Ops come out in the order of
+// their calls, each once its return is in, so an op is held back by
+// older calls still in flight. A call followed by another call of its
+// thread, or in flight when the log ends, comes out without a return,
+// and a return without a call as an op of the return's type. So that a
+// call that never returns does not hold back every later op, the
+// oldest call is given up on and comes out without a return once more
+// than a number of ops are held, or it has been in flight for long in
+// trace time; its return, if it comes after all, is a lone one.
+//
+// Paths get an id in the order they are first seen, and ops on a file
+// get the id of the path it was opened with, so tools can tell which
+// file a read was on without following handles. split() makes the
+// call and return records of an op again, thread totals included, as
+// the thread totals at the call are kept next to the call's share, and
+// so is the day of a return logged on another day than its call.
+
+#ifndef LIBHDFSPP_OPJOINER_H_
+#define LIBHDFSPP_OPJOINER_H_
+
+#include <deque>
+#include <string>
+#include <cstdint>
+#include <unordered_map>
+
+#include "log.pb.h"
+
+namespace hdfs
+{
+
+class OpJoiner
+{
+ public:
+  OpJoiner(size_t max_held = 1 << 20, long max_wait = 600L * 1000000000);
+  virtual ~OpJoiner();
+
+  void push(const hadoop::hdfs::log &msg);  //in log order
+  void finish();                            //no return will come any more
+  bool pop(hadoop::hdfs::op &op);           //next op whose return is in
+
+  uint64_t unreturned() const;  //calls without a return
+  uint64_t lone() const;        //returns without a call
+  uint64_t released() const;    //calls given up on, counted as unreturned
+
+  // call and return of an op, false for the one the op has not
+  static void split(const hadoop::hdfs::op &op, 
+      hadoop::hdfs::log &call, bool &has_call, 
+      hadoop::hdfs::log &ret, bool &has_ret);
+
+ private:
+  struct Slot {
+    hadoop::hdfs::op op;
+    bool done;
+  };
+
+  void release(const hadoop::hdfs::log &msg);
+  int idOf(const std::string &path);
+  Slot& slotOf(uint64_t sequence);
+
+  std::deque<Slot> slots_;          //in call order
+  uint64_t first_;                  //sequence of the front slot
+  std::unordered_map<long, uint64_t> calling_;  //thread to its call
+  std::unordered_map<std::string, int> ids_;    //of paths
+  std::unordered_map<long, int> files_;         //open handle to path id
+  size_t max_held_;                 //ops held before the oldest call is released
+  long max_wait_;                   //ns of trace time a call is waited for
+  uint64_t unreturned_;
+  uint64_t lone_;
+  uint64_t released_;
+};
+
+} /* hdfs */ 
+
+#endif
@@ -0,0 +1,99 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <thread>
+
+#include "OpRing.h"
+
+#define SPIN_ROUNDS 64
+
+using namespace hdfs;
+
+/* Capacity is rounded up to a power of two */
+static size_t roundUp(size_t n)
+{
+  size_t size = 1;
+  while (size < n) size <<= 1;
+  return size;
+}
+
+OpRing::OpRing(size_t capacity)
+  : slots_(roundUp(capacity > 0 ? capacity : 1))
+  , mask_(slots_.size() - 1)
+  , head_(0)
+  , tail_(0)
+  , closed_(false)
+{
+}
+
+OpRing::~OpRing()
+{
+}
+
+size_t OpRing::capacity() const
+{
+  return slots_.size();
+}
+
+void OpRing::push(ReplayOp &op)
+{
+  size_t tail = tail_.load(std::memory_order_relaxed);
+  unsigned rounds = 0;
+
+  while (tail - head_.load(std::memory_order_acquire) == slots_.size()) {
+    backoff(rounds);
+  }
+
+  slots_[tail & mask_] = std::move(op);
+  tail_.store(tail + 1, std::memory_order_release);
+}
+
+void OpRing::close()
+{
+  closed_.store(true, std::memory_order_release);
+}
+
+bool OpRing::pop(ReplayOp &op)
+{
+  size_t head = head_.load(std::memory_order_relaxed);
+  unsigned rounds = 0;
+
+  while (head == tail_.load(std::memory_order_acquire)) {
+    if (closed_.load(std::memory_order_acquire)) {
+      // the last push may have happened right before close
+      if (head == tail_.load(std::memory_order_acquire)) return false;
+      break;
+    }
+    backoff(rounds);
+  }
+
+  op = std::move(slots_[head & mask_]);
+  head_.store(head + 1, std::memory_order_release);
+
+  return true;
+}
+
+void OpRing::backoff(unsigned &rounds)
+{
+  if (rounds++ < SPIN_ROUNDS) {
+    std::this_thread::yield();
+  } else {
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+}
@@ -0,0 +1,62 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A bounded single producer, single consumer ring of ReplayOps. Slots
+// are allocated once and reused, so the ring never grows, and passing
+// an operation through it takes no lock. A side finding the ring full
+// or empty backs off by spinning, then sleeping briefly.
+
+#ifndef LIBHDFSPP_OPRING_H_
+#define LIBHDFSPP_OPRING_H_
+
+#include <atomic>
+#include <vector>
+
+#include "ReplayOp.h"
+
+namespace hdfs
+{
+
+class OpRing
+{
+ public:
+  OpRing(size_t capacity);
+  virtual ~OpRing();
+
+  size_t capacity() const;
+
+  void push(ReplayOp &op);      //producer only, op is moved from
+  void close();                 //producer only, no more push after it
+  bool pop(ReplayOp &op);       //consumer only, false if closed and empty
+
+ private:
+  static void backoff(unsigned &rounds);
+
+  std::vector<ReplayOp> slots_;
+  size_t mask_;
+  char pad0_[64];
+  std::atomic<size_t> head_;    //next slot to pop, written by consumer
+  char pad1_[64];
+  std::atomic<size_t> tail_;    //next slot to push, written by producer
+  char pad2_[64];
+  std::atomic<bool> closed_;
+};
+
+} /* hdfs */ 
+
+#endif
@@ -0,0 +1,104 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "PosixBackend.h"
+
+using namespace hdfs;
+
+PosixBackend::PosixBackend()
+{
+}
+
+PosixBackend::~PosixBackend()
+{
+}
+
+ReplayBackend::File PosixBackend::open(const std::string &path, int flags, 
+    int, short, int)
+{
+  int fd;
+  int access = flags & O_ACCMODE;
+  if (access == O_RDONLY) {
+    fd = ::open(path.c_str(), O_RDONLY);
+  } else if (access == O_RDWR) {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | (flags & O_APPEND), 0644);
+  } else {
+    fd = ::open(path.c_str(), 
+        O_WRONLY | O_CREAT | ((flags & O_APPEND) ? O_APPEND : O_TRUNC), 0644);
+  }
+  return fd == -1 ? BAD_FILE : (File)fd;
+}
+
+long PosixBackend::pread(File file, long offset, char* buffer, size_t length)
+{
+  return ::pread((int)file, buffer, length, (off_t)offset);
+}
+
+int PosixBackend::close(File file)
+{
+  return ::close((int)file);
+}
+
+long PosixBackend::write(File file, const char* buffer, size_t length)
+{
+  return ::write((int)file, buffer, length);
+}
+
+int PosixBackend::flush(File)
+{
+  return 0;
+}
+
+int PosixBackend::hsync(File file)
+{
+  return ::fsync((int)file);
+}
+
+int PosixBackend::seek(File file, long offset)
+{
+  return ::lseek((int)file, (off_t)offset, SEEK_SET) == -1 ? -1 : 0;
+}
+
+int PosixBackend::getFileInfo(const std::string &path)
+{
+  struct stat info;
+  return ::stat(path.c_str(), &info);
+}
+
+long PosixBackend::listDir(const std::string &path)
+{
+  DIR* dir = ::opendir(path.c_str());
+  if (dir == nullptr) {
+    return -1;
+  }
+
+  long entries = 0;
+  struct dirent* entry;
+  while ((entry = ::readdir(dir)) != nullptr) {
+    std::string name(entry->d_name);
+    if (name != "." && name != "..") entries++;
+  }
+  ::closedir(dir);
+
+  return entries;
+}
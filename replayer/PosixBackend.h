@@ -0,0 +1,56 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays file operations against local files with POSIX calls, which
+// gives a local disk baseline to compare HDFS with. Paths in the log
+// are used as they are, so the data set is usually put under a folder
+// given to replayer with '-p'. Files are opened read only, unless the
+// log opened them for writing; then they are created, truncated unless
+// opened with O_APPEND, and opened for reading as well with O_RDWR.
+// A flush has nothing to do, since local writes are seen by readers at
+// once, and an hsync is an fsync.
+
+#ifndef LIBHDFSPP_POSIXBACKEND_H_
+#define LIBHDFSPP_POSIXBACKEND_H_
+
+#include "ReplayBackend.h"
+
+namespace hdfs
+{
+
+class PosixBackend : public ReplayBackend
+{
+ public:
+  PosixBackend();
+  virtual ~PosixBackend();
+
+  virtual File open(const std::string &path, int flags, int bufferSize, 
+      short replication, int blockSize);
+  virtual long pread(File file, long offset, char* buffer, size_t length);
+  virtual int close(File file);
+  virtual long write(File file, const char* buffer, size_t length);
+  virtual int flush(File file);
+  virtual int hsync(File file);
+  virtual int seek(File file, long offset);
+  virtual int getFileInfo(const std::string &path);
+  virtual long listDir(const std::string &path);
+};
+
+} /* hdfs */ 
+
+#endif
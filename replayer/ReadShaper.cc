@@ -0,0 +1,278 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+#include "ReadShaper.h"
+#include "ReplayBackend.h"
+
+using namespace hdfs;
+
+ReadShaper::ReadShaper(Mode mode, long size, long gap, long hold)
+  : mode_(mode)
+  , size_(size)
+  , gap_(gap)
+  , hold_(hold)
+  , next_id_(0)
+  , reads_(0)
+  , read_bytes_(0)
+  , requests_(0)
+  , request_bytes_(0)
+  , served_(0)
+  , over_read_(0)
+{
+}
+
+ReadShaper::~ReadShaper()
+{
+}
+
+std::unique_ptr<ReadShaper> ReadShaper::create(const std::string &spec)
+{
+  std::string name = spec.substr(0, spec.find(':'));
+  ReplayBackend::Options options;
+  double size = 1024, gap = 0, hold = 10;   //KB, bytes and ms
+
+  if (!ReplayBackend::parseOptions(spec, options)) {
+    std::cerr << "Malformed read shaping options: " << spec << std::endl;
+    return nullptr;
+  }
+
+  Mode mode;
+  if (name == "coalesce") {
+    mode = COALESCE;
+  } else if (name == "readahead") {
+    mode = READ_AHEAD;
+  } else {
+    std::cerr << "Unknown read shaping: " << name << std::endl;
+    return nullptr;
+  }
+
+  bool ok = ReplayBackend::getNumber(options, "size", size) 
+    && (mode != COALESCE || (ReplayBackend::getNumber(options, "gap", gap) 
+          && ReplayBackend::getNumber(options, "hold", hold)));
+  if (!ok || size <= 0) {
+    std::cerr << "Read shaping options must be non-negative numbers." << std::endl;
+    return nullptr;
+  }
+  if (!options.empty()) {
+    std::cerr << "Unknown option of " << name << ": ";
+    std::cerr << options.begin()->first << std::endl;
+    return nullptr;
+  }
+
+  return std::unique_ptr<ReadShaper>(new ReadShaper(mode, 
+        (long)(size * 1024), (long)gap, (long)(hold * 1000000)));
+}
+
+void ReadShaper::push(ReplayOp &op)
+{
+  if (mode_ == COALESCE) {
+    releaseOld(op.time);
+  }
+
+  if (op.type == hadoop::hdfs::log_FuncType_READ) {
+    reads_++;
+    read_bytes_ += op.length;
+    if (mode_ == COALESCE) {
+      coalesce(op);
+    } else {
+      readAhead(op);
+    }
+    return;
+  }
+
+  if (op.type == hadoop::hdfs::log_FuncType_CLOSE) {
+    Key key(op.tenant, op.handle);
+    release(key);
+
+    auto window = windows_.find(key);
+    if (window != windows_.end()) {
+      retire(window->second);
+      windows_.erase(window);
+    }
+  }
+
+  ready_.push_back(std::move(op));
+}
+
+void ReadShaper::flush()
+{
+  while (!runs_.empty()) {
+    release(runs_.begin()->first);
+  }
+  held_.clear();
+
+  for (auto &window : windows_) {
+    retire(window.second);
+  }
+  windows_.clear();
+}
+
+/* Runs given out before are left in the queue and skipped here */
+long ReadShaper::nextDeadline() const
+{
+  for (auto &held : held_) {
+    auto run = runs_.find(held.second);
+    if (run != runs_.end() && run->second.id == held.first) {
+      return run->second.read.time + hold_;
+    }
+  }
+
+  return -1;
+}
+
+void ReadShaper::releaseUntil(long time)
+{
+  releaseOld(time);
+}
+
+bool ReadShaper::pop(ReplayOp &op)
+{
+  if (ready_.empty()) {
+    return false;
+  }
+
+  op = std::move(ready_.front());
+  ready_.pop_front();
+  return true;
+}
+
+void ReadShaper::print(std::ostream &out) const
+{
+  auto mb = [](long bytes) { return bytes / 1024.0 / 1024.0; };
+
+  out << "Read shaping (" << (mode_ == COALESCE ? "coalesce" : "read-ahead");
+  out << ", " << size_ / 1024 << " KB): " << reads_ << " reads of ";
+  out << mb(read_bytes_) << " MB sent as " << requests_ << " requests of ";
+  out << mb(request_bytes_) << " MB";
+  if (reads_ > 0) {
+    out << " (" << 100.0 * (reads_ - requests_) / reads_ << "% fewer)";
+  }
+  out << "." << std::endl;
+  out << "  over-read: " << mb(over_read_) << " MB";
+  if (mode_ == READ_AHEAD) {
+    out << ", reads served from read-ahead: " << served_;
+  }
+  out << std::endl;
+}
+
+size_t ReadShaper::KeyHash::operator()(const Key &key) const
+{
+  return std::hash<long>()(key.second) ^ std::hash<int>()(key.first);
+}
+
+void ReadShaper::coalesce(ReplayOp &op)
+{
+  Key key(op.tenant, op.handle);
+  auto run = runs_.find(key);
+
+  if (run != runs_.end()) {
+    ReplayOp &read = run->second.read;
+    long end = read.position + read.length;
+    long merged = op.position + op.length - read.position;
+
+    if (op.position >= end && op.position - end <= gap_ && merged <= size_) {
+      over_read_ += op.position - end;
+      read.length = merged;
+      return;
+    }
+    release(key);
+  }
+
+  Run &added = runs_[key];
+  added.read = std::move(op);
+  added.id = next_id_++;
+  held_.push_back(std::make_pair(added.id, key));
+}
+
+void ReadShaper::readAhead(ReplayOp &op)
+{
+  Key key(op.tenant, op.handle);
+  long end = op.position + op.length;
+  auto found = windows_.find(key);
+
+  if (found != windows_.end()) {
+    Window &window = found->second;
+    if (op.position >= window.start && end <= window.end) {
+      window.used = std::max(window.used, end);
+      window.last = end;
+      served_++;
+      return;
+    }
+  }
+
+  // only a read continuing the last one triggers read-ahead
+  bool sequential = found != windows_.end() 
+    && op.position == found->second.last;
+  if (found != windows_.end()) {
+    retire(found->second);
+  }
+
+  Window &window = windows_[key];
+  window.start = op.position;
+  window.used = end;
+  window.last = end;
+  if (sequential) {
+    op.length = std::max(op.length, size_);
+  }
+  window.end = op.position + op.length;
+
+  send(op);
+}
+
+/* Give out the read held for a file, if any */
+void ReadShaper::release(const Key &key)
+{
+  auto run = runs_.find(key);
+  if (run == runs_.end()) {
+    return;
+  }
+
+  send(run->second.read);
+  runs_.erase(run);
+}
+
+/* Give out reads held longer than allowed, runs given out before are
+ * left in the queue and skipped here. */
+void ReadShaper::releaseOld(long time)
+{
+  while (!held_.empty()) {
+    auto run = runs_.find(held_.front().second);
+
+    if (run != runs_.end() && run->second.id == held_.front().first) {
+      if (time - run->second.read.time < hold_) break;
+      release(run->first);
+    }
+    held_.pop_front();
+  }
+}
+
+void ReadShaper::retire(const Window &window)
+{
+  over_read_ += window.end - std::max(window.used, window.start);
+}
+
+void ReadShaper::send(ReplayOp &op)
+{
+  requests_++;
+  request_bytes_ += op.length;
+  ready_.push_back(std::move(op));
+}
@@ -0,0 +1,121 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// ReadShaper answers what-if questions about client side read
+// optimizations by rewriting reads of the log before they are replayed.
+//
+// In coalesce mode, reads of a file that follow each other, or leave a
+// gap of at most 'gap' bytes, are merged into one read of at most
+// 'size' bytes. A merged read is sent once the next read of the file
+// does not fit, the file is closed, or it has been held for 'hold'
+// nanoseconds of trace time. Since the next operation may come much
+// later, the caller asks for the deadline of the oldest merged read
+// and releases it at that time (see nextDeadline() and releaseUntil()).
+//
+// In read-ahead mode, a read that continues where the last read of the
+// file ended reads at least 'size' bytes, and later reads that fall in
+// what was read are served without a request, like a client buffer.
+//
+// Bytes read but never asked for by the log are counted as over-read.
+// Operations other than reads are passed through in order, except
+// that a close waits for reads of its file held back before it.
+
+#ifndef LIBHDFSPP_READSHAPER_H_
+#define LIBHDFSPP_READSHAPER_H_
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <ostream>
+#include <utility>
+#include <unordered_map>
+
+#include "ReplayOp.h"
+
+namespace hdfs
+{
+
+class ReadShaper
+{
+ public:
+  typedef enum {
+    COALESCE,
+    READ_AHEAD
+  } Mode;
+
+  ReadShaper(Mode mode, long size, long gap, long hold);
+  virtual ~ReadShaper();
+
+  //spec is "coalesce[:size=KB,gap=bytes,hold=ms]" or "readahead[:size=KB]"
+  static std::unique_ptr<ReadShaper> create(const std::string &spec);
+
+  void push(ReplayOp &op);    //op is moved from
+  void flush();               //end of log, give out all reads held
+  long nextDeadline() const;  //trace time a held read is due, -1 if none
+  void releaseUntil(long time); //give out reads due by then
+  bool pop(ReplayOp &op);
+
+  void print(std::ostream &out) const;
+
+ private:
+  typedef std::pair<int, long> Key;   //tenant and handle in the log
+
+  struct KeyHash {
+    size_t operator()(const Key &key) const;
+  };
+
+  struct Run {
+    ReplayOp read;      //merged read being held
+    unsigned long id;
+  };
+
+  struct Window {
+    long start;         //range read from backend
+    long end;
+    long used;          //end of bytes asked for by the log
+    long last;          //end of the last read of the log
+  };
+
+  void coalesce(ReplayOp &op);
+  void readAhead(ReplayOp &op);
+  void release(const Key &key);
+  void releaseOld(long time);
+  void retire(const Window &window);
+  void send(ReplayOp &op);
+
+  Mode mode_;
+  long size_;
+  long gap_;
+  long hold_;
+  unsigned long next_id_;
+  std::unordered_map<Key, Run, KeyHash> runs_;
+  std::deque<std::pair<unsigned long, Key>> held_;  //runs, oldest first
+  std::unordered_map<Key, Window, KeyHash> windows_;
+  std::deque<ReplayOp> ready_;
+
+  long reads_;
+  long read_bytes_;
+  long requests_;
+  long request_bytes_;
+  long served_;         //reads served from read-ahead
+  long over_read_;
+};
+
+} /* hdfs */ 
+
+#endif
@@ -0,0 +1,160 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdlib>
+#include <iostream>
+
+#include "ReplayBackend.h"
+#include "PosixBackend.h"
+#include "SimBackend.h"
+#ifdef HAVE_LIBHDFSPP
+#include "HdfsBackend.h"
+#endif
+
+using namespace hdfs;
+
+const ReplayBackend::File ReplayBackend::BAD_FILE;
+
+ReplayBackend::ReplayBackend()
+{
+}
+
+ReplayBackend::~ReplayBackend()
+{
+}
+
+std::string ReplayBackend::nameOf(const std::string &spec)
+{
+  return spec.substr(0, spec.find(':'));
+}
+
+std::unique_ptr<ReplayBackend> ReplayBackend::create(const std::string &spec, 
+    const char* host, int port)
+{
+  std::string name = nameOf(spec);
+  Options options;
+
+  if (!parseOptions(spec, options)) {
+    std::cerr << "Malformed backend options: " << spec << std::endl;
+    return nullptr;
+  }
+
+  std::unique_ptr<ReplayBackend> backend = createBackend(name, options, 
+      host, port);
+  if (backend != nullptr && !options.empty()) {
+    std::cerr << "Unknown option of " << name << " backend: ";
+    std::cerr << options.begin()->first << std::endl;
+    return nullptr;
+  }
+
+  return backend;
+}
+
+std::unique_ptr<ReplayBackend> ReplayBackend::createBackend(
+    const std::string &name, Options &options, const char* host, int port)
+{
+
+  if (name == "hdfs") {
+#ifdef HAVE_LIBHDFSPP
+    if (host == nullptr) {
+      std::cerr << "HDFS backend needs host and port." << std::endl;
+      return nullptr;
+    }
+
+    std::unique_ptr<HdfsBackend> backend(new HdfsBackend());
+    if (!backend->connect(host, port)) {
+      std::cerr << "Failed to connect to " << host << ":" << port << std::endl;
+      return nullptr;
+    }
+    return std::unique_ptr<ReplayBackend>(backend.release());
+#else
+    (void)host;
+    (void)port;
+    std::cerr << "Replayer is built without libhdfs++." << std::endl;
+    return nullptr;
+#endif
+  }
+
+  if (name == "posix") {
+    return std::unique_ptr<ReplayBackend>(new PosixBackend());
+  }
+
+  if (name == "sim") {
+    SimBackend::Model model;
+    bool ok = getNumber(options, "latency", model.latency)
+      && getNumber(options, "jitter", model.jitter)
+      && getNumber(options, "bandwidth", model.bandwidth)
+      && getNumber(options, "open", model.open_latency)
+      && getNumber(options, "close", model.close_latency)
+      && getNumber(options, "meta", model.meta_latency);
+
+    if (!ok) {
+      std::cerr << "Backend options must be non-negative numbers." << std::endl;
+      return nullptr;
+    }
+    return std::unique_ptr<ReplayBackend>(new SimBackend(model));
+  }
+
+  std::cerr << "Unknown backend: " << name << std::endl;
+  return nullptr;
+}
+
+/* Parse "name:key=value,key=value" into a map of options */
+bool ReplayBackend::parseOptions(const std::string &spec, Options &options)
+{
+  size_t pos = spec.find(':');
+  if (pos == std::string::npos) {
+    return true;
+  }
+
+  std::string rest = spec.substr(pos + 1);
+  while (!rest.empty()) {
+    size_t comma = rest.find(',');
+    std::string option = rest.substr(0, comma);
+    size_t equal = option.find('=');
+
+    if (equal == std::string::npos || equal == 0) return false;
+    options[option.substr(0, equal)] = option.substr(equal + 1);
+
+    if (comma == std::string::npos) break;
+    rest = rest.substr(comma + 1);
+  }
+
+  return true;
+}
+
+/* Leave value untouched when the option is absent. Consumed options
+ * are removed, so those left over are unknown to the backend. */
+bool ReplayBackend::getNumber(Options &options, const std::string &key, 
+    double &value)
+{
+  auto option = options.find(key);
+  if (option == options.end()) {
+    return true;
+  }
+
+  char* end = nullptr;
+  double number = std::strtod(option->second.c_str(), &end);
+  if (end == option->second.c_str() || *end != '\0' || number < 0) {
+    return false;
+  }
+
+  value = number;
+  options.erase(option);
+  return true;
+}
@@ -0,0 +1,75 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Interface of the storage a log is replayed against. Replayer only
+// talks to this interface, so the same log can be replayed against
+// HDFS through libhdfs++, local files through POSIX calls, or a
+// simulated store that needs neither a cluster nor a disk.
+//
+// A backend is selected by a spec "name[:key=value,...]", e.g. "hdfs",
+// "posix" or "sim:latency=500,bandwidth=100". Backends are shared by
+// all replay threads and must be thread safe.
+
+#ifndef LIBHDFSPP_REPLAYBACKEND_H_
+#define LIBHDFSPP_REPLAYBACKEND_H_
+
+#include <map>
+#include <memory>
+#include <string>
+
+namespace hdfs
+{
+
+class ReplayBackend
+{
+ public:
+  typedef long File;            //handle of an opened file
+  static const File BAD_FILE = -1;
+
+  ReplayBackend();
+  virtual ~ReplayBackend();
+
+  virtual File open(const std::string &path, int flags, int bufferSize, 
+      short replication, int blockSize) = 0;
+  virtual long pread(File file, long offset, char* buffer, size_t length) = 0;
+  virtual int close(File file) = 0;
+  virtual long write(File file, const char* buffer, size_t length) = 0;
+  virtual int flush(File file) = 0;
+  virtual int hsync(File file) = 0;
+  virtual int seek(File file, long offset) = 0;
+  virtual int getFileInfo(const std::string &path) = 0; //0 if it exists
+  virtual long listDir(const std::string &path) = 0;    //entries, -1 on error
+
+  static std::string nameOf(const std::string &spec);
+  static std::unique_ptr<ReplayBackend> create(const std::string &spec, 
+      const char* host, int port);
+
+  // also used for other specs in the same form
+  typedef std::map<std::string, std::string> Options;
+  static bool parseOptions(const std::string &spec, Options &options);
+  static bool getNumber(Options &options, const std::string &key, 
+      double &value);
+
+ protected:
+  static std::unique_ptr<ReplayBackend> createBackend(const std::string &name, 
+      Options &options, const char* host, int port);
+};
+
+} /* hdfs */ 
+
+#endif
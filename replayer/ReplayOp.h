@@ -0,0 +1,66 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A file operation decoded from a log record, holding only what
+// replayer needs. Records are turned into ReplayOps once, by the
+// decoding thread, so the dispatching thread never touches protobuf.
+
+#ifndef LIBHDFSPP_REPLAYOP_H_
+#define LIBHDFSPP_REPLAYOP_H_
+
+#include <string>
+
+#include "log.pb.h"
+
+namespace hdfs
+{
+
+struct ReplayOp
+{
+  hadoop::hdfs::log_FuncType type;
+  int tenant;         //which instance of the trace this belongs to
+  long time;          //nanoseconds since the first record of the trace
+  long thread;        //id of the traced thread
+  long handle;        //OPEN_RET, CLOSE and calls on an open file
+  long position;      //READ and SEEK
+  long length;        //READ and WRITE
+  int flags;          //OPEN
+  int buffer_size;    //OPEN
+  short replication;  //OPEN
+  int block_size;     //OPEN
+  std::string path;   //OPEN, GETFILEINFO and LISTDIR
+
+  ReplayOp()
+    : type(hadoop::hdfs::log_FuncType_OPEN)
+    , tenant(0)
+    , time(0)
+    , thread(0)
+    , handle(0)
+    , position(0)
+    , length(0)
+    , flags(0)
+    , buffer_size(0)
+    , replication(0)
+    , block_size(0)
+  {
+  }
+};
+
+} /* hdfs */ 
+
+#endif
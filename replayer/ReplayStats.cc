@@ -0,0 +1,448 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "ReplayStats.h"
+
+#define MB (1024.0 * 1024.0)
+
+using namespace hdfs;
+
+static const double PERCENTILES[] = {50, 90, 99, 99.9};
+static const char* PERCENTILE_NAMES[] = {"p50", "p90", "p99", "p999"};
+static const int NUM_PERCENTILES = 4;
+
+ReplayStats::ReplayStats(unsigned slots)
+  : finished_(false)
+  , loaded_seconds_(0)
+  , last_bytes_(0)
+  , has_lateness_(false)
+{
+  for (unsigned i = 0; i < slots; ++i) {
+    std::unique_ptr<Slot> slot(new Slot());
+    for (auto &counter : slot->counters) {
+      counter.ops.store(0);
+      counter.bytes.store(0);
+      counter.errors.store(0);
+    }
+    slots_.push_back(std::move(slot));
+  }
+
+  for (int op = 0; op < NUM_OPS; ++op) {
+    last_ops_[op] = 0;
+  }
+  start();
+}
+
+ReplayStats::~ReplayStats()
+{
+}
+
+const char* ReplayStats::opName(OpType op)
+{
+  switch (op) {
+    case OPEN:
+      return "open";
+    case READ:
+      return "read";
+    case CLOSE:
+      return "close";
+    case WRITE:
+      return "write";
+    case FLUSH:
+      return "flush";
+    case HSYNC:
+      return "hsync";
+    case SEEK:
+      return "seek";
+    case GETFILEINFO:
+      return "getfileinfo";
+    case LISTDIR:
+      return "listdir";
+    default:
+      return "unknown";
+  }
+}
+
+void ReplayStats::start()
+{
+  start_ = Clock::now();
+  end_ = start_;
+  last_sample_ = start_;
+  finished_ = false;
+}
+
+/* Only the thread owning the slot may call this */
+void ReplayStats::record(unsigned slot, OpType op, long latency, long bytes)
+{
+  Slot &s = *slots_[slot];
+
+  s.latency[op].record(latency);
+  add(s.counters[op].ops, 1);
+  if (bytes > 0) add(s.counters[op].bytes, bytes);
+}
+
+/* Only the thread owning the slot may call this */
+void ReplayStats::recordError(unsigned slot, OpType op)
+{
+  add(slots_[slot]->counters[op].errors, 1);
+}
+
+void ReplayStats::sample(std::ostream &out)
+{
+  // operations stopped at the end of replay, not when we got here
+  Clock::time_point now = finished_ ? end_ : Clock::now();
+  std::chrono::duration<double> seconds = now - last_sample_;
+  if (seconds.count() <= 0) return;
+
+  Interval interval;
+  interval.end = std::chrono::duration<double>(now - start_).count();
+  interval.seconds = seconds.count();
+
+  uint64_t ops = 0;
+  for (int op = 0; op < NUM_OPS; ++op) {
+    uint64_t count = total((OpType)op, &Counter::ops);
+    interval.ops[op] = count - last_ops_[op];
+    last_ops_[op] = count;
+    ops += interval.ops[op];
+  }
+
+  uint64_t bytes = total(READ, &Counter::bytes) + total(WRITE, &Counter::bytes);
+  interval.bytes = bytes - last_bytes_;
+  last_bytes_ = bytes;
+  last_sample_ = now;
+  intervals_.push_back(interval);
+
+  out << "Current bandwidth: " << interval.bytes / interval.seconds / MB;
+  out << " MB/s, " << ops / interval.seconds << " ops/s" << std::endl;
+}
+
+void ReplayStats::finish()
+{
+  end_ = Clock::now();
+  finished_ = true;
+}
+
+void ReplayStats::setLateness(const Histogram &lateness)
+{
+  has_lateness_ = true;
+  lateness_ = lateness;
+}
+
+/* Print a summary of the whole replay */
+void ReplayStats::print(std::ostream &out) const
+{
+  double seconds = elapsed();
+  auto us = [](long ns) { return ns / 1000.0; };
+
+  out << "Latency (us):" << std::endl;
+  for (int op = 0; op < NUM_OPS; ++op) {
+    Histogram h = latency((OpType)op);
+    uint64_t errors = total((OpType)op, &Counter::errors);
+    if (h.count() == 0 && errors == 0) continue;
+
+    out << "  " << std::left << std::setw(11) << opName((OpType)op);
+    out << std::right << " count: " << h.count();
+    out << " mean: " << h.mean() / 1000;
+    for (int i = 0; i < NUM_PERCENTILES; ++i) {
+      out << " " << PERCENTILE_NAMES[i] << ": " << us(h.percentile(PERCENTILES[i]));
+    }
+    out << " max: " << us(h.max());
+
+    if (errors > 0) out << " errors: " << errors;
+    out << std::endl;
+  }
+
+  if (seconds > 0) {
+    out << "Throughput: " << operations() / seconds << " ops/s, ";
+    out << total(READ, &Counter::bytes) / seconds / MB << " MB/s";
+    uint64_t written = total(WRITE, &Counter::bytes);
+    if (written > 0) out << ", " << written / seconds / MB << " MB/s written";
+    out << std::endl;
+  }
+}
+
+bool ReplayStats::write(const std::string &path) const
+{
+  const std::string suffix(".csv");
+  bool csv = path.size() >= suffix.size() && 
+    path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+
+  std::ofstream out(path);
+  if (!out) return false;
+
+  if (!csv) {
+    return writeJson(out);
+  }
+
+  // intervals do not fit into the summary table, they get their own file
+  std::string intervalPath = path.substr(0, path.size() - suffix.size());
+  intervalPath.append("_intervals.csv");
+  std::ofstream intervals(intervalPath);
+  if (!intervals) return false;
+
+  return writeCsv(out, intervals);
+}
+
+/* Single writer, so a load and a store are enough and no locked
+ * instruction is needed. */
+void ReplayStats::add(std::atomic<uint64_t> &counter, uint64_t value)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + value, 
+      std::memory_order_relaxed);
+}
+
+uint64_t ReplayStats::total(OpType op, 
+    std::atomic<uint64_t> Counter::*field) const
+{
+  uint64_t sum = 0;
+  for (auto &slot : slots_) {
+    sum += (slot->counters[op].*field).load(std::memory_order_relaxed);
+  }
+
+  return sum;
+}
+
+/* Merged latency of all slots, only valid after all threads are done */
+Histogram ReplayStats::latency(OpType op) const
+{
+  Histogram merged;
+  for (auto &slot : slots_) {
+    merged.merge(slot->latency[op]);
+  }
+
+  return merged;
+}
+
+uint64_t ReplayStats::operations() const
+{
+  uint64_t ops = 0;
+  for (int op = 0; op < NUM_OPS; ++op) {
+    ops += total((OpType)op, &Counter::ops);
+  }
+
+  return ops;
+}
+
+double ReplayStats::elapsed() const
+{
+  double seconds = std::chrono::duration<double>(end_ - start_).count();
+  return seconds > loaded_seconds_ ? seconds : loaded_seconds_;
+}
+
+/* Results as lines of text, ended by a line "end". Only valid after
+ * all threads are done. */
+void ReplayStats::save(std::ostream &out) const
+{
+  out << "elapsed " << elapsed() << std::endl;
+  for (int op = 0; op < NUM_OPS; ++op) {
+    out << "op " << op;
+    out << " " << total((OpType)op, &Counter::ops);
+    out << " " << total((OpType)op, &Counter::bytes);
+    out << " " << total((OpType)op, &Counter::errors) << " ";
+    latency((OpType)op).save(out);
+    out << std::endl;
+  }
+
+  if (has_lateness_) {
+    out << "lateness ";
+    lateness_.save(out);
+    out << std::endl;
+  }
+
+  for (auto &interval : intervals_) {
+    out << "interval " << interval.end << " " << interval.seconds;
+    for (int op = 0; op < NUM_OPS; ++op) {
+      out << " " << interval.ops[op];
+    }
+    out << " " << interval.bytes << std::endl;
+  }
+  out << "end" << std::endl;
+}
+
+/* Loaded results are added to the first slot. Intervals are matched
+ * by position, so results should come from replays started together. */
+bool ReplayStats::load(std::istream &in)
+{
+  Slot &slot = *slots_[0];
+  size_t next_interval = 0;
+  std::string line;
+
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string kind;
+    fields >> kind;
+
+    if (kind == "end") {
+      return true;
+    } else if (kind == "elapsed") {
+      double seconds;
+      if (!(fields >> seconds)) return false;
+      if (seconds > loaded_seconds_) loaded_seconds_ = seconds;
+    } else if (kind == "op") {
+      int op;
+      uint64_t ops, bytes, errors;
+      if (!(fields >> op >> ops >> bytes >> errors)) return false;
+      if (op < 0 || op >= NUM_OPS) return false;
+
+      add(slot.counters[op].ops, ops);
+      add(slot.counters[op].bytes, bytes);
+      add(slot.counters[op].errors, errors);
+      if (!slot.latency[op].load(fields)) return false;
+    } else if (kind == "lateness") {
+      if (!lateness_.load(fields)) return false;
+      has_lateness_ = true;
+    } else if (kind == "interval") {
+      Interval interval;
+      if (!(fields >> interval.end >> interval.seconds)) return false;
+      for (int op = 0; op < NUM_OPS; ++op) {
+        if (!(fields >> interval.ops[op])) return false;
+      }
+      if (!(fields >> interval.bytes)) return false;
+
+      if (next_interval == intervals_.size()) {
+        intervals_.push_back(interval);
+      } else {
+        Interval &merged = intervals_[next_interval];
+        for (int op = 0; op < NUM_OPS; ++op) {
+          merged.ops[op] += interval.ops[op];
+        }
+        merged.bytes += interval.bytes;
+        if (interval.end > merged.end) merged.end = interval.end;
+        if (interval.seconds > merged.seconds) merged.seconds = interval.seconds;
+      }
+      next_interval++;
+    } else {
+      return false;
+    }
+  }
+
+  return false;   //"end" never came
+}
+
+bool ReplayStats::writeJson(std::ostream &out) const
+{
+  double seconds = elapsed();
+  auto writeHistogram = [&out](const Histogram &h) {
+    out << "\"count\": " << h.count();
+    out << ", \"mean_us\": " << h.mean() / 1000;
+    for (int i = 0; i < NUM_PERCENTILES; ++i) {
+      out << ", \"" << PERCENTILE_NAMES[i] << "_us\": ";
+      out << h.percentile(PERCENTILES[i]) / 1000.0;
+    }
+    out << ", \"max_us\": " << h.max() / 1000.0;
+  };
+
+  uint64_t ops = 0;
+  out << "{" << std::endl;
+  out << "  \"elapsed_seconds\": " << seconds << "," << std::endl;
+  out << "  \"operations\": {" << std::endl;
+  for (int op = 0; op < NUM_OPS; ++op) {
+    ops += total((OpType)op, &Counter::ops);
+    out << "    \"" << opName((OpType)op) << "\": {";
+    writeHistogram(latency((OpType)op));
+    out << ", \"bytes\": " << total((OpType)op, &Counter::bytes);
+    out << ", \"errors\": " << total((OpType)op, &Counter::errors) << "}";
+    out << (op + 1 < NUM_OPS ? "," : "") << std::endl;
+  }
+  out << "  }," << std::endl;
+
+  out << "  \"throughput\": {";
+  out << "\"ops_per_second\": " << (seconds > 0 ? ops / seconds : 0);
+  out << ", \"mb_per_second\": ";
+  out << (seconds > 0 ? total(READ, &Counter::bytes) / seconds / MB : 0);
+  out << ", \"written_mb_per_second\": ";
+  out << (seconds > 0 ? total(WRITE, &Counter::bytes) / seconds / MB : 0);
+  out << "}," << std::endl;
+
+  if (has_lateness_) {
+    out << "  \"dispatch_lateness\": {";
+    writeHistogram(lateness_);
+    out << "}," << std::endl;
+  }
+
+  out << "  \"intervals\": [" << std::endl;
+  for (size_t i = 0; i < intervals_.size(); ++i) {
+    const Interval &interval = intervals_[i];
+    uint64_t count = 0;
+
+    out << "    {\"end_seconds\": " << interval.end;
+    for (int op = 0; op < NUM_OPS; ++op) {
+      count += interval.ops[op];
+      out << ", \"" << opName((OpType)op) << "\": " << interval.ops[op];
+    }
+    out << ", \"ops_per_second\": " << count / interval.seconds;
+    out << ", \"mb_per_second\": " << interval.bytes / interval.seconds / MB;
+    out << "}" << (i + 1 < intervals_.size() ? "," : "") << std::endl;
+  }
+  out << "  ]" << std::endl;
+  out << "}" << std::endl;
+
+  return out.good();
+}
+
+bool ReplayStats::writeCsv(std::ostream &out, std::ostream &intervals) const
+{
+  auto writeRow = [&out](const char* name, const Histogram &h, 
+      uint64_t bytes, uint64_t errors) {
+    out << name << "," << h.count() << "," << bytes << "," << errors;
+    out << "," << h.mean() / 1000;
+    for (int i = 0; i < NUM_PERCENTILES; ++i) {
+      out << "," << h.percentile(PERCENTILES[i]) / 1000.0;
+    }
+    out << "," << h.max() / 1000.0 << std::endl;
+  };
+
+  out << "op,count,bytes,errors,mean_us";
+  for (int i = 0; i < NUM_PERCENTILES; ++i) {
+    out << "," << PERCENTILE_NAMES[i] << "_us";
+  }
+  out << ",max_us" << std::endl;
+
+  for (int op = 0; op < NUM_OPS; ++op) {
+    writeRow(opName((OpType)op), latency((OpType)op), 
+        total((OpType)op, &Counter::bytes), 
+        total((OpType)op, &Counter::errors));
+  }
+  if (has_lateness_) {
+    writeRow("dispatch_lateness", lateness_, 0, 0);
+  }
+
+  intervals << "end_seconds";
+  for (int op = 0; op < NUM_OPS; ++op) {
+    intervals << "," << opName((OpType)op);
+  }
+  intervals << ",ops_per_second,mb_per_second" << std::endl;
+
+  for (auto &interval : intervals_) {
+    uint64_t count = 0;
+
+    intervals << interval.end;
+    for (int op = 0; op < NUM_OPS; ++op) {
+      count += interval.ops[op];
+      intervals << "," << interval.ops[op];
+    }
+    intervals << "," << count / interval.seconds;
+    intervals << "," << interval.bytes / interval.seconds / MB << std::endl;
+  }
+
+  return out.good() && intervals.good();
+}
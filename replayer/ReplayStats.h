@@ -0,0 +1,123 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// ReplayStats collects latency and throughput of replayed operations.
+// Every thread owns a slot and is the only one writing to it, so
+// recording an operation takes no lock: latencies go to per-slot
+// histograms which are only read once replay is over, and operation
+// and byte counters are relaxed atomics which a reporting thread can
+// sample at any time to compute wall-clock throughput per interval.
+// Results can be written as JSON or CSV for comparing runs, or saved
+// as text and loaded into another ReplayStats, which is how results of
+// distributed replay are put together.
+
+#ifndef LIBHDFSPP_REPLAYSTATS_H_
+#define LIBHDFSPP_REPLAYSTATS_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "Histogram.h"
+
+namespace hdfs
+{
+
+class ReplayStats
+{
+ public:
+  typedef enum {
+    OPEN,
+    READ,
+    CLOSE,
+    WRITE,
+    FLUSH,
+    HSYNC,
+    SEEK,
+    GETFILEINFO,
+    LISTDIR,
+    NUM_OPS
+  } OpType;
+
+  ReplayStats(unsigned slots);
+  virtual ~ReplayStats();
+
+  static const char* opName(OpType op);
+
+  void start();
+  void record(unsigned slot, OpType op, long latency, long bytes);
+  void recordError(unsigned slot, OpType op);
+  void sample(std::ostream &out);   //print and keep throughput since last sample
+  void finish();
+  void setLateness(const Histogram &lateness);
+
+  void print(std::ostream &out) const;
+  bool write(const std::string &path) const;  //CSV if path ends with .csv
+
+  uint64_t operations() const;
+  double elapsed() const;
+  void save(std::ostream &out) const;
+  bool load(std::istream &in);      //add saved results to these
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Counter {
+    std::atomic<uint64_t> ops;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> errors;
+  };
+
+  struct Slot {
+    Counter counters[NUM_OPS];
+    Histogram latency[NUM_OPS];
+  };
+
+  struct Interval {
+    double end;       //seconds since start
+    double seconds;
+    uint64_t ops[NUM_OPS];
+    uint64_t bytes;   //read and written
+  };
+
+  static void add(std::atomic<uint64_t> &counter, uint64_t value);
+  uint64_t total(OpType op, std::atomic<uint64_t> Counter::*field) const;
+  Histogram latency(OpType op) const;
+
+  bool writeJson(std::ostream &out) const;
+  bool writeCsv(std::ostream &out, std::ostream &intervals) const;
+
+  std::vector<std::unique_ptr<Slot>> slots_;
+  Clock::time_point start_;
+  Clock::time_point end_;
+  Clock::time_point last_sample_;
+  bool finished_;
+  double loaded_seconds_;   //longest replay among loaded results
+  uint64_t last_ops_[NUM_OPS];
+  uint64_t last_bytes_;
+  std::vector<Interval> intervals_;
+  bool has_lateness_;
+  Histogram lateness_;
+};
+
+} /* hdfs */ 
+
+#endif
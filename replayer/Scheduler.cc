@@ -0,0 +1,126 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thread>
+#include <algorithm>
+
+#include "Scheduler.h"
+
+using namespace hdfs;
+
+Scheduler::Scheduler(bool timed, double speed, size_t window, int tenants)
+  : timed_(timed)
+  , speed_(speed > 0 ? speed : 1)
+  , window_(window > 0 ? window : 1)
+  , pending_(tenants > 0 ? tenants : 1, 0)
+  , started_(false)
+  , base_offset_(0)
+  , seq_(0)
+{
+}
+
+Scheduler::~Scheduler()
+{
+}
+
+/* Start the replay clock at a given time, where trace time 'base' is
+ * due, instead of when the first operation is handed out. */
+void Scheduler::startAt(Clock::time_point start, long base)
+{
+  started_ = true;
+  start_ = start;
+  base_offset_ = base;
+}
+
+void Scheduler::push(ReplayOp &op)
+{
+  Entry entry;
+  entry.seq = seq_++;
+  entry.op = std::move(op);
+  pending_[entry.op.tenant]++;
+
+  heap_.push_back(std::move(entry));
+  std::push_heap(heap_.begin(), heap_.end(), later);
+}
+
+bool Scheduler::needs(int tenant) const
+{
+  return pending_[tenant] < window_;
+}
+
+bool Scheduler::empty() const
+{
+  return heap_.empty();
+}
+
+long Scheduler::nextTime() const
+{
+  return heap_.front().op.time;
+}
+
+bool Scheduler::pop(ReplayOp &op)
+{
+  if (heap_.empty()) {
+    return false;
+  }
+
+  std::pop_heap(heap_.begin(), heap_.end(), later);
+  op = std::move(heap_.back().op);
+  heap_.pop_back();
+  pending_[op.tenant]--;
+
+  // the replay clock starts when the first record is handed out, so
+  // filling the window beforehand does not count as lateness
+  if (!started_) {
+    started_ = true;
+    start_ = Clock::now();
+    base_offset_ = op.time;
+  }
+
+  if (timed_) {
+    long offset = (long)((op.time - base_offset_) / speed_);
+    auto deadline = start_ + std::chrono::nanoseconds(offset);
+
+    std::this_thread::sleep_until(deadline);
+    lateness_.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+          Clock::now() - deadline).count());
+  }
+
+  return true;
+}
+
+/* Not counted as lateness, nothing of the log is handed out */
+void Scheduler::waitUntil(long time)
+{
+  if (!timed_ || !started_) {
+    return;
+  }
+
+  long offset = (long)((time - base_offset_) / speed_);
+  std::this_thread::sleep_until(start_ + std::chrono::nanoseconds(offset));
+}
+
+const Histogram& Scheduler::lateness() const
+{
+  return lateness_;
+}
+
+bool Scheduler::later(const Entry &l, const Entry &r)
+{
+  return (l.op.time > r.op.time) || (l.op.time == r.op.time && l.seq > r.seq);
+}
@@ -0,0 +1,89 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Scheduler keeps decoded operations in a min heap ordered by trace
+// time and hands them out in that order. In timed mode a record is not
+// handed out before its deadline: its offset from the first record of
+// the trace divided by the speed factor, counted from the moment replay
+// starts. Deadlines are absolute, so time spent opening files or
+// waiting for workers never accumulates into drift; a late record is
+// dispatched at once and the records after it are still on time. How
+// late every record was dispatched is kept for reporting.
+//
+// Operations may come from several tenants, each replaying the trace
+// on its own; the heap merges them into one stream. Callers should keep
+// 'window' operations of every tenant in the heap, which also puts
+// slightly unordered records, e.g. from merged logs, back into trace
+// order as long as they are within the window. The window is thus how
+// far replay decodes ahead of dispatch.
+//
+// Work due at a trace time between operations, such as reads held back
+// for merging, can wait for the deadline of that time too.
+
+#ifndef LIBHDFSPP_SCHEDULER_H_
+#define LIBHDFSPP_SCHEDULER_H_
+
+#include <chrono>
+#include <vector>
+
+#include "Histogram.h"
+#include "ReplayOp.h"
+
+namespace hdfs
+{
+
+class Scheduler
+{
+ public:
+  Scheduler(bool timed, double speed, size_t window, int tenants);
+  virtual ~Scheduler();
+
+  void startAt(std::chrono::steady_clock::time_point start, long base);
+  void push(ReplayOp &op);      //op is moved from
+  bool needs(int tenant) const; //fewer than 'window' ops of the tenant
+  bool empty() const;
+  long nextTime() const;        //trace time of the next op, if not empty
+  bool pop(ReplayOp &op);
+  void waitUntil(long time);    //for the deadline of a trace time
+
+  const Histogram& lateness() const;
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Entry {
+    unsigned long seq;  //keeps records with equal time in log order
+    ReplayOp op;
+  };
+  static bool later(const Entry &l, const Entry &r);
+
+  bool timed_;
+  double speed_;
+  size_t window_;
+  std::vector<size_t> pending_; //ops in heap per tenant
+  bool started_;
+  long base_offset_;
+  unsigned long seq_;
+  Clock::time_point start_;
+  std::vector<Entry> heap_;
+  Histogram lateness_;
+};
+
+} /* hdfs */ 
+
+#endif
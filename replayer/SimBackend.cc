@@ -0,0 +1,138 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <random>
+#include <thread>
+#include <functional>
+
+#include "SimBackend.h"
+
+using namespace hdfs;
+
+SimBackend::Model::Model()
+  : latency(0)
+  , jitter(0)
+  , bandwidth(0)
+  , open_latency(0)
+  , close_latency(0)
+  , meta_latency(0)
+{
+}
+
+SimBackend::SimBackend(const Model &model)
+  : model_(model)
+  , next_file_(1)
+  , link_mutex_()
+  , link_free_(Clock::now())
+{
+}
+
+SimBackend::~SimBackend()
+{
+}
+
+ReplayBackend::File SimBackend::open(const std::string &, int, int, 
+    short, int)
+{
+  delay(Clock::now(), model_.open_latency, 0);
+  return next_file_++;
+}
+
+long SimBackend::pread(File, long, char*, size_t length)
+{
+  delay(Clock::now(), model_.latency, length);
+  return (long)length;
+}
+
+int SimBackend::close(File)
+{
+  delay(Clock::now(), model_.close_latency, 0);
+  return 0;
+}
+
+long SimBackend::write(File, const char*, size_t length)
+{
+  delay(Clock::now(), model_.latency, length);
+  return (long)length;
+}
+
+int SimBackend::flush(File)
+{
+  delay(Clock::now(), model_.latency, 0);
+  return 0;
+}
+
+int SimBackend::hsync(File)
+{
+  delay(Clock::now(), model_.latency, 0);
+  return 0;
+}
+
+int SimBackend::seek(File, long)
+{
+  return 0;
+}
+
+int SimBackend::getFileInfo(const std::string &)
+{
+  delay(Clock::now(), model_.meta_latency, 0);
+  return 0;
+}
+
+long SimBackend::listDir(const std::string &)
+{
+  delay(Clock::now(), model_.meta_latency, 0);
+  return 0;
+}
+
+/* Block the calling thread for the latency of a request and, if a
+ * bandwidth is set, until the link has transferred its bytes after
+ * those queued before it. */
+void SimBackend::delay(Clock::time_point start, double micros, size_t bytes)
+{
+  micros += jitter();
+  Clock::time_point done = start + std::chrono::nanoseconds(
+      (long)(micros * 1000));
+
+  if (bytes > 0 && model_.bandwidth > 0) {
+    auto transfer = std::chrono::nanoseconds(
+        (long)(bytes / model_.bandwidth / (1024 * 1024) * 1000000000));
+
+    std::lock_guard<std::mutex> lock(link_mutex_);
+    if (link_free_ < done) link_free_ = done;
+    link_free_ += transfer;
+    done = link_free_;
+  }
+
+  if (done > start) {
+    std::this_thread::sleep_until(done);
+  }
+}
+
+double SimBackend::jitter()
+{
+  if (model_.jitter <= 0) {
+    return 0;
+  }
+
+  static thread_local std::minstd_rand random(
+      std::hash<std::thread::id>()(std::this_thread::get_id()));
+  std::uniform_real_distribution<double> uniform(0, model_.jitter);
+
+  return uniform(random);
+}
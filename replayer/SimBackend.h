@@ -0,0 +1,91 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A simulated store that keeps no data. Every request takes a fixed
+// latency plus a random jitter, and reads additionally queue for a
+// link of limited bandwidth shared by all threads, so the store
+// saturates like a real one would. With all parameters left at zero
+// it does nothing at all, which is useful to measure the overhead of
+// replayer itself.
+//
+// Writes are served like reads, and flushes and hsyncs take the read
+// latency without any bytes. Seeks take no time.
+//
+// Options of the "sim" backend spec, all in microsecond or MB/s:
+//   latency    per read or write latency
+//   jitter     upper bound of uniformly distributed extra latency
+//   bandwidth  bandwidth of the shared link, 0 means unlimited
+//   open       latency of open
+//   close      latency of close
+//   meta       latency of getfileinfo and listdir
+
+#ifndef LIBHDFSPP_SIMBACKEND_H_
+#define LIBHDFSPP_SIMBACKEND_H_
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#include "ReplayBackend.h"
+
+namespace hdfs
+{
+
+class SimBackend : public ReplayBackend
+{
+ public:
+  struct Model {
+    double latency;
+    double jitter;
+    double bandwidth;
+    double open_latency;
+    double close_latency;
+    double meta_latency;
+
+    Model();
+  };
+
+  SimBackend(const Model &model);
+  virtual ~SimBackend();
+
+  virtual File open(const std::string &path, int flags, int bufferSize, 
+      short replication, int blockSize);
+  virtual long pread(File file, long offset, char* buffer, size_t length);
+  virtual int close(File file);
+  virtual long write(File file, const char* buffer, size_t length);
+  virtual int flush(File file);
+  virtual int hsync(File file);
+  virtual int seek(File file, long offset);
+  virtual int getFileInfo(const std::string &path);
+  virtual long listDir(const std::string &path);
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  void delay(Clock::time_point start, double micros, size_t bytes);
+  double jitter();
+
+  Model model_;
+  std::atomic<long> next_file_;
+  std::mutex link_mutex_;
+  Clock::time_point link_free_;   //when the link finishes queued transfers
+};
+
+} /* hdfs */ 
+
+#endif
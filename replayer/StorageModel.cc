@@ -0,0 +1,226 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <functional>
+
+#include "ReplayBackend.h"
+#include "StorageModel.h"
+
+using namespace hdfs;
+
+static uint64_t mix(uint64_t x)
+{
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+std::unique_ptr<StorageModel> StorageModel::create(const std::string &spec)
+{
+  std::string name = spec.substr(0, spec.find(':'));
+  ReplayBackend::Options options;
+  double nodes = 10, slots = 8, latency = 500, bandwidth = 100;
+  double replication = 3, block = 128, handlers = 16, open = 1000, close = 500;
+
+  if (name != "cluster") {
+    std::cerr << "Unknown storage model: " << name << std::endl;
+    return nullptr;
+  }
+  if (!ReplayBackend::parseOptions(spec, options)) {
+    std::cerr << "Malformed storage model options: " << spec << std::endl;
+    return nullptr;
+  }
+
+  bool ok = ReplayBackend::getNumber(options, "nodes", nodes)
+    && ReplayBackend::getNumber(options, "slots", slots)
+    && ReplayBackend::getNumber(options, "latency", latency)
+    && ReplayBackend::getNumber(options, "bandwidth", bandwidth)
+    && ReplayBackend::getNumber(options, "replication", replication)
+    && ReplayBackend::getNumber(options, "block", block)
+    && ReplayBackend::getNumber(options, "handlers", handlers)
+    && ReplayBackend::getNumber(options, "open", open)
+    && ReplayBackend::getNumber(options, "close", close);
+  if (!ok || nodes < 1 || slots < 1 || bandwidth <= 0 || replication < 1 
+      || block <= 0 || handlers < 1) {
+    std::cerr << "Storage model options must be positive numbers." << std::endl;
+    return nullptr;
+  }
+  if (!options.empty()) {
+    std::cerr << "Unknown option of storage model: ";
+    std::cerr << options.begin()->first << std::endl;
+    return nullptr;
+  }
+
+  return std::unique_ptr<StorageModel>(new StorageModel((long)nodes, 
+        (long)slots, (long)(latency * 1000), bandwidth, 
+        std::min((long)replication, (long)nodes), (long)(block * 1024 * 1024), 
+        (long)handlers, (long)(open * 1000), (long)(close * 1000)));
+}
+
+StorageModel::StorageModel(long nodes, long slots, long latency, 
+    double bandwidth, long replication, long block, long handlers, long open, 
+    long close)
+  : latency_(latency)
+  , ns_per_byte_(1000000000 / (bandwidth * 1024 * 1024))
+  , replication_(replication)
+  , block_(block)
+  , open_(open)
+  , close_(close)
+  , namenode_{std::vector<long>(handlers, 0), 0, 0, 0}
+  , nodes_(nodes, DataNode{Servers{std::vector<long>(slots, 0), 0, 0, 0}, 0, 0})
+{
+}
+
+StorageModel::~StorageModel()
+{
+}
+
+long StorageModel::open(long time)
+{
+  return namenode_.serve(time, open_);
+}
+
+long StorageModel::close(long time)
+{
+  return namenode_.serve(time, close_);
+}
+
+/* Blocks of a read are served at once, the read is done with the last */
+long StorageModel::read(long time, uint64_t file, long offset, long length)
+{
+  long done = time;
+  long end = offset + std::max(length, 0L);
+
+  do {
+    long block = offset / block_;
+    long piece = std::min(end, (block + 1) * block_) - offset;
+    done = std::max(done, readBlock(time, file, block, piece));
+    offset += piece;
+  } while (offset < end);
+
+  return done;
+}
+
+long StorageModel::readBlock(long time, uint64_t file, long block, long length)
+{
+  uint64_t base = mix(file ^ mix(block));
+  DataNode* node = nullptr;
+  long ready = 0;
+
+  for (long r = 0; r < replication_; ++r) {
+    DataNode &replica = nodes_[(base + r) % nodes_.size()];
+    long replica_ready = std::max(replica.servers.next() + latency_, 
+        replica.link_free);
+    if (node == nullptr || replica_ready < ready) {
+      node = &replica;
+      ready = replica_ready;
+    }
+  }
+
+  return serve(*node, time, length);
+}
+
+/* Blocks of a write are served at once, the write is done with the last */
+long StorageModel::write(long time, uint64_t file, long offset, long length)
+{
+  long done = time;
+  long end = offset + std::max(length, 0L);
+
+  do {
+    long block = offset / block_;
+    long piece = std::min(end, (block + 1) * block_) - offset;
+    done = std::max(done, writeBlock(time, file, block, piece));
+    offset += piece;
+  } while (offset < end);
+
+  return done;
+}
+
+long StorageModel::writeBlock(long time, uint64_t file, long block, long length)
+{
+  uint64_t base = mix(file ^ mix(block));
+  long done = time;
+
+  //every replica of the pipeline stores the bytes, the slowest acks last
+  for (long r = 0; r < replication_; ++r) {
+    DataNode &replica = nodes_[(base + r) % nodes_.size()];
+    done = std::max(done, serve(replica, time, length));
+  }
+
+  return done;
+}
+
+long StorageModel::serve(DataNode &node, long time, long length)
+{
+  long served = node.servers.serve(time, latency_);
+  long transfer = (long)(length * ns_per_byte_);
+  node.link_free = std::max(node.link_free, served) + transfer;
+  node.link_busy += transfer;
+
+  return node.link_free;
+}
+
+void StorageModel::print(std::ostream &out, long end) const
+{
+  auto share = [end](long busy) { return end > 0 ? busy * 100.0 / end : 0; };
+  auto wait = [](const Servers &servers) {
+    return servers.requests > 0 ? servers.waited / 1000.0 / servers.requests : 0;
+  };
+
+  double busy = 0, link = 0, most = 0;
+  long waited = 0;
+  uint64_t requests = 0;
+  for (auto &node : nodes_) {
+    double node_busy = share(node.servers.busy) / node.servers.free.size();
+    busy += node_busy;
+    link += share(node.link_busy);
+    most = std::max(most, std::max(node_busy, share(node.link_busy)));
+    waited += node.servers.waited;
+    requests += node.servers.requests;
+  }
+
+  out << "NameNode: " << namenode_.requests << " requests, busy ";
+  out << share(namenode_.busy) / namenode_.free.size() << "%, mean wait ";
+  out << wait(namenode_) << " us." << std::endl;
+  out << "DataNodes: " << requests << " requests, busy ";
+  out << busy / nodes_.size() << "%, links busy " << link / nodes_.size();
+  out << "%, busiest " << most << "%, mean wait ";
+  out << (requests > 0 ? waited / 1000.0 / requests : 0) << " us." << std::endl;
+}
+
+long StorageModel::Servers::serve(long time, long service)
+{
+  std::pop_heap(free.begin(), free.end(), std::greater<long>());
+  long start = std::max(time, free.back());
+  free.back() = start + service;
+  std::push_heap(free.begin(), free.end(), std::greater<long>());
+
+  busy += service;
+  waited += start - time;
+  requests++;
+
+  return start + service;
+}
+
+long StorageModel::Servers::next() const
+{
+  return free.front();
+}
@@ -0,0 +1,107 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// StorageModel predicts when a request to a simulated cluster is done,
+// given when it is sent. Opens and closes go to a NameNode with a
+// number of handlers, each taking a fixed time per request. Reads are
+// split at block boundaries; every block has replicas on DataNodes
+// picked by hashing the file and block, and the replica which would
+// be done first serves it. Writes, in contrast, go down the pipeline
+// of every replica of a block and are done when the slowest replica is.
+// A DataNode serves a number of requests at
+// once, each taking a fixed latency, then sends the bytes over its own
+// link of limited bandwidth, one request after another. Requests wait
+// in first come, first served order wherever they meet a busy server,
+// so queues build up like in a loaded cluster.
+// Requests must be sent in time order, which a discrete-event engine
+// guarantees (see TraceSimulator.h); then no event is needed inside
+// the model, and a request costs a few heap operations.
+//
+// Options of the "cluster" spec, in microsecond, MB or MB/s:
+//   nodes        number of DataNodes
+//   slots        requests a DataNode serves at once
+//   latency      per request latency of a DataNode
+//   bandwidth    bandwidth of the link of every DataNode
+//   replication  replicas of every block
+//   block        block size
+//   handlers     requests the NameNode serves at once
+//   open         latency of open at the NameNode
+//   close        latency of close at the NameNode
+
+#ifndef LIBHDFSPP_STORAGEMODEL_H_
+#define LIBHDFSPP_STORAGEMODEL_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+
+namespace hdfs
+{
+
+class StorageModel
+{
+ public:
+  static std::unique_ptr<StorageModel> create(const std::string &spec);
+  virtual ~StorageModel();
+
+  long open(long time);
+  long close(long time);
+  long read(long time, uint64_t file, long offset, long length);
+  long write(long time, uint64_t file, long offset, long length);
+  void print(std::ostream &out, long end) const;  //busy shares up to end
+
+ private:
+  // Servers working in parallel, as the times they are free again
+  struct Servers {
+    std::vector<long> free;     //a heap, earliest first
+    long busy;                  //ns spent serving
+    long waited;                //ns requests waited for a server
+    uint64_t requests;
+
+    long serve(long time, long service);
+    long next() const;          //when a server is free
+  };
+
+  struct DataNode {
+    Servers servers;
+    long link_free;             //when queued bytes are sent
+    long link_busy;
+  };
+
+  StorageModel(long nodes, long slots, long latency, double bandwidth, 
+      long replication, long block, long handlers, long open, long close);
+
+  long readBlock(long time, uint64_t file, long block, long length);
+  long writeBlock(long time, uint64_t file, long block, long length);
+  long serve(DataNode &node, long time, long length);
+
+  long latency_;
+  double ns_per_byte_;
+  long replication_;
+  long block_;
+  long open_;
+  long close_;
+  Servers namenode_;
+  std::vector<DataNode> nodes_;
+};
+
+} /* hdfs */ 
+
+#endif
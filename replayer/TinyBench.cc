@@ -0,0 +1,650 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A benchmark of the tools on synthetic logs. It generates a log of the
+// given size and shape (see TraceGenerator.h), so the same options
+// always give the same corpus, then measures:
+//  - generate  writing the corpus
+//  - read      LogReader parsing every record, and only cutting them
+//  - merge     tmerger merging the corpus split into each given number
+//              of inputs, sessions of a thread dealt round robin
+//  - replay    replayer dispatching the corpus to a backend, by
+//              default the sim backend doing nothing, so all of the
+//              time is replayer's own
+// tmerger and replayer are run as they are used, from the directory of
+// tbench unless given. Every measure is repeated and the median kept.
+// Results are saved as tab separated rows, one per measure, which a
+// later run compares itself to with -c.
+
+#include <map>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "Logger.h"
+#include "LogReader.h"
+#include "TraceGenerator.h"
+#include "TraceModel.h"
+
+#define BENCH_MAGIC "libhdfspp-bench"
+#define BENCH_VERSION 1
+
+struct Result {
+  std::string name;
+  std::string param;
+  long records;
+  long bytes;
+  double seconds;
+};
+
+static long records = 1000000;
+static unsigned long seed = 1;
+static long threads = 16;
+static long files = 1000;
+static double zipf = 1;
+static long read_size = 65536;
+static double random_share = 20;      //percent of files read at random
+static std::vector<long> inputs = {2, 10, 100, 1000, 10000};
+static int repeats = 3;
+static std::string backend = "sim";
+static std::string dir = "libhdfspp_bench";
+static std::string bin_dir;
+static bool keep = false;
+
+void printUsage(const char* name);
+bool parseInputs(const char* list);
+void makeModel(hdfs::TraceModel &model);
+bool generate(const std::string &path, Result &result);
+bool benchRead(const std::string &path, bool raw, Result &result);
+bool benchMerge(const std::string &path, long count, Result &result);
+bool benchReplay(const std::string &path, Result &result);
+bool split(const std::string &path, long count, const std::string &to);
+bool run(const std::vector<std::string> &args, const std::string &out, 
+    double &seconds);
+void removeDir(const std::string &path, long count);
+long sizeOf(const std::string &path);
+double median(std::vector<double> values);
+void save(std::ostream &out, const std::vector<Result> &results);
+bool load(const char* path, std::vector<Result> &results);
+bool compare(const std::vector<Result> &results, 
+    const std::vector<Result> &before, double limit);
+
+int main(int argc, char* argv[]) {
+  int opt;
+  const char* output = nullptr;
+  const char* previous = nullptr;
+  double limit = -1;
+
+  while((opt = getopt(argc, argv, "n:s:T:F:z:S:R:m:r:b:d:B:o:c:l:k")) != -1) {
+    switch (opt) {
+      case 'n':
+        records = std::atol(optarg);
+        if (records <= 0) {
+          std::cerr << "Number of records must be positive." << std::endl;
+          return 1;
+        }
+        break;
+      case 's':
+        seed = std::strtoul(optarg, nullptr, 10);
+        break;
+      case 'T':
+        threads = std::atol(optarg);
+        if (threads <= 0) {
+          std::cerr << "Number of threads must be positive." << std::endl;
+          return 1;
+        }
+        break;
+      case 'F':
+        files = std::atol(optarg);
+        if (files <= 0) {
+          std::cerr << "Number of files must be positive." << std::endl;
+          return 1;
+        }
+        break;
+      case 'z':
+        zipf = std::atof(optarg);
+        if (zipf < 0) {
+          std::cerr << "Zipf exponent must be non-negative." << std::endl;
+          return 1;
+        }
+        break;
+      case 'S':
+        read_size = std::atol(optarg);
+        if (read_size <= 0) {
+          std::cerr << "Read size must be positive." << std::endl;
+          return 1;
+        }
+        break;
+      case 'R':
+        random_share = std::atof(optarg);
+        if (random_share < 0 || random_share > 100) {
+          std::cerr << "Share of random files must be a percent." << std::endl;
+          return 1;
+        }
+        break;
+      case 'm':
+        if (!parseInputs(optarg)) {
+          std::cerr << "Numbers of inputs must be a list of positive numbers." << std::endl;
+          return 1;
+        }
+        break;
+      case 'r':
+        repeats = std::atoi(optarg);
+        if (repeats <= 0) {
+          std::cerr << "Number of repeats must be positive." << std::endl;
+          return 1;
+        }
+        break;
+      case 'b':
+        backend = optarg;
+        break;
+      case 'd':
+        dir = optarg;
+        break;
+      case 'B':
+        bin_dir = optarg;
+        break;
+      case 'o':
+        output = optarg;
+        break;
+      case 'c':
+        previous = optarg;
+        break;
+      case 'l':
+        limit = std::atof(optarg);
+        if (limit < 0) {
+          std::cerr << "Limit must be non-negative." << std::endl;
+          return 1;
+        }
+        break;
+      case 'k':
+        keep = true;
+        break;
+      default:
+        printUsage(argv[0]);
+        return 0;
+    }
+  }
+
+  if (bin_dir == "") {
+    char self[4096];
+    ssize_t length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    bin_dir = length > 0 ? std::string(self, length) : std::string(argv[0]);
+    bin_dir = bin_dir.substr(0, bin_dir.rfind('/') + 1);
+  }
+  if (bin_dir != "" && bin_dir.back() != '/') bin_dir.append("/");
+  if (bin_dir == "") bin_dir = "./";
+
+  std::vector<Result> before;
+  if (previous != nullptr && !load(previous, before)) {
+    std::cerr << "Failed to read results " << previous << std::endl;
+    return 1;
+  }
+
+  // tmerger keeps every input open at once
+  struct rlimit limits;
+  if (getrlimit(RLIMIT_NOFILE, &limits) == 0) {
+    limits.rlim_cur = limits.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limits);
+  }
+
+  mkdir(dir.c_str(), 0755);
+  std::string corpus = dir + "/corpus.log";
+  std::vector<Result> results;
+  Result result;
+  bool ok = true;
+
+  auto report = [&results](const Result &result) {
+    std::cout << result.name << " " << result.param << ": ";
+    std::cout << result.records / result.seconds << " records/s, ";
+    std::cout << result.bytes / 1024.0 / 1024 / result.seconds << " MB/s, ";
+    std::cout << result.seconds * 1e6 / result.records << " us/record";
+    std::cout << std::endl;
+    results.push_back(result);
+  };
+
+  if (!generate(corpus, result)) {
+    std::cerr << "Failed to write " << corpus << std::endl;
+    return 1;
+  }
+  report(result);
+  long written = result.records;
+
+  for (bool raw : {false, true}) {
+    if (!benchRead(corpus, raw, result)) {
+      std::cerr << "Failed to read " << corpus << std::endl;
+      return 1;
+    }
+    report(result);
+  }
+
+  for (long count : inputs) {
+    if ((long)limits.rlim_cur < count + 64) {
+      std::cerr << "Skipped merging " << count << " inputs, open files are ";
+      std::cerr << "limited to " << limits.rlim_cur << "." << std::endl;
+      continue;
+    }
+    if (benchMerge(corpus, count, result)) {
+      result.records = written;
+      report(result);
+    } else {
+      std::cerr << "Failed to merge " << count << " inputs." << std::endl;
+      ok = false;
+    }
+  }
+
+  if (benchReplay(corpus, result)) {
+    result.records = written;
+    report(result);
+  } else {
+    std::cerr << "Failed to replay " << corpus << std::endl;
+    ok = false;
+  }
+
+  if (!keep) {
+    unlink(corpus.c_str());
+    unlink((dir + "/bench.out").c_str());
+    rmdir(dir.c_str());
+  }
+
+  if (output != nullptr) {
+    std::ofstream out(output);
+    save(out, results);
+    if (!out) {
+      std::cerr << "Failed to write results to " << output << std::endl;
+      return 1;
+    }
+  } else {
+    std::cout << std::endl;
+    save(std::cout, results);
+  }
+
+  if (previous != nullptr && compare(results, before, limit)) {
+    return 2;
+  }
+
+  return ok ? 0 : 1;
+}
+
+void printUsage(const char* name)
+{
+  std::cout << "Usage: " << name << " [-n records] [-s seed] [-T threads] [-F files] [-z exponent]";
+  std::cout << " [-S bytes] [-R percent] [-m inputs] [-r repeats] [-b backend] [-d dir] [-B dir]";
+  std::cout << " [-o results] [-c results] [-l percent] [-k]" << std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout << "  -n <arg>    Generate about the given number of records. Default 1000000." << std::endl;
+  std::cout << "  -s <arg>    Seed of the corpus. Default 1." << std::endl;
+  std::cout << "  -T <arg>    Specify the number of threads of the corpus. Default 16." << std::endl;
+  std::cout << "  -F <arg>    Specify the number of files of the corpus. Default 1000." << std::endl;
+  std::cout << "  -z <arg>    Specify the Zipf exponent of file popularity. Default 1." << std::endl;
+  std::cout << "  -S <arg>    Specify the size of reads in bytes. Default 65536." << std::endl;
+  std::cout << "  -R <arg>    Specify the percent of files read at random, others sequentially. Default 20." << std::endl;
+  std::cout << "  -m <arg>    Merge the given comma separated numbers of inputs. Default 2,10,100,1000,10000." << std::endl;
+  std::cout << "  -r <arg>    Repeat every measure the given times and keep the median. Default 3." << std::endl;
+  std::cout << "  -b <arg>    Replay to the given backend spec. Default sim, which does nothing." << std::endl;
+  std::cout << "  -d <arg>    Write the corpus under the given directory. Default libhdfspp_bench." << std::endl;
+  std::cout << "  -B <arg>    Run tmerger and replayer from the given directory. Default that of tbench." << std::endl;
+  std::cout << "  -o <arg>    Save results to the given file instead of printing them." << std::endl;
+  std::cout << "  -c <arg>    Compare results to those saved by an earlier run." << std::endl;
+  std::cout << "  -l <arg>    Exit with 2 if a measure is slower than the earlier run by the given percent." << std::endl;
+  std::cout << "  -k          Keep the corpus." << std::endl;
+}
+
+bool parseInputs(const char* list)
+{
+  std::istringstream in(list);
+  std::string item;
+
+  inputs.clear();
+  while (std::getline(in, item, ',')) {
+    long count = std::atol(item.c_str());
+    if (count <= 0) return false;
+    inputs.push_back(count);
+  }
+
+  return !inputs.empty();
+}
+
+/* A model of the shape given by options: files read whole in requests
+ * of one size, sequentially or at random */
+void makeModel(hdfs::TraceModel &model)
+{
+  using hdfs::TraceModel;
+
+  model.start_date = 0;
+  model.start_time = 0;
+  model.threads = threads;
+  model.files = files;
+  model.zipf = zipf;
+  model.open_args[0] = 1;
+  model.streams[TraceModel::SEQUENTIAL] = 100 - random_share;
+  model.streams[TraceModel::RANDOM] = random_share;
+  for (int kind : {TraceModel::SEQUENTIAL, TraceModel::RANDOM}) {
+    for (int from = 0; from <= TraceModel::NUM_MOVES; ++from) {
+      model.moves[kind][from][kind] = 1;
+    }
+  }
+
+  model.file_sizes.add(read_size * 64, 1);
+  model.reads.add(64, 1);
+  model.sizes.add(read_size, 1);
+  model.think.add(100000, 1);
+  model.latency[0].add(1000000, 1);
+  model.latency[1].add(500000, 1);
+  model.latency[2].add(500000, 1);
+
+  model.file_sizes.prepare();
+  model.reads.prepare();
+  model.sizes.prepare();
+  model.strides.prepare();
+  model.think.prepare();
+  for (int i = 0; i < 3; ++i) {
+    model.latency[i].prepare();
+  }
+}
+
+/* The corpus is written once, its time is not repeated */
+bool generate(const std::string &path, Result &result)
+{
+  hdfs::TraceModel model;
+  makeModel(model);
+
+  auto start = std::chrono::steady_clock::now();
+  {
+    hdfs::Logger out;
+    if (!out.startLog(path.c_str())) return false;
+
+    hdfs::TraceGenerator generator(model, seed, "/bench", 1);
+    if (!generator.generate(out, records, 1)) return false;
+    result.records = generator.written();
+  }
+  std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+  result.name = "generate";
+  result.param = "-";
+  result.bytes = sizeOf(path);
+  result.seconds = time.count();
+
+  return result.bytes > 0;
+}
+
+bool benchRead(const std::string &path, bool raw, Result &result)
+{
+  std::vector<double> times;
+  std::string record;
+  long count = 0;
+
+  for (int i = 0; i < repeats; ++i) {
+    hdfs::LogReader reader(path.c_str());
+    auto start = std::chrono::steady_clock::now();
+
+    count = 0;
+    if (raw) {
+      while (reader.nextRaw(record)) count++;
+    } else {
+      while (reader.next() != nullptr) count++;
+    }
+    times.push_back(std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - start).count());
+
+    bool ok = reader.isEOF();
+    reader.close();
+    if (!ok) return false;
+  }
+
+  result.name = "read";
+  result.param = raw ? "raw" : "parse";
+  result.records = count;
+  result.bytes = sizeOf(path);
+  result.seconds = median(times);
+
+  return true;
+}
+
+bool benchMerge(const std::string &path, long count, Result &result)
+{
+  std::string from = dir + "/merge_" + std::to_string(count);
+  std::string to = dir + "/merged";
+  std::string merged = to + "/libhdfspp_merged.log";
+  std::vector<double> times;
+  bool ok = split(path, count, from);
+
+  mkdir(to.c_str(), 0755);
+  for (int i = 0; i < repeats && ok; ++i) {
+    double seconds;
+    ok = run({bin_dir + "tmerger", from, to}, dir + "/bench.out", seconds) 
+      && sizeOf(merged) == sizeOf(path);    //tmerger exits with 0 anyway
+    times.push_back(seconds);
+  }
+
+  removeDir(from, count);
+  unlink(merged.c_str());
+  rmdir(to.c_str());
+  if (!ok) return false;
+
+  result.name = "merge";
+  result.param = std::to_string(count);
+  result.bytes = sizeOf(path);
+  result.seconds = median(times);
+
+  return true;
+}
+
+bool benchReplay(const std::string &path, Result &result)
+{
+  std::vector<double> times;
+
+  for (int i = 0; i < repeats; ++i) {
+    double seconds;
+    if (!run({bin_dir + "replayer", "-b", backend, path}, 
+          dir + "/bench.out", seconds)) {
+      return false;
+    }
+    times.push_back(seconds);
+  }
+
+  result.name = "replay";
+  result.param = backend;
+  result.bytes = sizeOf(path);
+  result.seconds = median(times);
+
+  return true;
+}
+
+/* Every open starts a session of its thread on the next input, so
+ * inputs are alike and each is in time order */
+bool split(const std::string &path, long count, const std::string &to)
+{
+  std::vector<std::vector<std::string>> parts(count);
+  std::unordered_map<long, long> owners;
+  hdfs::LogReader reader(path.c_str());
+  hadoop::hdfs::log msg;
+  std::string record;
+  long next = 0;
+
+  while (reader.nextRaw(record)) {
+    if (!msg.ParseFromString(record)) break;
+
+    auto owner = owners.find(msg.threadid());
+    if (owner == owners.end() || msg.type() == hadoop::hdfs::log_FuncType_OPEN) {
+      owner = owners.insert(std::make_pair(msg.threadid(), 0)).first;
+      owner->second = next++ % count;
+    }
+    parts[owner->second].push_back(record);
+  }
+  bool ok = reader.isEOF();
+  reader.close();
+
+  mkdir(to.c_str(), 0755);
+  for (long i = 0; i < count && ok; ++i) {
+    hdfs::Logger out;
+    std::string part = to + "/part_" + std::to_string(i) + ".log";
+
+    ok = out.startLog(part.c_str());
+    for (size_t j = 0; j < parts[i].size() && ok; ++j) {
+      ok = out.writeDelimitedLog(parts[i][j]);
+    }
+  }
+
+  return ok;
+}
+
+/* Run a tool with its output to a file, and time it */
+bool run(const std::vector<std::string> &args, const std::string &out, 
+    double &seconds)
+{
+  std::vector<char*> argv;
+  for (auto &arg : args) {
+    argv.push_back(const_cast<char*>(arg.c_str()));
+  }
+  argv.push_back(nullptr);
+
+  auto start = std::chrono::steady_clock::now();
+  pid_t pid = fork();
+  if (pid < 0) {
+    return false;
+  }
+  if (pid == 0) {
+    int fd = open(out.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0644);
+    if (fd >= 0) {
+      dup2(fd, STDOUT_FILENO);
+      dup2(fd, STDERR_FILENO);
+      close(fd);
+    }
+    execv(argv[0], argv.data());
+    _exit(127);
+  }
+
+  int status;
+  if (waitpid(pid, &status, 0) != pid) {
+    return false;
+  }
+  seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    std::cerr << args[0] << " failed, see " << out << std::endl;
+    keep = true;
+    return false;
+  }
+  return true;
+}
+
+void removeDir(const std::string &path, long count)
+{
+  for (long i = 0; i < count; ++i) {
+    unlink((path + "/part_" + std::to_string(i) + ".log").c_str());
+  }
+  rmdir(path.c_str());
+}
+
+long sizeOf(const std::string &path)
+{
+  struct stat info;
+  return stat(path.c_str(), &info) == 0 ? (long)info.st_size : -1;
+}
+
+double median(std::vector<double> values)
+{
+  std::sort(values.begin(), values.end());
+  size_t middle = values.size() / 2;
+  return values.size() % 2 == 1 ? values[middle] : 
+    (values[middle - 1] + values[middle]) / 2;
+}
+
+/* One row per measure, so runs can be compared by any tool */
+void save(std::ostream &out, const std::vector<Result> &results)
+{
+  out << BENCH_MAGIC << " " << BENCH_VERSION << "\n";
+  out << "name\tparam\trecords\tbytes\tseconds\trecords/s\tMB/s\tus/record\n";
+  for (auto &result : results) {
+    out << result.name << "\t" << result.param << "\t" << result.records;
+    out << "\t" << result.bytes << "\t" << result.seconds << "\t";
+    out << result.records / result.seconds << "\t";
+    out << result.bytes / 1024.0 / 1024 / result.seconds << "\t";
+    out << result.seconds * 1e6 / result.records << "\n";
+  }
+  out.flush();
+}
+
+bool load(const char* path, std::vector<Result> &results)
+{
+  std::ifstream in(path);
+  std::string magic, line;
+  int version;
+
+  if (!(in >> magic >> version) || magic != BENCH_MAGIC 
+      || version != BENCH_VERSION) {
+    return false;
+  }
+  std::getline(in, line);
+  std::getline(in, line);     //column names
+
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    Result result;
+    if (!(fields >> result.name >> result.param >> result.records 
+          >> result.bytes >> result.seconds) || result.seconds <= 0) {
+      return false;
+    }
+    results.push_back(result);
+  }
+
+  return true;
+}
+
+/* Change of records/s per measure; returns whether one is slower than
+ * the limit allows */
+bool compare(const std::vector<Result> &results, 
+    const std::vector<Result> &before, double limit)
+{
+  std::map<std::pair<std::string, std::string>, const Result*> earlier;
+  for (auto &result : before) {
+    earlier[std::make_pair(result.name, result.param)] = &result;
+  }
+
+  bool slower = false;
+  std::cout << "\nChange of records/s from the earlier run:" << std::endl;
+  for (auto &result : results) {
+    auto found = earlier.find(std::make_pair(result.name, result.param));
+    if (found == earlier.end()) continue;
+
+    double old_rate = found->second->records / found->second->seconds;
+    double change = (result.records / result.seconds / old_rate - 1) * 100;
+    bool over = limit >= 0 && -change > limit;
+
+    std::cout << "  " << result.name << " " << result.param << ": ";
+    std::cout << old_rate << " -> " << result.records / result.seconds;
+    std::cout << " (" << (change >= 0 ? "+" : "") << change << "%)";
+    std::cout << (over ? " SLOWER" : "") << std::endl;
+    slower |= over;
+  }
+
+  return slower;
+}
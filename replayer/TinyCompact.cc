@@ -0,0 +1,311 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A tool joining every call of a log with its return into one op, which
+// halves the records and gives every op its latency without matching
+// calls to returns (see OpJoiner.h). Records are parsed in batches by a
+// pool of threads, joined in log order, and the ops serialized by the
+// pool again before they are written in order. With -x a compact log
+// is made a log of calls and returns again. Every tool reading logs
+// reads compact ones as well (see LogReader.h).
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <iostream>
+#include <unistd.h>
+
+#include "LogReader.h"
+#include "Logger.h"
+#include "OpJoiner.h"
+#include "WorkerPool.h"
+
+#define BATCH_RECORDS 16384
+
+static unsigned threads = std::thread::hardware_concurrency();
+static long records = 0;
+static long ops = 0;
+
+void printUsage(const char* name);
+bool compact(hdfs::LogReader &reader, hdfs::Logger &out, 
+    hdfs::OpJoiner &joiner);
+bool expand(hdfs::LogReader &reader, hdfs::Logger &out);
+
+int main(int argc, char* argv[]) {
+  int opt;
+  bool expanding = false;
+
+  while((opt = getopt(argc, argv, "xj:")) != -1) {
+    switch (opt) {
+      case 'x':
+        expanding = true;
+        break;
+      case 'j':
+        if (std::atoi(optarg) <= 0) {
+          std::cerr << "Number of threads must be positive." << std::endl;
+          return 1;
+        }
+        threads = std::atoi(optarg);
+        break;
+      default:
+        printUsage(argv[0]);
+        return 0;
+    }
+  }
+
+  if (optind + 1 >= argc) {
+    printUsage(argv[0]);
+    return 0;
+  }
+  if (threads == 0) threads = 1;
+
+  hdfs::LogReader reader;
+  if (!reader.setPath(argv[optind])) {
+    std::cerr << "Failed to open " << argv[optind] << std::endl;
+    return 1;
+  }
+  if (reader.isCompact() != expanding) {
+    std::cerr << argv[optind] << (expanding ? " is not" : " is already");
+    std::cerr << " a compact log." << std::endl;
+    reader.close();
+    return 1;
+  }
+
+  hdfs::Logger out;
+  if (!out.startLog(argv[optind + 1])) {
+    std::cerr << "Failed to create " << argv[optind + 1] << std::endl;
+    reader.close();
+    return 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  hdfs::OpJoiner joiner;
+  bool ok = expanding ? expand(reader, out) : compact(reader, out, joiner);
+  reader.close();
+  std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+  if (!ok) {
+    std::cerr << "Failed to " << (expanding ? "read op #" : "parse log #");
+    std::cerr << (expanding ? ops : records) + 1 << std::endl;
+    return 1;
+  }
+
+  if (expanding) {
+    std::cout << "Split " << ops << " operations into " << records;
+    std::cout << " records";
+  } else {
+    std::cout << "Joined " << records << " records into " << ops;
+    std::cout << " operations";
+  }
+  std::cout << " in " << time.count() << " seconds." << std::endl;
+  if (joiner.unreturned() > 0 || joiner.lone() > 0) {
+    std::cout << "Calls without a return: " << joiner.unreturned();
+    std::cout << ", returns without a call: " << joiner.lone() << std::endl;
+  }
+  if (joiner.released() > 0) {
+    std::cout << "Calls given up on while waiting for their return: ";
+    std::cout << joiner.released() << std::endl;
+  }
+
+  return 0;
+}
+
+void printUsage(const char* name)
+{
+  std::cout << "Usage: " << name << " [-x] [-j threads] <log file> <output log file>" << std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout << "  -x          Split a compact log into calls and returns again." << std::endl;
+  std::cout << "  -j <arg>    Parse and serialize with the given number of threads. Default all cores." << std::endl;
+}
+
+/* Batches are parsed by the pool and joined in log order as they are
+ * ready, and batches of ops go back to the pool to be serialized and
+ * are written in order. */
+bool compact(hdfs::LogReader &reader, hdfs::Logger &out, 
+    hdfs::OpJoiner &joiner)
+{
+  struct Batch {
+    std::string data;
+    std::vector<uint32_t> sizes;
+    std::vector<hadoop::hdfs::log> msgs;
+    bool ok;
+  };
+
+  struct Output {
+    std::vector<hadoop::hdfs::op> ops;
+    std::string data;
+    std::vector<uint32_t> sizes;
+  };
+
+  std::map<long, std::shared_ptr<Batch>> parsed;
+  std::map<long, std::shared_ptr<Output>> serialized;
+  std::mutex mutex;
+  long submitted = 0;
+  long joined = 0;
+  long outputs = 0;
+  long written = 0;
+  bool ok = true;
+
+  hdfs::WorkerPool pool(threads, threads * 2);
+  std::shared_ptr<Output> output(new Output());
+
+  auto serialize = [&]() {
+    long id = outputs++;
+    std::shared_ptr<Output> ready = output;
+    pool.submit([ready, id, &serialized, &mutex](unsigned) {
+        std::string record;
+        for (auto &op : ready->ops) {
+          op.SerializeToString(&record);
+          ready->data.append(record);
+          ready->sizes.push_back(record.size());
+        }
+        ready->ops.clear();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        serialized[id] = ready;
+    });
+    output.reset(new Output());
+  };
+
+  auto write = [&]() {
+    std::string record;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    for (auto done = serialized.find(written); done != serialized.end(); 
+        done = serialized.find(written)) {
+      std::shared_ptr<Output> ready = done->second;
+      serialized.erase(done);
+      written++;
+      lock.unlock();
+
+      const char* data = ready->data.data();
+      for (uint32_t size : ready->sizes) {
+        record.assign(data, size);
+        ok = out.writeDelimitedLog(record) && ok;
+        data += size;
+      }
+      lock.lock();
+    }
+  };
+
+  // ops whose return is in, in the order of their calls
+  auto take = [&]() {
+    hadoop::hdfs::op op;
+    while (joiner.pop(op)) {
+      output->ops.push_back(hadoop::hdfs::op());
+      output->ops.back().Swap(&op);
+      ops++;
+      if (output->ops.size() >= BATCH_RECORDS) serialize();
+    }
+  };
+
+  auto join = [&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    for (auto done = parsed.find(joined); done != parsed.end() && ok; 
+        done = parsed.find(joined)) {
+      std::shared_ptr<Batch> ready = done->second;
+      parsed.erase(done);
+      joined++;
+      lock.unlock();
+
+      for (auto &msg : ready->msgs) {
+        joiner.push(msg);
+        records++;
+        take();
+      }
+      ok = ok && ready->ok;
+      lock.lock();
+    }
+  };
+
+  ok = out.writeDelimitedLog(std::string()) 
+    && out.writeDelimitedLog(std::string(COMPACT_MAGIC));
+
+  std::shared_ptr<Batch> batch(new Batch());
+  std::string record;
+  bool more = ok && reader.nextRaw(record);
+
+  while (more && ok) {
+    batch->data.append(record);
+    batch->sizes.push_back(record.size());
+    more = reader.nextRaw(record);
+
+    if (!more || batch->sizes.size() >= BATCH_RECORDS) {
+      long id = submitted++;
+      pool.submit([batch, id, &parsed, &mutex](unsigned) {
+          const char* data = batch->data.data();
+          batch->ok = true;
+          batch->msgs.resize(batch->sizes.size());
+
+          for (size_t i = 0; i < batch->sizes.size(); ++i) {
+            if (!batch->msgs[i].ParseFromArray(data, batch->sizes[i])) {
+              batch->msgs.resize(i);
+              batch->ok = false;
+              break;
+            }
+            data += batch->sizes[i];
+          }
+
+          std::lock_guard<std::mutex> lock(mutex);
+          parsed[id] = batch;
+      });
+      batch.reset(new Batch());
+      join();
+      write();
+    }
+  }
+
+  pool.drain();
+  join();
+  joiner.finish();
+  take();
+  serialize();
+  pool.drain();
+  write();
+
+  return ok && reader.isEOF();
+}
+
+bool expand(hdfs::LogReader &reader, hdfs::Logger &out)
+{
+  bool ok = true;
+  hadoop::hdfs::op op;
+  hadoop::hdfs::log call, ret;
+  bool has_call, has_ret;
+
+  while (ok && reader.nextOp(op)) {
+    ops++;
+    hdfs::OpJoiner::split(op, call, has_call, ret, has_ret);
+    if (has_call) {
+      ok = out.writeDelimitedLog(call);
+      records++;
+    }
+    if (has_ret && ok) {
+      ok = out.writeDelimitedLog(ret);
+      records++;
+    }
+  }
+
+  return ok && reader.isEOF();
+}
@@ -0,0 +1,110 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A tool comparing latency of two logs of the same workload, such as
+// captures before and after a change, or two replays (see
+// TraceDiff.h). It exits with 2 when a kind of call or a file got
+// significantly slower, so it can guard a release.
+
+#include <cstdlib>
+#include <iostream>
+#include <unistd.h>
+
+#include "TraceDiff.h"
+
+static size_t max_waiting = 1000000;
+static size_t max_files = 100000;
+static size_t top = 10;
+static double z = 3.29;       //two-sided p of 0.001
+static double share = 0.05;
+
+void printUsage(const char* name);
+
+int main(int argc, char* argv[]) {
+  int opt;
+
+  while((opt = getopt(argc, argv, "w:f:t:z:c:")) != -1) {
+    switch (opt) {
+      case 'w':
+        if (std::atol(optarg) <= 0) {
+          std::cerr << "Number of waiting calls must be positive." << std::endl;
+          return 1;
+        }
+        max_waiting = std::atol(optarg);
+        break;
+      case 'f':
+        if (std::atol(optarg) < 0) {
+          std::cerr << "Number of files must be non-negative." << std::endl;
+          return 1;
+        }
+        max_files = std::atol(optarg);
+        break;
+      case 't':
+        if (std::atoi(optarg) < 0) {
+          std::cerr << "Number of top files must be non-negative." << std::endl;
+          return 1;
+        }
+        top = std::atoi(optarg);
+        break;
+      case 'z':
+        z = std::atof(optarg);
+        if (z <= 0) {
+          std::cerr << "z score must be positive." << std::endl;
+          return 1;
+        }
+        break;
+      case 'c':
+        share = std::atof(optarg) / 100;
+        if (share < 0) {
+          std::cerr << "Change must be non-negative." << std::endl;
+          return 1;
+        }
+        break;
+      default:
+        printUsage(argv[0]);
+        return 0;
+    }
+  }
+
+  if (optind + 1 >= argc) {
+    printUsage(argv[0]);
+    return 0;
+  }
+
+  std::ios_base::sync_with_stdio(false);
+  hdfs::TraceDiff diff(max_waiting, max_files);
+  if (!diff.compare(argv[optind], argv[optind + 1])) {
+    std::cerr << "Failed to read " << argv[optind] << " and ";
+    std::cerr << argv[optind + 1] << " to their end." << std::endl;
+    return 1;
+  }
+
+  return diff.print(std::cout, top, z, share) ? 2 : 0;
+}
+
+void printUsage(const char* name)
+{
+  std::cout << "Usage: " << name << " [-w calls] [-f files] [-t top] [-z score] [-c percent]";
+  std::cout << " <first log file> <second log file>" << std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout << "  -w <arg>    Keep at most the given number of calls waiting for a partner. Default 1000000." << std::endl;
+  std::cout << "  -f <arg>    Compare at most the given number of files. Default 100000." << std::endl;
+  std::cout << "  -t <arg>    Show the given number of files adding most latency. Default 10." << std::endl;
+  std::cout << "  -z <arg>    Report changes beyond the given z score. Default 3.29." << std::endl;
+  std::cout << "  -c <arg>    Report changes beyond the given percent of mean latency. Default 5." << std::endl;
+}
@@ -0,0 +1,182 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A tool fitting a model to a log (see TraceModel.h) and writing
+// synthetic logs of any size from it (see TraceGenerator.h). With -f
+// the model is fitted to the given log and saved to the file of -m if
+// any; otherwise it is loaded from the file of -m. Threads, files and
+// popularity of the model may be changed for the synthetic log, and
+// think time scaled. The same model and seed always give the same log.
+
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <iostream>
+#include <unistd.h>
+
+#include "Logger.h"
+#include "TraceGenerator.h"
+#include "TraceModel.h"
+
+static long records = 1000000;
+static unsigned long seed = 1;
+static long threads = 0;
+static long files = 0;
+static double zipf = -1;
+static double think_scale = 1;
+static std::string prefix = "/synthetic";
+static unsigned workers = 1;
+
+void printUsage(const char* name);
+
+int main(int argc, char* argv[]) {
+  int opt;
+  const char* log = nullptr;
+  const char* model_path = nullptr;
+
+  while((opt = getopt(argc, argv, "f:m:n:s:T:F:z:k:p:j:")) != -1) {
+    switch (opt) {
+      case 'f':
+        log = optarg;
+        break;
+      case 'm':
+        model_path = optarg;
+        break;
+      case 'n':
+        records = std::atol(optarg);
+        if (records <= 0) {
+          std::cerr << "Number of records must be positive." << std::endl;
+          return 1;
+        }
+        break;
+      case 's':
+        seed = std::strtoul(optarg, nullptr, 10);
+        break;
+      case 'T':
+        threads = std::atol(optarg);
+        if (threads <= 0) {
+          std::cerr << "Number of threads must be positive." << std::endl;
+          return 1;
+        }
+        break;
+      case 'F':
+        files = std::atol(optarg);
+        if (files <= 0) {
+          std::cerr << "Number of files must be positive." << std::endl;
+          return 1;
+        }
+        break;
+      case 'z':
+        zipf = std::atof(optarg);
+        if (zipf < 0) {
+          std::cerr << "Zipf exponent must be non-negative." << std::endl;
+          return 1;
+        }
+        break;
+      case 'k':
+        think_scale = std::atof(optarg);
+        if (think_scale < 0) {
+          std::cerr << "Think time scale must be non-negative." << std::endl;
+          return 1;
+        }
+        break;
+      case 'p':
+        prefix = optarg;
+        break;
+      case 'j':
+        if (std::atoi(optarg) <= 0) {
+          std::cerr << "Number of workers must be positive." << std::endl;
+          return 1;
+        }
+        workers = std::atoi(optarg);
+        break;
+      default:
+        printUsage(argv[0]);
+        return 0;
+    }
+  }
+
+  if (log == nullptr && model_path == nullptr) {
+    printUsage(argv[0]);
+    return 0;
+  }
+
+  hdfs::TraceModel model;
+  if (log != nullptr) {
+    std::cout << "Fitting a model to " << log << std::endl;
+    if (!model.fit(log)) {
+      std::cerr << "Failed to read " << log << " to its end." << std::endl;
+      return 1;
+    }
+    if (model_path != nullptr && !model.save(model_path)) {
+      std::cerr << "Failed to save model to " << model_path << std::endl;
+      return 1;
+    }
+  } else if (!model.load(model_path)) {
+    std::cerr << "Failed to load model " << model_path << std::endl;
+    return 1;
+  }
+
+  if (threads > 0) model.threads = threads;
+  if (files > 0) model.files = files;
+  if (zipf >= 0) model.zipf = zipf;
+  model.print(std::cout);
+
+  if (optind >= argc) {
+    return 0;
+  }
+
+  hdfs::Logger out;
+  if (!out.startLog(argv[optind])) {
+    std::cerr << "Failed to create " << argv[optind] << std::endl;
+    return 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  hdfs::TraceGenerator generator(model, seed, prefix, think_scale);
+  if (!generator.generate(out, records, workers)) {
+    std::cerr << "Failed to write " << argv[optind] << std::endl;
+    return 1;
+  }
+  std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+  std::cout << "Wrote " << generator.written() << " records covering ";
+  std::cout << generator.duration() / 1e9 << " seconds in " << time.count();
+  std::cout << " seconds (" << generator.written() / time.count();
+  std::cout << " records/s)." << std::endl;
+
+  return 0;
+}
+
+void printUsage(const char* name)
+{
+  std::cout << "Usage: " << name << " [-f log file] [-m model file] [-n records] [-s seed]";
+  std::cout << " [-T threads] [-F files] [-z exponent] [-k scale] [-p prefix] [-j workers]";
+  std::cout << " [output log file]" << std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout << "  -f <arg>    Fit a model to the given log." << std::endl;
+  std::cout << "  -m <arg>    Save the fitted model to the given file, or load it without -f." << std::endl;
+  std::cout << "  -n <arg>    Write about the given number of records. Default 1000000." << std::endl;
+  std::cout << "  -s <arg>    Seed of the synthetic log. Default 1." << std::endl;
+  std::cout << "  -T <arg>    Use the given number of threads instead of the model's." << std::endl;
+  std::cout << "  -F <arg>    Use the given number of files instead of the model's." << std::endl;
+  std::cout << "  -z <arg>    Use the given Zipf exponent of file popularity instead of the model's." << std::endl;
+  std::cout << "  -k <arg>    Scale think time between calls by the given factor." << std::endl;
+  std::cout << "  -p <arg>    Put synthetic files under the given path. Default /synthetic." << std::endl;
+  std::cout << "  -j <arg>    Generate with the given number of worker threads." << std::endl;
+}
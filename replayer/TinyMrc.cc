@@ -0,0 +1,196 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A tool computing miss ratio curves of a log: for caches of every
+// size, which share of block reads would miss an LRU cache, together
+// with the working set over time. Reads are split into blocks of one or
+// more sizes, keyed by path of the file and block number, and sampled
+// so that memory stays bounded (see MissRatioCurve.h).
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <iostream>
+#include <functional>
+#include <unistd.h>
+
+#include "LogReader.h"
+#include "MissRatioCurve.h"
+
+static double rate = 0.01;
+static size_t max_keys = 1 << 16;
+static double interval = 60;      //seconds
+static std::vector<long> block_sizes;
+
+void printUsage(const char* name);
+bool parseSizes(const char* arg);
+
+int main(int argc, char* argv[]) {
+  int opt;
+
+  while((opt = getopt(argc, argv, "b:r:m:i:")) != -1) {
+    switch (opt) {
+      case 'b':
+        if (!parseSizes(optarg)) {
+          std::cerr << "Block sizes must be positive, e.g. 4K,64K,1M." << std::endl;
+          return 1;
+        }
+        break;
+      case 'r':
+        rate = std::atof(optarg);
+        if (rate <= 0 || rate > 1) {
+          std::cerr << "Sampling rate must be in (0, 1]." << std::endl;
+          return 1;
+        }
+        break;
+      case 'm':
+        if (std::atol(optarg) <= 0) {
+          std::cerr << "Number of tracked blocks must be positive." << std::endl;
+          return 1;
+        }
+        max_keys = std::atol(optarg);
+        break;
+      case 'i':
+        interval = std::atof(optarg);
+        if (interval <= 0) {
+          std::cerr << "Interval must be positive." << std::endl;
+          return 1;
+        }
+        break;
+      default:
+        printUsage(argv[0]);
+        return 0;
+    }
+  }
+
+  if (optind >= argc) {
+    printUsage(argv[0]);
+    return 0;
+  }
+  if (block_sizes.empty()) {
+    parseSizes("4K,64K,1M");
+  }
+
+  std::vector<std::unique_ptr<hdfs::MissRatioCurve>> curves;
+  for (long size : block_sizes) {
+    curves.push_back(std::unique_ptr<hdfs::MissRatioCurve>(
+          new hdfs::MissRatioCurve(size, rate, max_keys, 
+            (long)(interval * 1000000000))));
+  }
+
+  hdfs::LogReader reader(argv[optind]);
+  std::unique_ptr<hadoop::hdfs::log> msg;
+  std::map<long, uint64_t> opening;   //path of OPEN by thread
+  std::map<long, uint64_t> files;     //path of file by handle
+  std::hash<std::string> hash;
+  hdfs::TraceClock clock;
+  long index = 0;
+
+  while((msg = reader.next()) != nullptr) {
+    index++;
+    long time = clock.since(*msg);    //every record, to follow the days
+
+    switch (msg->type()) {
+      case hadoop::hdfs::log_FuncType_OPEN:
+        opening[msg->threadid()] = hash(msg->path());
+        break;
+      case hadoop::hdfs::log_FuncType_OPEN_RET: {
+        auto path = opening.find(msg->threadid());
+        if (path != opening.end() && msg->argument_size() > 0) {
+          files[msg->argument(0)] = path->second;
+          opening.erase(path);
+        }
+        break;
+      }
+      case hadoop::hdfs::log_FuncType_CLOSE:
+        if (msg->argument_size() > 1) files.erase(msg->argument(1));
+        break;
+      case hadoop::hdfs::log_FuncType_READ: {
+        if (msg->argument_size() < 5) break;
+        auto path = files.find(msg->argument(1));
+        if (path == files.end()) break;   //opened before the log started
+
+        for (auto &curve : curves) {
+          curve->access(path->second, msg->argument(2), msg->argument(4), 
+              time);
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  if (!reader.isEOF()) {
+    std::cerr << "Failed to parse log #" << (++index) << std::endl;
+  }
+  reader.close();
+
+  for (auto &curve : curves) {
+    curve->finish();
+    curve->print(std::cout);
+    std::cout << std::endl;
+  }
+  for (auto &curve : curves) {
+    curve->printWorkingSet(std::cout);
+    std::cout << std::endl;
+  }
+
+  return 0;
+}
+
+void printUsage(const char* name)
+{
+  std::cout << "Usage: " << name << " [-b block-sizes] [-r rate] [-m blocks] [-i seconds] <log file>" << std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout << "  -b <arg>    Specify block sizes separated by commas, e.g. 4K,64K,1M (default)." << std::endl;
+  std::cout << "  -r <arg>    Specify the initial sampling rate of blocks. Default 0.01." << std::endl;
+  std::cout << "  -m <arg>    Specify the most blocks tracked per block size. Default 65536." << std::endl;
+  std::cout << "  -i <arg>    Specify the interval of working set in seconds. Default 60." << std::endl;
+}
+
+/* Parse sizes like "4K,64K,1M" into block_sizes */
+bool parseSizes(const char* arg)
+{
+  std::string rest = arg;
+  block_sizes.clear();
+
+  while (!rest.empty()) {
+    size_t comma = rest.find(',');
+    std::string size = rest.substr(0, comma);
+    char* end = nullptr;
+    long value = std::strtol(size.c_str(), &end, 10);
+
+    if (*end == 'K' || *end == 'k') {
+      value *= 1024;
+      end++;
+    } else if (*end == 'M' || *end == 'm') {
+      value *= 1024 * 1024;
+      end++;
+    }
+    if (end == size.c_str() || *end != '\0' || value <= 0) return false;
+    block_sizes.push_back(value);
+
+    if (comma == std::string::npos) break;
+    rest = rest.substr(comma + 1);
+  }
+
+  return !block_sizes.empty();
+}
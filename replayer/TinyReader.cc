@@ -16,121 +16,229 @@
  * limitations under the License.
  */
 
-// A basic reader for log file. 
+// A basic reader for log file. With -p it also profiles how every file
+// is read (see AccessProfile.h), and with -s it prints statistics per
+// operation, thread and interval (see TraceStats.h), optionally parsing
+// the log with several threads.
 
 #include <iostream>
 #include <string>
+#include <cstdlib>
+#include <algorithm>
 #include <unistd.h>
 
+#include "AccessProfile.h"
 #include "LogReader.h"
+#include "TraceStats.h"
 
-static int open_count = 0;
-static int open_ret_count = 0;
-static int close_count = 0;
-static int close_ret_count = 0;
-static int read_count = 0;
-static int read_ret_count = 0;
-static int start_date = 0;
-static int end_date = 0;
-static long start_time = 0;
-static long end_time = 0;
+static uint64_t counts[hadoop::hdfs::log_FuncType_FuncType_ARRAYSIZE] = {};
+static uint64_t out_of_order = 0;
+static hdfs::TraceClock trace_clock;
+static long min_time = 0;     //since the first record
+static long max_time = 0;
+static long last_time = 0;
 
 void printLogInfo(const hadoop::hdfs::log &msg);
-std::string getLogType(const hadoop::hdfs::log &msg);
+const char* getLogType(const hadoop::hdfs::log &msg);
 void countOp(const hadoop::hdfs::log &msg);
+void printUsage(const char* name);
 
 int main(int argc, char* argv[]) {
   int opt;
   bool verbose = false;
+  bool profile = false;
+  bool statistics = false;
+  long top = 20;
+  double interval = 60;
+  unsigned threads = 1;
 
-  while((opt = getopt(argc, argv, "v")) != -1) {
+  while((opt = getopt(argc, argv, "vpt:si:j:")) != -1) {
     switch (opt) {
       case 'v':
         verbose = true;
         break;
+      case 'p':
+        profile = true;
+        break;
+      case 't':
+        top = std::atol(optarg);
+        if (top <= 0) {
+          std::cerr << "Number of top files and threads must be positive." << std::endl;
+          return 1;
+        }
+        break;
+      case 's':
+        statistics = true;
+        break;
+      case 'i':
+        interval = std::atof(optarg);
+        if (interval <= 0) {
+          std::cerr << "Interval must be positive." << std::endl;
+          return 1;
+        }
+        break;
+      case 'j':
+        if (std::atoi(optarg) <= 0) {
+          std::cerr << "Number of threads must be positive." << std::endl;
+          return 1;
+        }
+        threads = std::atoi(optarg);
+        break;
       default:
-        std::cout << "Usage: " << argv[0] << " ";
-        std::cout << "[-v] <log file>" << std::endl;
+        printUsage(argv[0]);
         return 0;
     }
   }
   
   if (optind >= argc) {
-    std::cout << "Usage: " << argv[0] << " ";
-    std::cout << "[-v] <log file>" << std::endl;
+    printUsage(argv[0]);
     return 0;
   }
+
+  // nothing is printed with stdio, so unsynced streams speed up -v
+  std::ios_base::sync_with_stdio(false);
+  long interval_ns = (long)(interval * 1000000000);
+
+  if (threads > 1) {
+    if (verbose || profile || !statistics) {
+      std::cerr << "Parallel scan (-j) only works with statistics (-s) alone." << std::endl;
+      return 1;
+    }
+
+    auto stats = hdfs::TraceStats::scan(argv[optind], threads, interval_ns);
+    if (stats == nullptr) {
+      std::cerr << "Failed to parse log " << argv[optind] << std::endl;
+      return 1;
+    }
+    stats->print(std::cout, top);
+    return 0;
+  }
+
   hdfs::LogReader reader(argv[optind]);
+  // a count is too high by at most bytes read / counters, the error printed
+  hdfs::AccessProfile access(top * 50);
+  std::unique_ptr<hdfs::TraceStats> stats;
 
-  int index = 0;
-  long last_time = -1;
+  uint64_t index = 0;
   std::unique_ptr<hadoop::hdfs::log> msg;
 
   while((msg = reader.next()) != nullptr) {
     index++;
     countOp(*msg);
 
-    if (last_time > msg->time()) {
-      std::cerr << "Corrupted log file." << std::endl;
-      index--;
-      break;
+    if (profile) {
+      access.add(*msg, trace_clock.since(*msg));
+    }
+    if (statistics) {
+      if (stats == nullptr) {
+        stats.reset(new hdfs::TraceStats(hdfs::TraceClock(), interval_ns));
+      }
+      stats->add(*msg);
     }
-    last_time = msg->time();
 
     if (verbose) {
-      std::cout << "#" << index << std::endl;
+      std::cout << "#" << index << "\n";
       printLogInfo(*msg);
     } 
   }
+  std::cout.flush();
 
   if (!reader.isEOF()) {
     std::cerr << "Failed to parse log #" << (++index) << std::endl;
   }
 
-  std::cout << "open: " << open_count; 
-  std::cout << " open_ret: " << open_ret_count << std::endl;
-  std::cout << "close: " << close_count;
-  std::cout << " close_ret: " << close_ret_count << std::endl;
-  std::cout << "read: " << read_count;
-  std::cout << " read_ret: " << read_ret_count  << std::endl;
-
-  int total = open_count + read_count + close_count;
-  int date = end_date - start_date;
-  long time = (end_time - start_time)/1000000 + 
-    (date < 0 ? date + 365 : date) * 24 * 3600 * 1000;
-  std::cout << "\nTotal: " << total << "\t";
-  std::cout << "Time: " << time << "ms" << "\t";
-  std::cout << "Thoroughput: " << (double)total/time << "/ms" << std::endl;
+  if (statistics) {
+    if (stats == nullptr) {
+      stats.reset(new hdfs::TraceStats(hdfs::TraceClock(), interval_ns));
+    }
+    stats->print(std::cout, top);
+  } else {
+    // calls other than open, close and read only when there are any
+    uint64_t total = 0;
+    for (int type = 0; type < hadoop::hdfs::log_FuncType_FuncType_ARRAYSIZE; 
+        type += 2) {
+      total += counts[type];
+      if (type > hadoop::hdfs::log_FuncType_READ_RET 
+          && counts[type] == 0 && counts[type + 1] == 0) continue;
+
+      std::string name = hadoop::hdfs::log_FuncType_Name(
+          (hadoop::hdfs::log_FuncType)type);
+      std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+      std::cout << name << ": " << counts[type];
+      std::cout << " " << name << "_ret: " << counts[type + 1] << std::endl;
+    }
+    if (out_of_order > 0) {
+      std::cout << "out of order: " << out_of_order << std::endl;
+    }
+
+    long time = (max_time - min_time) / 1000000;
+    std::cout << "\nTotal: " << total << "\t";
+    std::cout << "Time: " << time << "ms" << "\t";
+    std::cout << "Thoroughput: " << (double)total/std::max(time, 1L) << "/ms" << std::endl;
+  }
+
+  if (profile) {
+    access.finish();
+    std::cout << std::endl;
+    access.print(std::cout, top);
+  }
 
   reader.close();
   return 0;
 }
 
+void printUsage(const char* name)
+{
+  std::cout << "Usage: " << name << " ";
+  std::cout << "[-v] [-p] [-s] [-t top] [-i seconds] [-j threads] <log file>" << std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout << "  -v          Print every log message." << std::endl;
+  std::cout << "  -p          Profile access patterns, request sizes and hot files." << std::endl;
+  std::cout << "  -s          Print statistics per operation, thread and interval." << std::endl;
+  std::cout << "  -t <arg>    Specify the number of hot files and threads to print. Default 20." << std::endl;
+  std::cout << "  -i <arg>    Specify the interval of statistics in seconds. Default 60." << std::endl;
+  std::cout << "  -j <arg>    Parse the log with the given number of threads, with -s only." << std::endl;
+}
+
 /* Print log message */
 void printLogInfo(const hadoop::hdfs::log &msg)
 {
-  std::cout << "date: " << msg.date() << std::endl; 
-  std::cout << "time: " << msg.time() << std::endl; 
-  std::cout << "thread id: " <<  msg.threadid() << std::endl; 
-  std::cout << "type: " << getLogType(msg) << std::endl; 
-  if (msg.type() == hadoop::hdfs::log_FuncType_OPEN) {
-    std::cout << "path: " << msg.path() << std::endl; 
+  std::cout << "date: " << msg.date() << "\n"; 
+  std::cout << "time: " << msg.time() << "\n"; 
+  std::cout << "thread id: " <<  msg.threadid() << "\n"; 
+  std::cout << "type: " << getLogType(msg) << "\n"; 
+  if (msg.has_path()) {
+    std::cout << "path: " << msg.path() << "\n"; 
+  }
+
+  if (msg.has_cputime()) {
+    std::cout << "cpu time: " << msg.cputime() << "\n"; 
+  }
+  if (msg.has_voluntaryswitches()) {
+    std::cout << "switches: " << msg.voluntaryswitches() << " voluntary, ";
+    std::cout << msg.involuntaryswitches() << " involuntary\n"; 
+  }
+  if (msg.has_site()) {
+    std::cout << "site: " << std::hex << msg.site() << std::dec << "\n"; 
+  }
+  for (int i = 0; i < msg.frame_size(); ++i) {
+    std::cout << "\t" << msg.frame(i) << "\n"; 
   }
 
-  std::cout << "argu size: " << msg.argument_size() << std::endl; 
+  std::cout << "argu size: " << msg.argument_size() << "\n"; 
   for (int i = 0; i < msg.argument_size(); ++i) {
-    if (msg.argument(i) > (long)(1 << 31)) {
-      std::cout << std::hex << "\t" << msg.argument(i) << std::endl; 
+    if (msg.argument(i) > (1L << 31)) {
+      std::cout << std::hex << "\t" << msg.argument(i) << "\n"; 
     } else {
-      std::cout << std::dec << "\t" << msg.argument(i) << std::endl; 
+      std::cout << std::dec << "\t" << msg.argument(i) << "\n"; 
     }
   }
 
-  std::cout << std::dec << " " << std::endl; 
+  std::cout << std::dec << " \n"; 
 }
 
 /* Get string of log FuncType */
-std::string getLogType(const hadoop::hdfs::log &msg)
+const char* getLogType(const hadoop::hdfs::log &msg)
 {
   switch (msg.type()) {
     case hadoop::hdfs::log_FuncType_OPEN:
@@ -145,6 +253,30 @@ std::string getLogType(const hadoop::hdfs::log &msg)
       return "READ";
     case hadoop::hdfs::log_FuncType_READ_RET:
       return "READ_RET";
+    case hadoop::hdfs::log_FuncType_WRITE:
+      return "WRITE";
+    case hadoop::hdfs::log_FuncType_WRITE_RET:
+      return "WRITE_RET";
+    case hadoop::hdfs::log_FuncType_FLUSH:
+      return "FLUSH";
+    case hadoop::hdfs::log_FuncType_FLUSH_RET:
+      return "FLUSH_RET";
+    case hadoop::hdfs::log_FuncType_HSYNC:
+      return "HSYNC";
+    case hadoop::hdfs::log_FuncType_HSYNC_RET:
+      return "HSYNC_RET";
+    case hadoop::hdfs::log_FuncType_SEEK:
+      return "SEEK";
+    case hadoop::hdfs::log_FuncType_SEEK_RET:
+      return "SEEK_RET";
+    case hadoop::hdfs::log_FuncType_GETFILEINFO:
+      return "GETFILEINFO";
+    case hadoop::hdfs::log_FuncType_GETFILEINFO_RET:
+      return "GETFILEINFO_RET";
+    case hadoop::hdfs::log_FuncType_LISTDIR:
+      return "LISTDIR";
+    case hadoop::hdfs::log_FuncType_LISTDIR_RET:
+      return "LISTDIR_RET";
     default:
       return "unknown"; 
   }
@@ -152,35 +284,15 @@ std::string getLogType(const hadoop::hdfs::log &msg)
 
 void countOp(const hadoop::hdfs::log &msg)
 {
-  if (start_time == 0) {
-    start_date = msg.date();
-    start_time = msg.time();
-  } else {
-    end_date = msg.date();
-    end_time = msg.time();
-  }
+  // unordered records are counted, the span covers all of them
+  long time = trace_clock.since(msg);
+  if (time < last_time) out_of_order++;
+  min_time = std::min(min_time, time);
+  max_time = std::max(max_time, time);
+  last_time = time;
 
-  switch (msg.type()) {
-    case hadoop::hdfs::log_FuncType_OPEN:
-      open_count++;
-      break;
-    case hadoop::hdfs::log_FuncType_OPEN_RET:
-      open_ret_count++;
-      break;
-    case hadoop::hdfs::log_FuncType_CLOSE:
-      close_count++;
-      break;
-    case hadoop::hdfs::log_FuncType_CLOSE_RET:
-      close_ret_count++;
-      break;
-    case hadoop::hdfs::log_FuncType_READ:
-      read_count++;
-      break;
-    case hadoop::hdfs::log_FuncType_READ_RET:
-      read_ret_count++;
-      break;
-    default:
-      break;
+  if (hadoop::hdfs::log_FuncType_IsValid(msg.type())) {
+    counts[msg.type()]++;
   }
 }
 
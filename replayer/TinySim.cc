@@ -0,0 +1,108 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A tool replaying a log in simulated time against a model of a
+// cluster (see TraceSimulator.h and StorageModel.h), to predict what
+// other hardware or settings would do to latency in seconds instead of
+// hours. Several models may be given to sweep a parameter; each is
+// simulated in turn and summarized side by side at the end.
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <unistd.h>
+
+#include "StorageModel.h"
+#include "TraceSimulator.h"
+
+void printUsage(const char* name);
+
+int main(int argc, char* argv[]) {
+  int opt;
+  std::vector<std::string> specs;
+
+  while((opt = getopt(argc, argv, "m:")) != -1) {
+    switch (opt) {
+      case 'm':
+        specs.push_back(optarg);
+        break;
+      default:
+        printUsage(argv[0]);
+        return 0;
+    }
+  }
+
+  if (optind >= argc) {
+    printUsage(argv[0]);
+    return 0;
+  }
+  if (specs.empty()) {
+    specs.push_back("cluster");
+  }
+
+  std::vector<std::unique_ptr<hdfs::StorageModel>> models;
+  for (auto &spec : specs) {
+    models.push_back(hdfs::StorageModel::create(spec));
+    if (models.back() == nullptr) {
+      return 1;
+    }
+  }
+
+  std::ios_base::sync_with_stdio(false);
+  std::vector<std::string> summaries;
+  for (size_t i = 0; i < models.size(); ++i) {
+    auto start = std::chrono::steady_clock::now();
+    hdfs::TraceSimulator simulator(*models[i]);
+    bool ok = simulator.run(argv[optind]);
+    std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+    std::cout << "Model " << specs[i] << ":" << std::endl;
+    if (!ok) {
+      std::cerr << "Failed to read " << argv[optind] << " to its end." << std::endl;
+      return 1;
+    }
+    simulator.print(std::cout);
+    std::cout << "Simulated in " << time.count() << " seconds (";
+    std::cout << simulator.calls() / time.count() << " calls/s).\n" << std::endl;
+
+    const hdfs::Histogram &reads = simulator.latency(hdfs::TraceStats::READ);
+    summaries.push_back("  " + std::to_string(simulator.end() / 1e9) + "\t" 
+        + std::to_string(reads.percentile(50) / 1000.0) + "\t"
+        + std::to_string(reads.percentile(99) / 1000.0) + "\t" + specs[i]);
+  }
+
+  if (summaries.size() > 1) {
+    std::cout << "Summary:" << std::endl;
+    std::cout << "  seconds\tread p50 (us)\tread p99 (us)\tmodel" << std::endl;
+    for (auto &summary : summaries) {
+      std::cout << summary << std::endl;
+    }
+  }
+
+  return 0;
+}
+
+void printUsage(const char* name)
+{
+  std::cout << "Usage: " << name << " [-m model] <log file>" << std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout << "  -m <arg>    Simulate the given cluster, may be repeated to compare models:" << std::endl;
+  std::cout << "              cluster[:nodes=n,slots=n,latency=us,bandwidth=MB/s,replication=n," << std::endl;
+  std::cout << "              block=MB,handlers=n,open=us,close=us]." << std::endl;
+}
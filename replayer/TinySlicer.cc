@@ -0,0 +1,344 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A tool cutting a slice out of a log: a time window, some paths, some
+// threads or some kinds of calls, written as a log that can still be
+// replayed (see TraceSlicer.h). With an index built by -x (see
+// LogIndex.h) it seeks close to the start of the window instead of
+// reading the log from its start, and it stops at the end of the window.
+// Files opened up to a lookback time before the window are known;
+// reads of files opened earlier are dropped and counted.
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <unistd.h>
+
+#include "LogIndex.h"
+#include "LogReader.h"
+#include "Logger.h"
+#include "TraceSlicer.h"
+#include "WorkerPool.h"
+
+#define INDEX_BLOCK 65536
+#define BATCH_RECORDS 16384
+
+static hdfs::TraceSlicer::Filter filter = {0, -1, {}, {}, true, true, true, true};
+static double lookback = 600;     //seconds
+static unsigned threads = 1;
+static long records = 0;
+
+void printUsage(const char* name);
+bool parseWindow(const char* arg);
+bool parseTypes(const char* arg);
+bool sliceSerial(hdfs::LogReader &reader, hdfs::TraceSlicer &slicer);
+bool sliceParallel(hdfs::LogReader &reader, hdfs::TraceSlicer &slicer);
+
+int main(int argc, char* argv[]) {
+  int opt;
+  bool index = false;
+
+  while((opt = getopt(argc, argv, "xw:p:t:o:l:j:")) != -1) {
+    switch (opt) {
+      case 'x':
+        index = true;
+        break;
+      case 'w':
+        if (!parseWindow(optarg)) {
+          std::cerr << "Window must be <from>:<to> in seconds, either may be empty." << std::endl;
+          return 1;
+        }
+        break;
+      case 'p':
+        filter.prefixes.push_back(optarg);
+        break;
+      case 't':
+        filter.threads.insert(std::atol(optarg));
+        break;
+      case 'o':
+        if (!parseTypes(optarg)) {
+          std::cerr << "Types must be open, read, write or meta, separated by commas." << std::endl;
+          return 1;
+        }
+        break;
+      case 'l':
+        lookback = std::atof(optarg);
+        if (lookback < 0) {
+          std::cerr << "Lookback must be non-negative." << std::endl;
+          return 1;
+        }
+        break;
+      case 'j':
+        if (std::atoi(optarg) <= 0) {
+          std::cerr << "Number of threads must be positive." << std::endl;
+          return 1;
+        }
+        threads = std::atoi(optarg);
+        break;
+      default:
+        printUsage(argv[0]);
+        return 0;
+    }
+  }
+
+  if (optind >= argc || (!index && optind + 1 >= argc)) {
+    printUsage(argv[0]);
+    return 0;
+  }
+
+  std::string log = argv[optind];
+  std::string index_path = hdfs::LogIndex::pathOf(log);
+  hdfs::LogIndex log_index;
+  bool indexed = log_index.load(index_path, log);
+
+  if (index) {
+    std::cout << "Indexing " << log << std::endl;
+    if (!log_index.build(log, INDEX_BLOCK) || !log_index.save(index_path)) {
+      std::cerr << "Failed to index " << log << std::endl;
+      return 1;
+    }
+    if (optind + 1 >= argc) {
+      return 0;
+    }
+    indexed = true;
+  }
+
+  hdfs::LogReader reader(log.c_str());
+  hdfs::TraceClock clock;
+  long offset = 0;
+
+  if (indexed) {
+    offset = log_index.offsetBefore(filter.from - (long)(lookback * 1000000000));
+    clock = hdfs::TraceClock(log_index.startDate(), log_index.startTime());
+
+    // the clock goes on from the time the index has for the block
+    auto first = reader.seek(offset) ? reader.next() : nullptr;
+    if (first != nullptr) {
+      clock.resume(*first, log_index.timeAt(offset));
+    }
+  } else if (filter.from > 0) {
+    std::cout << "No index of " << log << ", reading from its start. ";
+    std::cout << "Build one with -x." << std::endl;
+  }
+  if (!reader.seek(offset)) {
+    std::cerr << "Failed to read " << log << std::endl;
+    return 1;
+  }
+
+  hdfs::Logger out;
+  if (!out.startLog(argv[optind + 1])) {
+    std::cerr << "Failed to create " << argv[optind + 1] << std::endl;
+    return 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  hdfs::TraceSlicer slicer(filter, clock, out);
+  bool ok = threads > 1 ? sliceParallel(reader, slicer) 
+    : sliceSerial(reader, slicer);
+  slicer.finish();
+  reader.close();
+  std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+  if (!ok) {
+    std::cerr << "Failed to parse log #" << records + 1;
+    std::cerr << " after offset " << offset << std::endl;
+  }
+  std::cout << "Kept " << slicer.kept() << " of " << records;
+  std::cout << " records read from offset " << offset << " in ";
+  std::cout << time.count() << " seconds." << std::endl;
+  if (slicer.orphans() > 0) {
+    std::cout << "Dropped " << slicer.orphans() << " reads of files opened ";
+    std::cout << "before the lookback, see -l." << std::endl;
+  }
+
+  return ok ? 0 : 1;
+}
+
+void printUsage(const char* name)
+{
+  std::cout << "Usage: " << name << " [-x] [-w from:to] [-p prefix] [-t thread] [-o types]";
+  std::cout << " [-l seconds] [-j threads] <log file> <output log file>" << std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout << "  -x          Index the log for seeking, output log file is then optional." << std::endl;
+  std::cout << "  -w <arg>    Keep calls between the given seconds after the first record, e.g. 3600:4200." << std::endl;
+  std::cout << "  -p <arg>    Keep calls on paths with the given prefix, may be repeated." << std::endl;
+  std::cout << "  -t <arg>    Keep calls of the given thread id, may be repeated." << std::endl;
+  std::cout << "  -o <arg>    Keep the given calls: open, read, write (with flush, hsync and seek) or meta" << std::endl;
+  std::cout << "              (getfileinfo and listdir), comma separated. Default all." << std::endl;
+  std::cout << "  -l <arg>    Look for opens the given seconds before the window. Default 600." << std::endl;
+  std::cout << "  -j <arg>    Parse the log with the given number of threads." << std::endl;
+}
+
+bool parseWindow(const char* arg)
+{
+  std::string window = arg;
+  size_t colon = window.find(':');
+  if (colon == std::string::npos) {
+    return false;
+  }
+
+  std::string from = window.substr(0, colon);
+  std::string to = window.substr(colon + 1);
+  char* end = nullptr;
+
+  filter.from = 0;
+  if (from != "") {
+    filter.from = (long)(std::strtod(from.c_str(), &end) * 1000000000);
+    if (*end != '\0' || filter.from < 0) return false;
+  }
+  filter.to = -1;
+  if (to != "") {
+    filter.to = (long)(std::strtod(to.c_str(), &end) * 1000000000);
+    if (*end != '\0' || filter.to < filter.from) return false;
+  }
+
+  return true;
+}
+
+bool parseTypes(const char* arg)
+{
+  std::string types = std::string(arg) + ",";
+  filter.opens = filter.reads = filter.writes = filter.metadata = false;
+
+  while (!types.empty()) {
+    size_t comma = types.find(',');
+    std::string type = types.substr(0, comma);
+
+    if (type == "open") {
+      filter.opens = true;
+    } else if (type == "read") {
+      filter.reads = true;
+    } else if (type == "write") {
+      filter.writes = true;
+    } else if (type == "meta") {
+      filter.metadata = true;
+    } else {
+      return false;
+    }
+    types = types.substr(comma + 1);
+  }
+
+  return true;
+}
+
+bool sliceSerial(hdfs::LogReader &reader, hdfs::TraceSlicer &slicer)
+{
+  std::string record;
+  hadoop::hdfs::log msg;
+
+  while (reader.nextRaw(record)) {
+    if (!msg.ParseFromString(record)) {
+      return false;
+    }
+    records++;
+    if (!slicer.add(msg, record)) {
+      return true;
+    }
+  }
+
+  return reader.isEOF();
+}
+
+/* Records are cut out in main thread and parsed in batches by a pool,
+ * then handed to the slicer in log order. */
+bool sliceParallel(hdfs::LogReader &reader, hdfs::TraceSlicer &slicer)
+{
+  struct Batch {
+    std::string data;
+    std::vector<uint32_t> sizes;
+    std::vector<hadoop::hdfs::log> msgs;
+    bool ok;
+  };
+
+  std::map<long, std::shared_ptr<Batch>> parsed;
+  std::mutex mutex;
+  long submitted = 0;
+  long next = 0;
+  bool done = false;
+  bool ok = true;
+
+  auto consume = [&]() {
+    std::string record;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    for (auto batch = parsed.find(next); batch != parsed.end() && !done; 
+        batch = parsed.find(next)) {
+      std::shared_ptr<Batch> ready = batch->second;
+      parsed.erase(batch);
+      next++;
+      lock.unlock();
+
+      const char* data = ready->data.data();
+      for (size_t i = 0; i < ready->msgs.size() && !done; ++i) {
+        record.assign(data, ready->sizes[i]);
+        records++;
+        done = !slicer.add(ready->msgs[i], record);
+        data += ready->sizes[i];
+      }
+      if (!ready->ok && !done) {
+        ok = false;
+        done = true;
+      }
+      lock.lock();
+    }
+  };
+
+  hdfs::WorkerPool pool(threads, threads * 2);
+  std::shared_ptr<Batch> batch(new Batch());
+  std::string record;
+  bool more = reader.nextRaw(record);
+
+  while (more && !done) {
+    batch->data.append(record);
+    batch->sizes.push_back(record.size());
+    more = reader.nextRaw(record);
+
+    if (!more || batch->sizes.size() >= BATCH_RECORDS) {
+      long id = submitted++;
+      pool.submit([batch, id, &parsed, &mutex](unsigned) {
+          const char* data = batch->data.data();
+          batch->ok = true;
+          batch->msgs.resize(batch->sizes.size());
+
+          for (size_t i = 0; i < batch->sizes.size(); ++i) {
+            if (!batch->msgs[i].ParseFromArray(data, batch->sizes[i])) {
+              batch->msgs.resize(i);
+              batch->ok = false;
+              break;
+            }
+            data += batch->sizes[i];
+          }
+
+          std::lock_guard<std::mutex> lock(mutex);
+          parsed[id] = batch;
+      });
+      batch.reset(new Batch());
+      consume();
+    }
+  }
+
+  pool.drain();
+  consume();
+
+  return ok && (done || reader.isEOF());
+}
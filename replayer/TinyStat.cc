@@ -0,0 +1,228 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A tool reading the stats files the logger of a traced process keeps
+// next to its log (see LoggerStats.h), while the process runs. It
+// shows records written and dropped, backlog of the logger, and time
+// spent logging: in all, waiting for the lock, writing and flushing.
+// Overhead is the share of a thread's time spent in log calls since
+// logging started, or over the last interval with -w. With -b it exits
+// with 2 when any thread is over the given budget, so every host can be
+// checked by a script.
+
+#include <thread>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <unistd.h>
+
+#include "LoggerStats.h"
+
+static double watch = 0;        //seconds between reads, 0 reads once
+static double budget = -1;      //percent of a thread's time
+static size_t top = 10;
+
+void printUsage(const char* name);
+bool load(const char* path, hdfs::LoggerStats::Snapshot &snapshot);
+bool print(const hdfs::LoggerStats::Snapshot &now, 
+    const hdfs::LoggerStats::Snapshot* last);
+double percentile(const hdfs::LoggerStats::Counts &counts, double p);
+
+int main(int argc, char* argv[]) {
+  int opt;
+
+  while((opt = getopt(argc, argv, "w:b:t:")) != -1) {
+    switch (opt) {
+      case 'w':
+        watch = std::atof(optarg);
+        if (watch <= 0) {
+          std::cerr << "Watch interval must be positive." << std::endl;
+          return 1;
+        }
+        break;
+      case 'b':
+        budget = std::atof(optarg);
+        if (budget < 0) {
+          std::cerr << "Budget must be non-negative." << std::endl;
+          return 1;
+        }
+        break;
+      case 't':
+        if (std::atoi(optarg) < 0) {
+          std::cerr << "Number of top threads must be non-negative." << std::endl;
+          return 1;
+        }
+        top = std::atoi(optarg);
+        break;
+      default:
+        printUsage(argv[0]);
+        return 0;
+    }
+  }
+
+  if (optind >= argc) {
+    printUsage(argv[0]);
+    return 0;
+  }
+
+  std::vector<hdfs::LoggerStats::Snapshot> last(argc - optind);
+  bool over = false;
+  bool first = true;
+
+  do {
+    if (!first) {
+      std::this_thread::sleep_for(std::chrono::milliseconds((long)(watch * 1000)));
+    }
+    for (int i = optind; i < argc; ++i) {
+      hdfs::LoggerStats::Snapshot snapshot;
+      if (!load(argv[i], snapshot)) {
+        std::cerr << "Failed to read stats " << argv[i] << std::endl;
+        return 1;
+      }
+      over |= print(snapshot, first ? nullptr : &last[i - optind]);
+      last[i - optind] = snapshot;
+    }
+    first = false;
+  } while (watch > 0);
+
+  return over ? 2 : 0;
+}
+
+void printUsage(const char* name)
+{
+  std::cout << "Usage: " << name << " [-w seconds] [-b percent] [-t top] <stats file>..." << std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout << "  -w <arg>    Read the stats again every given seconds, showing the last interval." << std::endl;
+  std::cout << "  -b <arg>    Exit with 2 if a thread spends more than the given percent of time logging." << std::endl;
+  std::cout << "  -t <arg>    Show the given number of threads spending most time logging. Default 10." << std::endl;
+}
+
+bool load(const char* path, hdfs::LoggerStats::Snapshot &snapshot)
+{
+  std::ifstream in(path);
+  return snapshot.load(in);
+}
+
+/* Upper bound of the log2 bucket holding the percentile, in ns */
+double percentile(const hdfs::LoggerStats::Counts &counts, double p)
+{
+  uint64_t total = 0, seen = 0;
+  for (int i = 0; i < CALL_BUCKETS; ++i) total += counts.calls[i];
+
+  for (int i = 0; i < CALL_BUCKETS; ++i) {
+    seen += counts.calls[i];
+    if (seen > 0 && seen >= p / 100 * total) return (double)(2UL << i);
+  }
+
+  return 0;
+}
+
+/* Counts since the last snapshot if given; returns whether a thread is
+ * over budget */
+bool print(const hdfs::LoggerStats::Snapshot &now, 
+    const hdfs::LoggerStats::Snapshot* last)
+{
+  typedef hdfs::LoggerStats::Counts Counts;
+
+  // a thread seen in the last snapshot counts from there
+  std::vector<Counts> threads = now.threads;
+  long since = now.start;
+  if (last != nullptr && last->pid == now.pid && last->start == now.start) {
+    since = last->time;
+    for (auto &counts : threads) {
+      for (auto &before : last->threads) {
+        if (before.thread != counts.thread) continue;
+
+        counts.records -= before.records;
+        counts.bytes -= before.bytes;
+        counts.call_ns -= before.call_ns;
+        counts.lock_ns -= before.lock_ns;
+        counts.write_ns -= before.write_ns;
+        counts.flush_ns -= before.flush_ns;
+        counts.dropped -= before.dropped;
+        counts.errors -= before.errors;
+        for (int i = 0; i < CALL_BUCKETS; ++i) {
+          counts.calls[i] -= before.calls[i];
+        }
+      }
+    }
+  }
+
+  double seconds = std::max(now.time - since, 1L) / 1e9;
+  Counts total = Counts();
+  for (auto &counts : threads) {
+    total.records += counts.records;
+    total.bytes += counts.bytes;
+    total.call_ns += counts.call_ns;
+    total.lock_ns += counts.lock_ns;
+    total.write_ns += counts.write_ns;
+    total.flush_ns += counts.flush_ns;
+    total.dropped += counts.dropped;
+    total.errors += counts.errors;
+    for (int i = 0; i < CALL_BUCKETS; ++i) total.calls[i] += counts.calls[i];
+  }
+
+  auto mean = [&total](uint64_t ns) { 
+    return total.records > 0 ? ns / 1000.0 / total.records : 0; 
+  };
+  auto overhead = [seconds](const Counts &counts) {
+    return counts.call_ns / 1e9 / seconds * 100;
+  };
+
+  std::cout << "Process " << now.pid << " logging to " << now.log << ", ";
+  std::cout << (last != nullptr ? "last " : "") << seconds << " seconds:";
+  std::cout << std::endl;
+  std::cout << "  records: " << total.records << " (" << total.records / seconds;
+  std::cout << "/s), MB: " << total.bytes / 1024.0 / 1024 << ", dropped: ";
+  std::cout << total.dropped << ", errors: " << total.errors << std::endl;
+  std::cout << "  backlog: " << now.waiting << " waiting, " << now.max_waiting;
+  std::cout << " at peak" << std::endl;
+  std::cout << "  mean us per record, call: " << mean(total.call_ns);
+  std::cout << " lock: " << mean(total.lock_ns) << " write: " << mean(total.write_ns);
+  std::cout << " flush: " << mean(total.flush_ns) << std::endl;
+  std::cout << "  call us p50: <" << percentile(total, 50) / 1000;
+  std::cout << " p99: <" << percentile(total, 99) / 1000;
+  std::cout << " p99.9: <" << percentile(total, 99.9) / 1000 << std::endl;
+
+  std::sort(threads.begin(), threads.end(), 
+      [](const Counts &l, const Counts &r) {
+        return l.call_ns != r.call_ns ? l.call_ns > r.call_ns : l.thread < r.thread;
+      });
+
+  bool over = false;
+  std::cout << "  thread\trecords\tdropped\toverhead %\tcall p99 (us)" << std::endl;
+  for (size_t i = 0; i < threads.size(); ++i) {
+    const Counts &counts = threads[i];
+    if (i < top) {
+      std::cout << "  " << counts.thread << "\t" << counts.records << "\t";
+      std::cout << counts.dropped << "\t" << overhead(counts) << "\t\t<";
+      std::cout << percentile(counts, 99) / 1000 << std::endl;
+    }
+    over |= budget >= 0 && overhead(counts) > budget;
+  }
+  if (over) {
+    std::cout << "Over budget of " << budget << "% of thread time." << std::endl;
+  }
+  std::cout << std::endl;
+
+  return over;
+}
@@ -0,0 +1,87 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thread>
+#include <algorithm>
+
+#include "TokenBucket.h"
+
+using namespace hdfs;
+
+TokenBucket::TokenBucket(double rate, double end_rate, double ramp_seconds, 
+    double burst)
+  : rate_(rate)
+  , end_rate_(end_rate)
+  , ramp_seconds_(ramp_seconds)
+  , burst_(burst)
+  , tokens_(0)
+{
+  start();
+}
+
+TokenBucket::~TokenBucket()
+{
+}
+
+void TokenBucket::start()
+{
+  start_ = Clock::now();
+  last_ = start_;
+  tokens_ = 0;
+}
+
+/* Tokens may go below zero for an operation larger than the bucket,
+ * the caller then waits until the debt is paid off. */
+void TokenBucket::take(double tokens)
+{
+  refill();
+  tokens_ -= tokens;
+
+  while (tokens_ < 0) {
+    double wait = -tokens_ / std::max(rate(), 1e-9);
+    std::this_thread::sleep_for(std::chrono::duration<double>(
+          std::min(wait, 0.1)));   //rate may change while ramping
+    refill();
+  }
+}
+
+double TokenBucket::rate() const
+{
+  return rateAt(std::chrono::duration<double>(Clock::now() - start_).count());
+}
+
+double TokenBucket::rateAt(double seconds) const
+{
+  if (seconds >= ramp_seconds_) {
+    return end_rate_;
+  }
+
+  return rate_ + (end_rate_ - rate_) * seconds / ramp_seconds_;
+}
+
+/* Add tokens for the time since last refill, at the mean rate of it */
+void TokenBucket::refill()
+{
+  auto now = Clock::now();
+  double from = std::chrono::duration<double>(last_ - start_).count();
+  double to = std::chrono::duration<double>(now - start_).count();
+
+  tokens_ += (rateAt(from) + rateAt(to)) / 2 * (to - from);
+  tokens_ = std::min(tokens_, rateAt(to) * burst_);
+  last_ = now;
+}
@@ -0,0 +1,63 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// TokenBucket paces an open loop load. Tokens, e.g. operations or
+// bytes, are added at a target rate whatever happens to operations
+// already sent, and an operation is only sent once its tokens are
+// there. The rate can ramp linearly from one value to another over a
+// given time and stay at the final value afterwards, so that a single
+// replay sweeps offered load. Up to 'burst' seconds worth of tokens
+// are saved up while the caller is busy.
+
+#ifndef LIBHDFSPP_TOKENBUCKET_H_
+#define LIBHDFSPP_TOKENBUCKET_H_
+
+#include <chrono>
+
+namespace hdfs
+{
+
+class TokenBucket
+{
+ public:
+  TokenBucket(double rate, double end_rate, double ramp_seconds, 
+      double burst);
+  virtual ~TokenBucket();
+
+  void start();
+  void take(double tokens);   //block until tokens are available
+  double rate() const;        //rate at this moment
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  double rateAt(double seconds) const;
+  void refill();
+
+  double rate_;
+  double end_rate_;
+  double ramp_seconds_;
+  double burst_;
+  double tokens_;
+  Clock::time_point start_;
+  Clock::time_point last_;
+};
+
+} /* hdfs */ 
+
+#endif
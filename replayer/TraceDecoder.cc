@@ -0,0 +1,207 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TraceDecoder.h"
+
+using namespace hdfs;
+
+TraceDecoder::TraceDecoder(const char* logPath, size_t depth, int tenant, 
+    long shift)
+  : path_(logPath)
+  , tenant_(tenant)
+  , shift_(shift)
+  , ring_(depth)
+  , records_(0)
+  , kept_(0)
+  , failed_(false)
+{
+}
+
+TraceDecoder::~TraceDecoder()
+{
+  join();
+}
+
+void TraceDecoder::setPartition(
+    std::shared_ptr<const std::unordered_set<long>> threads)
+{
+  partition_ = threads;
+}
+
+void TraceDecoder::start()
+{
+  thread_ = std::thread(&TraceDecoder::run, this);
+}
+
+bool TraceDecoder::next(ReplayOp &op)
+{
+  return ring_.pop(op);
+}
+
+void TraceDecoder::join()
+{
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+long TraceDecoder::records() const
+{
+  return records_.load();
+}
+
+long TraceDecoder::kept() const
+{
+  return kept_.load();
+}
+
+bool TraceDecoder::failed() const
+{
+  return failed_.load();
+}
+
+/* Keep the fields replayer uses, see LibhdfsppLog.h for argument order */
+void TraceDecoder::decode(const hadoop::hdfs::log &msg, long time, 
+    ReplayOp &op)
+{
+  op.type = msg.type();
+  op.time = time;
+  op.thread = msg.threadid();
+  op.path.clear();
+
+  switch (msg.type()) {
+    case hadoop::hdfs::log_FuncType_OPEN:
+      op.path = msg.path();
+      op.flags = (int)msg.argument(1);
+      op.buffer_size = (int)msg.argument(2);
+      op.replication = (short)msg.argument(3);
+      op.block_size = (int)msg.argument(4);
+      break;
+    case hadoop::hdfs::log_FuncType_OPEN_RET:
+      op.handle = msg.argument(0);
+      break;
+    case hadoop::hdfs::log_FuncType_CLOSE:
+      op.handle = msg.argument(1);
+      break;
+    case hadoop::hdfs::log_FuncType_READ:
+      op.handle = msg.argument(1);
+      op.position = msg.argument(2);
+      op.length = msg.argument(4);
+      break;
+    case hadoop::hdfs::log_FuncType_WRITE:
+      op.handle = msg.argument(1);
+      op.length = msg.argument(3);
+      break;
+    case hadoop::hdfs::log_FuncType_FLUSH:
+    case hadoop::hdfs::log_FuncType_HSYNC:
+      op.handle = msg.argument(1);
+      break;
+    case hadoop::hdfs::log_FuncType_SEEK:
+      op.handle = msg.argument(1);
+      op.position = msg.argument(2);
+      break;
+    case hadoop::hdfs::log_FuncType_GETFILEINFO:
+    case hadoop::hdfs::log_FuncType_LISTDIR:
+      op.path = msg.path();
+      break;
+    default:
+      break;
+  }
+}
+
+void TraceDecoder::run()
+{
+  LogReader reader(path_.c_str());
+  std::unique_ptr<hadoop::hdfs::log> msg;
+  TraceClock clock;
+  ReplayOp op;
+
+  while ((msg = reader.next()) != nullptr) {
+    decode(*msg, clock.since(*msg) + shift_, op);
+    op.tenant = tenant_;
+    records_++;
+
+    if (partition_ == nullptr || keep(op)) {
+      ring_.push(op);
+      kept_++;
+    }
+  }
+
+  failed_ = !reader.isEOF();
+  reader.close();
+  ring_.close();
+}
+
+/* Whether an operation belongs to this partition. Opens of other
+ * partitions are remembered in case our threads read those files. */
+bool TraceDecoder::keep(ReplayOp &op)
+{
+  bool mine = partition_->count(op.thread) > 0;
+
+  switch (op.type) {
+    case hadoop::hdfs::log_FuncType_OPEN:
+      if (!mine) opening_[op.thread] = op;
+      return mine;
+    case hadoop::hdfs::log_FuncType_OPEN_RET: {
+      foreign_.erase(op.handle);    //handle value may be reused
+      owned_.erase(op.handle);
+      if (mine) owned_.insert(op.handle);
+
+      auto open = opening_.find(op.thread);
+      if (open != opening_.end()) {
+        Foreign &file = foreign_[op.handle];
+        file.open = std::move(open->second);
+        file.used = false;
+        opening_.erase(open);
+      }
+      return mine;
+    }
+    case hadoop::hdfs::log_FuncType_READ:
+    case hadoop::hdfs::log_FuncType_WRITE:
+    case hadoop::hdfs::log_FuncType_FLUSH:
+    case hadoop::hdfs::log_FuncType_HSYNC:
+    case hadoop::hdfs::log_FuncType_SEEK: {
+      if (!mine) return false;
+
+      auto file = foreign_.find(op.handle);
+      if (file != foreign_.end() && !file->second.used) {
+        const ReplayOp &open = file->second.open;
+        op.path = open.path;
+        op.flags = open.flags;
+        op.buffer_size = open.buffer_size;
+        op.replication = open.replication;
+        op.block_size = open.block_size;
+        file->second.used = true;
+      }
+      return true;
+    }
+    case hadoop::hdfs::log_FuncType_CLOSE: {
+      // close what we opened, no matter who closes it
+      auto file = foreign_.find(op.handle);
+      if (file == foreign_.end()) {
+        return owned_.erase(op.handle) > 0 || mine;
+      }
+
+      bool used = file->second.used;
+      foreign_.erase(file);
+      return used;
+    }
+    default:
+      return mine;
+  }
+}
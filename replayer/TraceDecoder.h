@@ -0,0 +1,91 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// TraceDecoder reads a log on a thread of its own and turns records
+// into ReplayOps, which are handed to the consumer through a bounded
+// OpRing. Parsing thus overlaps with replay and never delays dispatch,
+// while at most 'depth' decoded operations are held in memory no matter
+// how long the log is. Operations are tagged with a tenant and shifted
+// in time, so several decoders can replay one log as separate tenants.
+//
+// A decoder can also be limited to the operations of some traced
+// threads, for distributed replay. A thread may use a file opened by
+// a thread of another partition; the first read, write, flush, hsync
+// or seek on it carries the path and flags of the open, so that
+// replayer can open the file on first use, and the matching close is
+// kept as well.
+
+#ifndef LIBHDFSPP_TRACEDECODER_H_
+#define LIBHDFSPP_TRACEDECODER_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "LogReader.h"
+#include "OpRing.h"
+
+namespace hdfs
+{
+
+class TraceDecoder
+{
+ public:
+  TraceDecoder(const char* logPath, size_t depth, int tenant, long shift);
+  virtual ~TraceDecoder();
+
+  void setPartition(std::shared_ptr<const std::unordered_set<long>> threads);
+  void start();
+  bool next(ReplayOp &op);      //false once the whole log is consumed
+  void join();
+
+  long records() const;         //records decoded so far
+  long kept() const;            //records in partition, handed out
+  bool failed() const;          //stopped on a malformed record
+
+  static void decode(const hadoop::hdfs::log &msg, long time, ReplayOp &op);
+
+ private:
+  void run();
+  bool keep(ReplayOp &op);
+
+  struct Foreign {
+    ReplayOp open;    //the open done by a thread of another partition
+    bool used;        //read by this partition
+  };
+
+  std::string path_;
+  int tenant_;
+  long shift_;        //nanoseconds added to the time of every operation
+  OpRing ring_;
+  std::shared_ptr<const std::unordered_set<long>> partition_;
+  std::unordered_map<long, ReplayOp> opening_;  //foreign threads in open
+  std::unordered_map<long, Foreign> foreign_;   //files opened by them
+  std::unordered_set<long> owned_;              //files opened by us
+  std::thread thread_;
+  std::atomic<long> records_;
+  std::atomic<long> kept_;
+  std::atomic<bool> failed_;
+};
+
+} /* hdfs */ 
+
+#endif
@@ -0,0 +1,355 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <vector>
+#include <iomanip>
+#include <algorithm>
+#include <functional>
+
+#include "TraceDiff.h"
+
+#define KS_FACTOR 1.95      //of the critical KS distance at 0.001
+
+using namespace hdfs;
+
+static uint64_t mix(uint64_t x)
+{
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+TraceDiff::TraceDiff(size_t max_waiting, size_t max_files)
+  : max_waiting_(std::max(max_waiting, (size_t)1))
+  , max_files_(max_files)
+  , seq_(0)
+  , waiting_count_(0)
+  , unmatched_()
+  , untracked_(0)
+  , deltas_()
+{
+}
+
+TraceDiff::~TraceDiff()
+{
+}
+
+bool TraceDiff::compare(const char* before, const char* after)
+{
+  Side sides[2];
+  const char* paths[2] = {before, after};
+
+  for (int s = 0; s < 2; ++s) {
+    sides[s].more = sides[s].reader.setPath(paths[s]);
+    sides[s].calls = 0;
+  }
+
+  // the log with fewer calls read goes next, keeping both in step
+  Call call;
+  while (sides[0].more || sides[1].more) {
+    int s = !sides[0].more || (sides[1].more 
+        && sides[1].calls < sides[0].calls) ? 1 : 0;
+    if (nextCall(sides[s], call)) {
+      add(s, call);
+    }
+  }
+
+  for (int s = 0; s < 2; ++s) {
+    unmatched_[s] += order_[s].size();
+  }
+
+  bool ok = sides[0].reader.isEOF() && sides[1].reader.isEOF();
+  sides[0].reader.close();
+  sides[1].reader.close();
+
+  return ok;
+}
+
+bool TraceDiff::print(std::ostream &out, size_t top, double z, double share) const
+{
+  auto us = [](double ns) { return ns / 1000; };
+  auto verdict = [z, share](const Delta &delta) -> const char* {
+    double score = zScore(delta);
+    double before = delta.count > 0 ? delta.before / delta.count : 0;
+    if (std::fabs(score) < z || std::fabs(delta.mean) < share * before) {
+      return "-";
+    }
+    return delta.mean > 0 ? "slower" : "faster";
+  };
+
+  uint64_t paired = 0;
+  bool regressed = false;
+  for (int op = 0; op < TraceStats::NUM_OPS; ++op) {
+    paired += deltas_[op].count;
+  }
+
+  out << "Lined up " << paired << " calls, " << unmatched_[0];
+  out << " only in the first log and " << unmatched_[1] << " only in the ";
+  out << "second." << std::endl;
+
+  out << "\nLatency (us) of all calls, first / second log:" << std::endl;
+  out << "  op\tcount\t\tp50\t\tp90\t\tp99\t\tp999\t\tKS distance" << std::endl;
+  for (int op = 0; op < TraceStats::NUM_OPS; ++op) {
+    const Histogram &first = latency_[0][op];
+    const Histogram &second = latency_[1][op];
+    if (first.count() == 0 && second.count() == 0) continue;
+
+    out << "  " << TraceStats::opName((TraceStats::OpType)op) << "\t";
+    out << first.count() << " / " << second.count();
+    for (double p : {50.0, 90.0, 99.0, 99.9}) {
+      out << "\t" << us(first.percentile(p)) << " / " << us(second.percentile(p));
+    }
+
+    double distance = first.distance(second);
+    double n = first.count(), m = second.count();
+    out << "\t" << distance;
+    if (n > 0 && m > 0 && distance > KS_FACTOR * std::sqrt((n + m) / (n * m))) {
+      out << " (differs)";
+    }
+    out << std::endl;
+  }
+
+  out << "\nLatency change (us) of lined up calls:" << std::endl;
+  out << "  op\tpairs\tfirst\tsecond\tchange\tchange %\tz\tverdict" << std::endl;
+  for (int op = 0; op < TraceStats::NUM_OPS; ++op) {
+    const Delta &delta = deltas_[op];
+    if (delta.count == 0) continue;
+
+    double before = delta.before / delta.count;
+    out << "  " << TraceStats::opName((TraceStats::OpType)op) << "\t";
+    out << delta.count << "\t" << us(before) << "\t";
+    out << us(delta.after / delta.count) << "\t" << us(delta.mean) << "\t";
+    out << (before > 0 ? delta.mean * 100 / before : 0) << "\t\t";
+    out << zScore(delta) << "\t" << verdict(delta) << std::endl;
+    regressed |= std::string(verdict(delta)) == "slower";
+  }
+
+  std::vector<std::pair<std::string, Delta>> files(files_.begin(), files_.end());
+  std::sort(files.begin(), files.end(), 
+      [](const std::pair<std::string, Delta> &l, 
+        const std::pair<std::string, Delta> &r) {
+        double added_l = l.second.after - l.second.before;
+        double added_r = r.second.after - r.second.before;
+        return added_l != added_r ? added_l > added_r : l.first < r.first;
+      });
+
+  out << "\nFiles by latency added, top " << std::min(top, files.size());
+  out << " of " << files.size();
+  if (untracked_ > 0) {
+    out << " (" << untracked_ << " calls of more files not tracked)";
+  }
+  out << ":" << std::endl;
+  out << "  added (ms)\tpairs\tchange (us)\tz\tverdict\tpath" << std::endl;
+  for (size_t i = 0; i < files.size(); ++i) {
+    const Delta &delta = files[i].second;
+    if (i < top) {
+      out << "  " << (delta.after - delta.before) / 1000000 << "\t\t";
+      out << delta.count << "\t" << us(delta.mean) << "\t\t";
+      out << zScore(delta) << "\t" << verdict(delta) << "\t";
+      out << files[i].first << std::endl;
+    }
+    regressed |= std::string(verdict(delta)) == "slower";
+  }
+
+  return regressed;
+}
+
+/* Mean change over its standard error; unbounded for a change without
+ * any spread */
+double TraceDiff::zScore(const Delta &delta)
+{
+  if (delta.count < 2) {
+    return 0;
+  }
+
+  double error = std::sqrt(delta.m2 / (delta.count - 1) / delta.count);
+  if (error > 0) {
+    return delta.mean / error;
+  }
+  return delta.mean == 0 ? 0 : (delta.mean > 0 ? HUGE_VAL : -HUGE_VAL);
+}
+
+/* Reads records of a log up to the return of the next call */
+bool TraceDiff::nextCall(Side &side, Call &call)
+{
+  std::unique_ptr<hadoop::hdfs::log> msg;
+  std::hash<std::string> hash;
+
+  while ((msg = side.reader.next()) != nullptr) {
+    long time = side.clock.since(*msg);
+    long thread = msg->threadid();
+    Pending pending = {TraceStats::OPEN, 0, "", time};
+
+    switch (msg->type()) {
+      case hadoop::hdfs::log_FuncType_OPEN:
+        pending.path = msg->path();
+        side.opening[thread] = msg->path();
+        break;
+      case hadoop::hdfs::log_FuncType_READ: {
+        if (msg->argument_size() < 5) continue;
+
+        auto path = side.paths.find(msg->argument(1));
+        if (path != side.paths.end()) pending.path = path->second;
+        pending.op = TraceStats::READ;
+        pending.key = mix(mix(msg->argument(2)) ^ msg->argument(4));
+        break;
+      }
+      case hadoop::hdfs::log_FuncType_CLOSE: {
+        if (msg->argument_size() < 2) continue;
+
+        auto path = side.paths.find(msg->argument(1));
+        if (path != side.paths.end()) {
+          pending.path = path->second;
+          side.paths.erase(path);
+        }
+        pending.op = TraceStats::CLOSE;
+        break;
+      }
+      case hadoop::hdfs::log_FuncType_WRITE:
+      case hadoop::hdfs::log_FuncType_FLUSH:
+      case hadoop::hdfs::log_FuncType_HSYNC:
+      case hadoop::hdfs::log_FuncType_SEEK: {
+        if (msg->argument_size() < 2) continue;
+
+        bool is_call;
+        auto path = side.paths.find(msg->argument(1));
+        if (path != side.paths.end()) pending.path = path->second;
+        pending.op = TraceStats::opOf(msg->type(), is_call);
+        if (msg->argument_size() >= 3) {   //length or position
+          pending.key = mix(msg->argument(msg->argument_size() - 1));
+        }
+        break;
+      }
+      case hadoop::hdfs::log_FuncType_GETFILEINFO:
+      case hadoop::hdfs::log_FuncType_LISTDIR: {
+        bool is_call;
+        pending.path = msg->path();
+        pending.op = TraceStats::opOf(msg->type(), is_call);
+        break;
+      }
+      case hadoop::hdfs::log_FuncType_OPEN_RET: {
+        auto path = side.opening.find(thread);
+        if (path != side.opening.end()) {
+          if (msg->argument_size() >= 1) {
+            side.paths[msg->argument(0)] = path->second;
+          }
+          side.opening.erase(path);
+        }
+      }
+      // fall through
+      default: {
+        auto found = side.pending.find(thread);
+        if (found == side.pending.end()) continue;
+
+        bool is_call;
+        int op = TraceStats::opOf(msg->type(), is_call);
+        if (is_call || found->second.op != op) {
+          side.pending.erase(found);
+          continue;
+        }
+
+        call.op = op;
+        call.key = found->second.key;
+        call.path.swap(found->second.path);
+        call.latency = time - found->second.time;
+        side.pending.erase(found);
+        side.calls++;
+        return true;
+      }
+    }
+
+    pending.key = mix(pending.key ^ mix(hash(pending.path) + pending.op));
+    side.pending[thread] = std::move(pending);
+  }
+
+  side.more = false;
+  return false;
+}
+
+/* Pairs a call with the oldest waiting one of the other log, or waits */
+void TraceDiff::add(int side, const Call &call)
+{
+  latency_[side][call.op].record(call.latency);
+
+  auto &others = waiting_[1 - side];
+  auto found = others.find(call.key);
+  if (found != others.end()) {
+    Waiting other = found->second.front();
+    found->second.pop_front();
+    if (found->second.empty()) others.erase(found);
+    order_[1 - side].erase(other.seq);
+    waiting_count_--;
+
+    if (side == 0) {
+      pair(call, call.latency, other.latency);
+    } else {
+      pair(call, other.latency, call.latency);
+    }
+    return;
+  }
+
+  waiting_[side][call.key].push_back(Waiting{seq_, call.latency});
+  order_[side][seq_++] = call.key;
+  if (++waiting_count_ > max_waiting_) {
+    dropOldest();
+  }
+}
+
+void TraceDiff::pair(const Call &call, long before, long after)
+{
+  auto update = [before, after](Delta &delta) {
+    double change = after - before;
+    delta.count++;
+    double gap = change - delta.mean;
+    delta.mean += gap / delta.count;
+    delta.m2 += gap * (change - delta.mean);
+    delta.before += before;
+    delta.after += after;
+  };
+
+  update(deltas_[call.op]);
+  if (call.path.empty()) {
+    return;
+  }
+
+  auto file = files_.find(call.path);
+  if (file == files_.end()) {
+    if (files_.size() >= max_files_) {
+      untracked_++;
+      return;
+    }
+    file = files_.insert(std::make_pair(call.path, Delta())).first;
+  }
+  update(file->second);
+}
+
+void TraceDiff::dropOldest()
+{
+  int side = order_[1].empty() || (!order_[0].empty() 
+      && order_[0].begin()->first < order_[1].begin()->first) ? 0 : 1;
+  auto oldest = order_[side].begin();
+
+  auto waiting = waiting_[side].find(oldest->second);
+  waiting->second.pop_front();
+  if (waiting->second.empty()) waiting_[side].erase(waiting);
+  order_[side].erase(oldest);
+  waiting_count_--;
+  unmatched_[side]++;
+}
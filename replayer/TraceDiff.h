@@ -0,0 +1,122 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// TraceDiff compares two logs of the same workload, such as captures
+// before and after an upgrade, or two replays of one capture. Calls
+// of both logs are lined up by what they do rather than when: reads by
+// path, offset and length, writes by path and length, seeks by path
+// and position, other calls by path, the n-th such
+// call of one log with the n-th of the other. Handles differ between
+// logs, so reads of files opened before a log started are lined up by
+// offset and length only.
+// For every kind of call and every file it reports the latency change
+// of lined up calls with a paired z-test, and compares latency of all
+// calls of either log by percentiles and the Kolmogorov-Smirnov
+// distance. Both logs are read side by side, and calls still waiting
+// for a partner are bounded in number: the oldest ones are dropped and
+// counted as unmatched, so whole days of logs fit in fixed memory.
+
+#ifndef LIBHDFSPP_TRACEDIFF_H_
+#define LIBHDFSPP_TRACEDIFF_H_
+
+#include <map>
+#include <deque>
+#include <string>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+
+#include "Histogram.h"
+#include "LogReader.h"
+#include "TraceStats.h"
+
+namespace hdfs
+{
+
+class TraceDiff
+{
+ public:
+  TraceDiff(size_t max_waiting, size_t max_files);
+  virtual ~TraceDiff();
+
+  bool compare(const char* before, const char* after);
+  // Changes beyond both the z score and the share of mean latency are
+  // reported as significant; returns whether any is a regression
+  bool print(std::ostream &out, size_t top, double z, double share) const;
+
+ private:
+  struct Call {
+    int op;
+    uint64_t key;
+    std::string path;
+    long latency;
+  };
+
+  struct Pending {
+    int op;
+    uint64_t key;
+    std::string path;
+    long time;
+  };
+
+  struct Side {
+    LogReader reader;
+    bool more;
+    TraceClock clock;
+    uint64_t calls;
+    std::unordered_map<long, Pending> pending;      //by thread
+    std::unordered_map<long, std::string> opening;  //by thread
+    std::unordered_map<long, std::string> paths;    //by handle
+  };
+
+  struct Waiting {
+    uint64_t seq;
+    long latency;
+  };
+
+  // mean and variance of latency changes, after Welford
+  struct Delta {
+    uint64_t count;
+    double mean;
+    double m2;
+    double before;      //sum of latency
+    double after;
+  };
+
+  static double zScore(const Delta &delta);
+  bool nextCall(Side &side, Call &call);
+  void add(int side, const Call &call);
+  void pair(const Call &call, long before, long after);
+  void dropOldest();
+
+  size_t max_waiting_;
+  size_t max_files_;
+  uint64_t seq_;
+  size_t waiting_count_;
+  uint64_t unmatched_[2];
+  uint64_t untracked_;          //paired calls of files beyond max_files
+  std::unordered_map<uint64_t, std::deque<Waiting>> waiting_[2];
+  std::map<uint64_t, uint64_t> order_[2];   //keys of waiting calls by seq
+  Histogram latency_[2][TraceStats::NUM_OPS];
+  Delta deltas_[TraceStats::NUM_OPS];
+  std::unordered_map<std::string, Delta> files_;
+};
+
+} /* hdfs */ 
+
+#endif
@@ -0,0 +1,327 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <queue>
+#include <algorithm>
+
+#include "TraceGenerator.h"
+#include "WorkerPool.h"
+
+#define NS_PER_DAY (24L * 3600 * 1000000000)
+#define STEP_NS 1000000000L       //of trace time run at a time
+#define ALIGNMENT 4096            //of random offsets
+#define RECENT_READS 16
+
+using namespace hdfs;
+
+TraceGenerator::TraceGenerator(const TraceModel &model, unsigned long seed, 
+    const std::string &prefix, double think_scale)
+  : model_(model)
+  , seed_(seed)
+  , prefix_(prefix)
+  , think_scale_(think_scale)
+  , written_(0)
+  , end_(0)
+{
+  long files = std::max(model.files, 1L);
+  std::mt19937_64 random(seed);
+  double total = 0;
+
+  for (int kind = 0; kind < TraceModel::NUM_MOVES; ++kind) {
+    total += model.streams[kind];
+    kinds_.push_back(total);
+  }
+
+  total = 0;
+  popularity_.resize(files);
+  file_sizes_.resize(files);
+  for (long rank = 0; rank < files; ++rank) {
+    total += std::pow(rank + 1.0, -model.zipf);
+    popularity_[rank] = total;
+    file_sizes_[rank] = model.file_sizes.draw(random);
+  }
+}
+
+TraceGenerator::~TraceGenerator()
+{
+}
+
+bool TraceGenerator::generate(Logger &out, long records, unsigned workers)
+{
+  std::vector<Thread> threads(std::max(model_.threads, 1L));
+  for (size_t i = 0; i < threads.size(); ++i) {
+    Thread &thread = threads[i];
+    thread.id = 0x7f0000000000L + (long)i * 0x800000;
+    thread.index = i;
+    thread.random.seed(seed_ + i + 1);
+    thread.time = model_.think.draw(thread.random) * think_scale_;
+    thread.budget = records / threads.size() + ((long)i < records % (long)threads.size());
+    thread.records = 0;
+    thread.done = false;
+    thread.handle = 0;
+    thread.opens = 0;
+  }
+
+  // runs a thread up to the end of the step, keeping records after it
+  auto run = [this](Thread &thread, long until, std::vector<Record> &out) {
+    while (true) {
+      while (!thread.pending.empty() && thread.pending.front().time < until) {
+        out.push_back(std::move(thread.pending.front()));
+        thread.pending.pop_front();
+      }
+      if (!thread.pending.empty() || thread.done || thread.time >= until) {
+        break;
+      }
+      step(thread);
+    }
+  };
+  auto later = [](const Record &l, const Record &r) {
+    if (l.time != r.time) return l.time > r.time;
+    return l.thread != r.thread ? l.thread > r.thread : l.seq > r.seq;
+  };
+
+  workers = std::max(workers, 1U);
+  WorkerPool pool(workers, workers);
+  std::vector<std::vector<Record>> outputs(workers);
+  long from = 0;
+  bool ok = true;
+
+  while (ok) {
+    long until = from + STEP_NS;
+    for (unsigned w = 0; w < workers; ++w) {
+      pool.submit([&, w, until](unsigned) {
+          outputs[w].clear();
+          for (size_t i = w; i < threads.size(); i += workers) {
+            run(threads[i], until, outputs[w]);
+          }
+          std::sort(outputs[w].begin(), outputs[w].end(), 
+              [&later](const Record &l, const Record &r) { 
+                return later(r, l); 
+              });
+      });
+    }
+    pool.drain();
+
+    // merged by a heap of the next record of every worker
+    std::vector<size_t> next(workers, 0);
+    auto compare = [&](unsigned l, unsigned r) {
+      return later(outputs[l][next[l]], outputs[r][next[r]]);
+    };
+    std::priority_queue<unsigned, std::vector<unsigned>, decltype(compare)> 
+      heap(compare);
+    for (unsigned w = 0; w < workers; ++w) {
+      if (!outputs[w].empty()) heap.push(w);
+    }
+    while (!heap.empty() && ok) {
+      unsigned w = heap.top();
+      heap.pop();
+      const Record &record = outputs[w][next[w]];
+      ok = out.writeDelimitedLog(record.data);
+      end_ = std::max(end_, record.time);
+      written_++;
+      if (++next[w] < outputs[w].size()) heap.push(w);
+    }
+
+    // the next step starts at the earliest record left, skipping idle time
+    from = -1;
+    for (auto &thread : threads) {
+      long time = !thread.pending.empty() ? thread.pending.front().time :
+        (thread.done ? -1 : thread.time);
+      if (time >= 0 && (from < 0 || time < from)) from = time;
+    }
+    if (from < 0) break;
+  }
+
+  return ok;
+}
+
+long TraceGenerator::written() const
+{
+  return written_;
+}
+
+long TraceGenerator::duration() const
+{
+  return end_;
+}
+
+/* One call and its return: an open, a read or a close of the open file.
+ * A thread out of budget closes its file early rather than run over. */
+void TraceGenerator::step(Thread &thread)
+{
+  hadoop::hdfs::log call, ret;
+  long fs = model_.open_args[0];
+  int kind;
+
+  if (thread.handle == 0) {
+    if (thread.budget <= 0) {
+      thread.done = true;
+      return;
+    }
+
+    long file = pickFile(thread.random);
+    thread.handle = ((thread.index + 1) << 32) + ++thread.opens;
+    thread.size = file_sizes_[file];
+    thread.reads = model_.reads.draw(thread.random);
+    thread.count = thread.next = thread.last = thread.stride = 0;
+    thread.move = TraceModel::NUM_MOVES;
+    thread.kind = TraceModel::SEQUENTIAL;
+    if (kinds_.back() > 0) {
+      double point = std::uniform_real_distribution<double>(0, 
+          kinds_.back())(thread.random);
+      while (thread.kind < TraceModel::NUM_MOVES - 1 
+          && point >= kinds_[thread.kind]) {
+        thread.kind++;
+      }
+    }
+
+    call.set_type(hadoop::hdfs::log_FuncType_OPEN);
+    call.set_path(prefix_ + "/f" + std::to_string(file));
+    for (int i = 0; i < 5; ++i) {
+      call.add_argument(model_.open_args[i]);
+    }
+    ret.set_type(hadoop::hdfs::log_FuncType_OPEN_RET);
+    ret.add_argument(thread.handle);
+    kind = 0;
+  } else if (thread.reads > 0 && thread.budget > 2) {
+    long length = model_.sizes.draw(thread.random);
+    long offset = pickOffset(thread, length);
+
+    call.set_type(hadoop::hdfs::log_FuncType_READ);
+    call.add_argument(fs);
+    call.add_argument(thread.handle);
+    call.add_argument(offset);
+    call.add_argument(0);
+    call.add_argument(length);
+    ret.set_type(hadoop::hdfs::log_FuncType_READ_RET);
+    ret.add_argument(std::max(0L, std::min(length, thread.size - offset)));
+
+    thread.recent[thread.count % RECENT_READS][0] = offset;
+    thread.recent[thread.count % RECENT_READS][1] = length;
+    thread.stride = offset - thread.last;
+    thread.last = offset;
+    thread.next = offset + length;
+    thread.count++;
+    thread.reads--;
+    kind = 2;
+  } else {
+    call.set_type(hadoop::hdfs::log_FuncType_CLOSE);
+    call.add_argument(fs);
+    call.add_argument(thread.handle);
+    ret.set_type(hadoop::hdfs::log_FuncType_CLOSE_RET);
+    ret.add_argument(0);
+    thread.handle = 0;
+    kind = 1;
+  }
+
+  long time = thread.time;
+  long latency = model_.latency[kind].draw(thread.random);
+  emit(thread, call, time);
+  emit(thread, ret, time + latency);
+  thread.time = time + latency + 
+    (long)(model_.think.draw(thread.random) * think_scale_);
+}
+
+/* Day of year the given days after the start. The year of the start is
+ * a leap year if the model starts on its day 365, later years are taken
+ * to be common ones. */
+static int dayAfter(int start_date, long days)
+{
+  long day = start_date + days;
+  long first_year = start_date == 365 ? 366 : 365;
+
+  return day < first_year ? day : (day - first_year) % 365;
+}
+
+void TraceGenerator::emit(Thread &thread, hadoop::hdfs::log &msg, long time)
+{
+  long since = model_.start_time + time;
+
+  msg.set_date(dayAfter(model_.start_date, since / NS_PER_DAY));
+  msg.set_time(since % NS_PER_DAY);
+  msg.set_threadid(thread.id);
+
+  thread.pending.push_back(Record{time, thread.index, thread.records++, ""});
+  msg.SerializeToString(&thread.pending.back().data);
+  thread.budget--;
+}
+
+long TraceGenerator::pickFile(std::mt19937_64 &random) const
+{
+  double point = std::uniform_real_distribution<double>(0, 
+      popularity_.back())(random);
+  size_t rank = std::upper_bound(popularity_.begin(), popularity_.end(), point)
+    - popularity_.begin();
+
+  return std::min(rank, popularity_.size() - 1);
+}
+
+/* Moves the same way reads of the model do, and to a random place when
+ * a move would leave the file */
+long TraceGenerator::pickOffset(Thread &thread, long length)
+{
+  const double* moves = model_.moves[thread.kind][thread.move];
+  double total = 0;
+  for (int m = 0; m < TraceModel::NUM_MOVES; ++m) total += moves[m];
+
+  // a move never seen after the last one is drawn as the first read
+  if (total <= 0) {
+    moves = model_.moves[thread.kind][TraceModel::NUM_MOVES];
+    for (int m = 0; m < TraceModel::NUM_MOVES; ++m) total += moves[m];
+  }
+
+  double point = total > 0 ? 
+    std::uniform_real_distribution<double>(0, total)(thread.random) : 0;
+  long offset = -1;
+  int move = total > 0 ? 0 : TraceModel::RANDOM;
+
+  while (move < TraceModel::NUM_MOVES - 1 && point >= moves[move]) {
+    point -= moves[move++];
+  }
+
+  switch (move) {
+    case TraceModel::SEQUENTIAL:
+      offset = thread.next;
+      break;
+    case TraceModel::STRIDED:
+      if (thread.move != TraceModel::STRIDED && !model_.strides.empty()) {
+        offset = thread.last + model_.strides.draw(thread.random);
+      } else if (thread.count > 1 && thread.stride != 0) {
+        offset = thread.last + thread.stride;
+      }
+      break;
+    case TraceModel::REREAD:
+      if (thread.count > 0) {
+        offset = thread.recent[thread.random() % 
+          std::min(thread.count, (long)RECENT_READS)][0];
+      }
+      break;
+    default:
+      break;
+  }
+
+  if (offset < 0 || offset + length > thread.size) {
+    move = TraceModel::RANDOM;
+    long places = std::max(thread.size - length, 0L) / ALIGNMENT + 1;
+    offset = (long)(thread.random() % (unsigned long)places) * ALIGNMENT;
+  }
+  thread.move = move;
+
+  return offset;
+}
@@ -0,0 +1,103 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// TraceGenerator writes a synthetic log drawn from a TraceModel. Every
+// synthetic thread opens files picked by popularity, reads them with
+// the moves, sizes and latencies of the model and closes them, waiting
+// a think time between calls, until it has written its share of
+// records. Each thread draws from its own generator seeded from the
+// seed and its index, so a seed always gives the same log, whatever
+// the number of workers.
+// Threads are shared among workers, which run them one time step at a
+// time; records of a step are then merged in time order and written.
+
+#ifndef LIBHDFSPP_TRACEGENERATOR_H_
+#define LIBHDFSPP_TRACEGENERATOR_H_
+
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Logger.h"
+#include "TraceModel.h"
+
+namespace hdfs
+{
+
+class TraceGenerator
+{
+ public:
+  TraceGenerator(const TraceModel &model, unsigned long seed, 
+      const std::string &prefix, double think_scale);
+  virtual ~TraceGenerator();
+
+  bool generate(Logger &out, long records, unsigned workers);
+  long written() const;
+  long duration() const;      //ns between first and last record
+
+ private:
+  struct Record {
+    long time;
+    long thread;
+    long seq;
+    std::string data;
+  };
+
+  struct Thread {
+    long id;
+    long index;
+    std::mt19937_64 random;
+    long time;                //when the next call is made
+    long budget;              //records left to write
+    long records;             //written so far, orders records of a time
+    bool done;
+    std::deque<Record> pending;
+
+    long handle;              //of the open file, or 0
+    int kind;                 //most common move of the open file
+    long opens;
+    long size;                //of the open file
+    long reads;               //left before close
+    long count;               //reads of the open file so far
+    long next;
+    long last;
+    long stride;
+    int move;                 //of the last read
+    long recent[16][2];
+  };
+
+  void step(Thread &thread);
+  void emit(Thread &thread, hadoop::hdfs::log &msg, long time);
+  long pickFile(std::mt19937_64 &random) const;
+  long pickOffset(Thread &thread, long length);
+
+  const TraceModel &model_;
+  unsigned long seed_;
+  std::string prefix_;
+  double think_scale_;
+  std::vector<double> popularity_;    //cumulative, by rank
+  std::vector<double> kinds_;         //cumulative, by most common move
+  std::vector<long> file_sizes_;      //by rank
+  long written_;
+  long end_;
+};
+
+} /* hdfs */ 
+
+#endif
@@ -0,0 +1,524 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+
+#include "LogReader.h"
+#include "TraceModel.h"
+
+#define MODEL_MAGIC "libhdfspp-trace-model"
+#define MODEL_VERSION 1
+#define MAX_SIZES 256         //exact sizes kept, later ones are rounded
+#define RECENT_READS 16       //reads looked at for re-reads
+#define ZIPF_RANKS 10000      //most popular files fitted
+
+using namespace hdfs;
+
+static long powerOfTwo(long value)
+{
+  long power = 1;
+  while (power <= value / 2) power *= 2;
+  return power;
+}
+
+/* Once sizes are many, later ones are rounded into few */
+static void addSize(TraceModel::Distribution &sizes, long size)
+{
+  if (sizes.size() >= MAX_SIZES && !sizes.contains(size)) {
+    size = size > 0 ? powerOfTwo(size) : (size < 0 ? -powerOfTwo(-size) : 0);
+  }
+  sizes.add(size, 1);
+}
+
+TraceModel::Distribution::Distribution(bool exact)
+  : exact_(exact)
+{
+}
+
+void TraceModel::Distribution::add(long value, double weight)
+{
+  if (!exact_) {
+    value = value > 0 ? powerOfTwo(value) : 0;
+  }
+  weights_[value] += weight;
+}
+
+void TraceModel::Distribution::prepare()
+{
+  double total = 0;
+
+  values_.clear();
+  cumulative_.clear();
+  for (auto &weight : weights_) {
+    total += weight.second;
+    values_.push_back(weight.first);
+    cumulative_.push_back(total);
+  }
+}
+
+/* Values of log2 distributions are drawn uniformly from [value, 2 * value) */
+long TraceModel::Distribution::draw(std::mt19937_64 &random) const
+{
+  if (values_.empty()) {
+    return 0;
+  }
+
+  double point = std::uniform_real_distribution<double>(0, 
+      cumulative_.back())(random);
+  size_t i = std::upper_bound(cumulative_.begin(), cumulative_.end(), point) 
+    - cumulative_.begin();
+  long value = values_[std::min(i, values_.size() - 1)];
+
+  if (exact_ || value < 2) {
+    return value;
+  }
+  return value + (long)(random() % (unsigned long)value);
+}
+
+bool TraceModel::Distribution::empty() const
+{
+  return weights_.empty();
+}
+
+size_t TraceModel::Distribution::size() const
+{
+  return weights_.size();
+}
+
+bool TraceModel::Distribution::contains(long value) const
+{
+  return weights_.count(value) > 0;
+}
+
+double TraceModel::Distribution::mean() const
+{
+  double sum = 0, total = 0;
+
+  for (auto &weight : weights_) {
+    double value = exact_ || weight.first < 2 ? weight.first : 
+      weight.first * 1.5 - 0.5;
+    sum += value * weight.second;
+    total += weight.second;
+  }
+
+  return total > 0 ? sum / total : 0;
+}
+
+void TraceModel::Distribution::save(std::ostream &out) const
+{
+  out << (exact_ ? "exact" : "log2") << " " << weights_.size();
+  for (auto &weight : weights_) {
+    out << " " << weight.first << " " << weight.second;
+  }
+  out << "\n";
+}
+
+bool TraceModel::Distribution::load(std::istream &in)
+{
+  std::string kind;
+  size_t count;
+  long value;
+  double weight;
+
+  if (!(in >> kind >> count) || (kind != "exact" && kind != "log2")) {
+    return false;
+  }
+
+  exact_ = kind == "exact";
+  weights_.clear();
+  for (size_t i = 0; i < count; ++i) {
+    if (!(in >> value >> weight) || weight < 0) return false;
+    weights_[value] += weight;
+  }
+  prepare();
+
+  return true;
+}
+
+TraceModel::TraceModel()
+  : start_date(0)
+  , start_time(0)
+  , threads(0)
+  , files(0)
+  , zipf(0)
+  , open_args()
+  , streams()
+  , moves()
+  , file_sizes(true)
+  , reads(false)
+  , sizes(true)
+  , strides(true)
+  , think(false)
+  , latency{Distribution(false), Distribution(false), Distribution(false)}
+{
+}
+
+TraceModel::~TraceModel()
+{
+}
+
+bool TraceModel::fit(const char* logPath)
+{
+  struct Thread {
+    long call;          //time of the call in flight, or -1
+    int kind;           //of the call in flight
+    long ret;           //time of the last return, or -1
+    std::string path;   //of the open in flight
+  };
+  struct Stream {
+    std::string path;
+    long reads;
+    long next;          //byte after the last read
+    long last;          //offset of the last read
+    long stride;        //offset moved by the last read
+    int move;           //of the last read, NUM_MOVES before any
+    double moves[NUM_MOVES + 1][NUM_MOVES];
+    long recent[RECENT_READS][2];
+  };
+  struct File {
+    long opens;
+    long end;           //furthest byte read
+  };
+
+  LogReader reader(logPath);
+  std::unordered_map<long, Thread> thread_state;
+  std::unordered_map<long, Stream> open_streams;
+  std::unordered_map<std::string, File> file_state;
+  TraceClock clock;
+  std::unique_ptr<hadoop::hdfs::log> msg;
+
+  auto close = [this, &file_state](const Stream &stream) {
+    double counts[NUM_MOVES] = {};
+    int kind = SEQUENTIAL;
+
+    for (int from = 0; from <= NUM_MOVES; ++from) {
+      for (int m = 0; m < NUM_MOVES; ++m) counts[m] += stream.moves[from][m];
+    }
+    for (int m = 0; m < NUM_MOVES; ++m) {
+      if (counts[m] > counts[kind]) kind = m;
+    }
+    for (int from = 0; from <= NUM_MOVES; ++from) {
+      for (int m = 0; m < NUM_MOVES; ++m) {
+        moves[kind][from][m] += stream.moves[from][m];
+      }
+    }
+    streams[kind]++;
+
+    reads.add(stream.reads, 1);
+    File &file = file_state[stream.path];
+    file.end = std::max(file.end, stream.next);
+  };
+
+  while ((msg = reader.next()) != nullptr) {
+    long time = clock.since(*msg);
+    auto found = thread_state.find(msg->threadid());
+    if (found == thread_state.end()) {
+      found = thread_state.insert(std::make_pair(msg->threadid(), 
+            Thread{-1, 0, -1, ""})).first;
+    }
+    Thread &thread = found->second;
+
+    switch (msg->type()) {
+      case hadoop::hdfs::log_FuncType_OPEN:
+      case hadoop::hdfs::log_FuncType_READ:
+      case hadoop::hdfs::log_FuncType_CLOSE:
+        if (thread.ret >= 0) think.add(time - thread.ret, 1);
+        thread.call = time;
+        thread.kind = (int)msg->type() / 2;
+        break;
+      case hadoop::hdfs::log_FuncType_OPEN_RET:
+      case hadoop::hdfs::log_FuncType_READ_RET:
+      case hadoop::hdfs::log_FuncType_CLOSE_RET:
+        if (thread.call >= 0 && thread.kind == (int)msg->type() / 2) {
+          latency[thread.kind].add(time - thread.call, 1);
+        }
+        thread.call = -1;
+        thread.ret = time;
+        break;
+      default:
+        break;    //calls not modelled count as thinking
+    }
+
+    switch (msg->type()) {
+      case hadoop::hdfs::log_FuncType_OPEN:
+        if (open_args[0] == 0 && msg->argument_size() >= 5) {
+          for (int i = 0; i < 5; ++i) open_args[i] = msg->argument(i);
+        }
+        thread.path = msg->path();
+        break;
+      case hadoop::hdfs::log_FuncType_OPEN_RET: {
+        if (msg->argument_size() < 1) break;
+
+        auto old = open_streams.find(msg->argument(0));
+        if (old != open_streams.end()) close(old->second);
+
+        Stream &stream = open_streams[msg->argument(0)];
+        stream = Stream();
+        stream.path = thread.path;
+        stream.move = NUM_MOVES;
+        file_state[thread.path].opens++;
+        break;
+      }
+      case hadoop::hdfs::log_FuncType_READ: {
+        if (msg->argument_size() < 5) break;
+
+        // reads of files opened before the log started are kept out
+        auto found = open_streams.find(msg->argument(1));
+        if (found == open_streams.end()) break;
+
+        Stream &stream = found->second;
+        long offset = msg->argument(2);
+        long length = msg->argument(4);
+        Move move = RANDOM;
+
+        if (offset == stream.next) {
+          move = SEQUENTIAL;
+        } else if (stream.reads > 1 && stream.stride != 0 
+            && offset == stream.last + stream.stride) {
+          move = STRIDED;
+        } else {
+          for (long i = 0; i < std::min(stream.reads, (long)RECENT_READS); ++i) {
+            if (offset >= stream.recent[i][0] 
+                && offset < stream.recent[i][0] + stream.recent[i][1]) {
+              move = REREAD;
+              break;
+            }
+          }
+        }
+        if (move == STRIDED && stream.move != STRIDED) {
+          addSize(strides, stream.stride);
+        }
+        stream.moves[stream.move][move]++;
+        stream.move = move;
+
+        addSize(sizes, length);
+        stream.recent[stream.reads % RECENT_READS][0] = offset;
+        stream.recent[stream.reads % RECENT_READS][1] = length;
+        stream.stride = offset - stream.last;
+        stream.last = offset;
+        stream.next = offset + std::max(length, 0L);
+        stream.reads++;
+        break;
+      }
+      case hadoop::hdfs::log_FuncType_CLOSE: {
+        if (msg->argument_size() < 2) break;
+
+        auto found = open_streams.find(msg->argument(1));
+        if (found != open_streams.end()) {
+          close(found->second);
+          open_streams.erase(found);
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  bool ok = reader.isEOF();
+  reader.close();
+  start_date = clock.startDate();
+  start_time = clock.startTime();
+
+  for (auto &stream : open_streams) {
+    close(stream.second);
+  }
+  threads = thread_state.size();
+
+  // Zipf exponent is the slope of log opens against log rank
+  std::vector<long> opens;
+  for (auto &file : file_state) {
+    if (file.second.end > 0) addSize(file_sizes, file.second.end);
+    if (file.second.opens > 0) opens.push_back(file.second.opens);
+  }
+  std::sort(opens.begin(), opens.end(), std::greater<long>());
+  files = opens.size();
+
+  double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+  for (size_t rank = 0; rank < opens.size() && rank < ZIPF_RANKS; ++rank) {
+    double x = std::log(rank + 1.0), y = std::log((double)opens[rank]);
+    n++;
+    sx += x;
+    sy += y;
+    sxx += x * x;
+    sxy += x * y;
+  }
+  zipf = n > 1 && n * sxx - sx * sx > 0 ? 
+    std::max(0.0, -(n * sxy - sx * sy) / (n * sxx - sx * sx)) : 0;
+
+  prepare();
+  return ok;
+}
+
+bool TraceModel::save(const std::string &path) const
+{
+  std::ofstream out(path.c_str());
+  const char* latencies[] = {"open_latency", "close_latency", "read_latency"};
+
+  out.precision(17);
+  out << MODEL_MAGIC << " " << MODEL_VERSION << "\n";
+  out << "start " << start_date << " " << start_time << "\n";
+  out << "threads " << threads << "\n";
+  out << "files " << files << " " << zipf << "\n";
+  out << "open";
+  for (int i = 0; i < 5; ++i) out << " " << open_args[i];
+  out << "\nstreams";
+  for (int kind = 0; kind < NUM_MOVES; ++kind) out << " " << streams[kind];
+  for (int kind = 0; kind < NUM_MOVES; ++kind) {
+    out << "\nmoves " << kind;
+    for (int from = 0; from <= NUM_MOVES; ++from) {
+      for (int m = 0; m < NUM_MOVES; ++m) out << " " << moves[kind][from][m];
+    }
+  }
+  out << "\nfile_sizes ";
+  file_sizes.save(out);
+  out << "reads ";
+  reads.save(out);
+  out << "sizes ";
+  sizes.save(out);
+  out << "strides ";
+  strides.save(out);
+  out << "think ";
+  think.save(out);
+  for (int i = 0; i < 3; ++i) {
+    out << latencies[i] << " ";
+    latency[i].save(out);
+  }
+  out.close();
+
+  return !out.fail();
+}
+
+bool TraceModel::load(const std::string &path)
+{
+  std::ifstream in(path.c_str());
+  std::string magic, key;
+  int version;
+
+  if (!(in >> magic >> version) || magic != MODEL_MAGIC 
+      || version != MODEL_VERSION) {
+    return false;
+  }
+
+  // Keys may come in any order, which lets a model be edited by hand
+  while (in >> key) {
+    bool ok = true;
+
+    if (key == "start") {
+      ok = (bool)(in >> start_date >> start_time);
+    } else if (key == "threads") {
+      ok = (bool)(in >> threads) && threads > 0;
+    } else if (key == "files") {
+      ok = (bool)(in >> files >> zipf) && files >= 0 && zipf >= 0;
+    } else if (key == "open") {
+      for (int i = 0; i < 5 && ok; ++i) ok = (bool)(in >> open_args[i]);
+    } else if (key == "streams") {
+      for (int kind = 0; kind < NUM_MOVES && ok; ++kind) {
+        ok = (bool)(in >> streams[kind]) && streams[kind] >= 0;
+      }
+    } else if (key == "moves") {
+      int kind = -1;
+      ok = (bool)(in >> kind) && kind >= 0 && kind < NUM_MOVES;
+      for (int from = 0; from <= NUM_MOVES && ok; ++from) {
+        for (int m = 0; m < NUM_MOVES && ok; ++m) {
+          ok = (bool)(in >> moves[kind][from][m]) && moves[kind][from][m] >= 0;
+        }
+      }
+    } else if (key == "file_sizes") {
+      ok = file_sizes.load(in);
+    } else if (key == "reads") {
+      ok = reads.load(in);
+    } else if (key == "sizes") {
+      ok = sizes.load(in);
+    } else if (key == "strides") {
+      ok = strides.load(in);
+    } else if (key == "think") {
+      ok = think.load(in);
+    } else if (key == "open_latency") {
+      ok = latency[0].load(in);
+    } else if (key == "close_latency") {
+      ok = latency[1].load(in);
+    } else if (key == "read_latency") {
+      ok = latency[2].load(in);
+    } else {
+      ok = false;
+    }
+
+    if (!ok) {
+      std::cerr << "Bad " << key << " in model " << path << std::endl;
+      return false;
+    }
+  }
+
+  prepare();
+  return threads > 0;
+}
+
+void TraceModel::print(std::ostream &out) const
+{
+  const char* names[] = {"sequential", "strided", "re-read", "random"};
+
+  out << "Model of " << threads << " threads reading " << files;
+  out << " files, popularity Zipf " << zipf << "." << std::endl;
+  out << "  mean reads per open: " << reads.mean() << std::endl;
+  out << "  mean request size (bytes): " << sizes.mean() << std::endl;
+  out << "  mean file size (MB): " << file_sizes.mean() / 1024 / 1024;
+  out << std::endl;
+  out << "  mean think time (us): " << think.mean() / 1000 << std::endl;
+  out << "  mean latency (us) open: " << latency[0].mean() / 1000;
+  out << " close: " << latency[1].mean() / 1000;
+  out << " read: " << latency[2].mean() / 1000 << std::endl;
+  double counts[NUM_MOVES] = {}, total = 0, opens = 0;
+  for (int kind = 0; kind < NUM_MOVES; ++kind) {
+    opens += streams[kind];
+    for (int from = 0; from <= NUM_MOVES; ++from) {
+      for (int m = 0; m < NUM_MOVES; ++m) {
+        counts[m] += moves[kind][from][m];
+        total += moves[kind][from][m];
+      }
+    }
+  }
+  out << "  moves between reads:";
+  for (int m = 0; m < NUM_MOVES; ++m) {
+    out << " " << names[m] << " " << (total > 0 ? counts[m] * 100 / total : 0);
+    out << "%";
+  }
+  out << std::endl;
+  out << "  opens by most common move:";
+  for (int kind = 0; kind < NUM_MOVES; ++kind) {
+    out << " " << names[kind] << " " << (opens > 0 ? streams[kind] * 100 / opens : 0);
+    out << "%";
+  }
+  out << std::endl;
+}
+
+void TraceModel::prepare()
+{
+  file_sizes.prepare();
+  reads.prepare();
+  sizes.prepare();
+  strides.prepare();
+  think.prepare();
+  for (int i = 0; i < 3; ++i) {
+    latency[i].prepare();
+  }
+}
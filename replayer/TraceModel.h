@@ -0,0 +1,117 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// TraceModel is a compact statistical model of a log, fitted in one
+// pass over it, from which TraceGenerator makes synthetic logs of any
+// size. It keeps:
+//  - how many threads make calls, and how long they wait between calls
+//  - how many files there are and how popular they are, as the
+//    exponent of a Zipf distribution fitted to opens per file
+//  - sizes of files, as the furthest byte read of every file, exactly
+//    for the most common ones
+//  - how many reads a file gets between open and close
+//  - how a read moves from the last read of the same file: on to the
+//    next byte, by the same stride again, back to a recent read, or to
+//    a random place. Moves are counted after every kind of move, so
+//    runs of one kind are kept, and apart for files read mostly by one
+//    kind of move, so a file read in strides is not mixed up with one
+//    read at random. Strides themselves are kept as they start.
+//  - request sizes, exactly for the most common ones
+//  - latency of every kind of call
+// Models are saved as text, so one can be fitted once and reviewed,
+// edited or used many times.
+
+#ifndef LIBHDFSPP_TRACEMODEL_H_
+#define LIBHDFSPP_TRACEMODEL_H_
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+
+namespace hdfs
+{
+
+class TraceModel
+{
+ public:
+  typedef enum {
+    SEQUENTIAL,
+    STRIDED,
+    REREAD,
+    RANDOM,
+    NUM_MOVES
+  } Move;
+
+  // Weighted values to draw from. Exact distributions keep every value
+  // added, others keep powers of two and draw uniformly in between.
+  class Distribution
+  {
+   public:
+    Distribution(bool exact);
+
+    void add(long value, double weight);
+    void prepare();     //after adding, before drawing
+    long draw(std::mt19937_64 &random) const;
+    bool empty() const;
+    size_t size() const;              //of distinct values
+    bool contains(long value) const;
+    double mean() const;
+
+    void save(std::ostream &out) const;
+    bool load(std::istream &in);
+
+   private:
+    bool exact_;
+    std::map<long, double> weights_;
+    std::vector<long> values_;
+    std::vector<double> cumulative_;
+  };
+
+  TraceModel();
+  virtual ~TraceModel();
+
+  bool fit(const char* logPath);
+  bool save(const std::string &path) const;
+  bool load(const std::string &path);
+  void print(std::ostream &out) const;
+
+  int start_date;
+  long start_time;
+  long threads;
+  long files;
+  double zipf;              //exponent of file popularity
+  long open_args[5];        //fs, flags, buffer size, replication, block size
+  double streams[NUM_MOVES];                 //opens by their most common move
+  double moves[NUM_MOVES][NUM_MOVES + 1][NUM_MOVES];  //after every move, open
+  Distribution file_sizes;
+  Distribution reads;       //per open file
+  Distribution sizes;       //of requests
+  Distribution strides;
+  Distribution think;       //ns between return and next call
+  Distribution latency[3];  //of open, close and read
+
+ private:
+  void prepare();
+};
+
+} /* hdfs */ 
+
+#endif
@@ -0,0 +1,304 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <functional>
+
+#include "TraceSimulator.h"
+
+using namespace hdfs;
+
+TraceSimulator::TraceSimulator(StorageModel &storage)
+  : storage_(storage)
+  , clock_()
+  , decoded_(0)
+  , end_(0)
+  , calls_(0)
+  , records_(0)
+{
+}
+
+TraceSimulator::~TraceSimulator()
+{
+}
+
+bool TraceSimulator::Event::operator>(const Event &other) const
+{
+  return time != other.time ? time > other.time : thread > other.thread;
+}
+
+/* Read on while a call not read yet could come before the next event */
+bool TraceSimulator::run(const char* logPath)
+{
+  if (!reader_.setPath(logPath)) {
+    return false;
+  }
+
+  bool more = true;
+  while (true) {
+    while (more && (events_.empty() || mayPrecede(events_.top().time))) {
+      more = decode();
+    }
+    if (events_.empty()) break;
+
+    Event event = events_.top();
+    events_.pop();
+    serve(event);
+  }
+
+  bool ok = reader_.isEOF();
+  reader_.close();
+  return ok;
+}
+
+void TraceSimulator::print(std::ostream &out) const
+{
+  auto us = [](long ns) { return ns / 1000.0; };
+
+  out << "Simulated " << calls_ << " calls of " << threads_.size();
+  out << " threads, done after " << end_ / 1e9 << " seconds (trace: ";
+  out << decoded_ / 1e9 << " seconds)." << std::endl;
+
+  out << "Latency (us), simulated / recorded in trace:" << std::endl;
+  out << "  op\tcount\t\tp50\t\tp90\t\tp99\t\tp999\t\tKS distance" << std::endl;
+  for (int op = 0; op < TraceStats::NUM_OPS; ++op) {
+    const Histogram &simulated = latency_[op];
+    const Histogram &recorded = recorded_[op];
+    if (simulated.count() == 0) continue;
+
+    out << "  " << TraceStats::opName((TraceStats::OpType)op) << "\t";
+    out << simulated.count() << " / " << recorded.count();
+    for (double p : {50.0, 90.0, 99.0, 99.9}) {
+      out << "\t" << us(simulated.percentile(p)) << " / ";
+      out << us(recorded.percentile(p));
+    }
+    out << "\t" << simulated.distance(recorded) << std::endl;
+  }
+
+  storage_.print(out, end_);
+}
+
+uint64_t TraceSimulator::calls() const
+{
+  return calls_;
+}
+
+long TraceSimulator::end() const
+{
+  return end_;
+}
+
+const Histogram &TraceSimulator::latency(TraceStats::OpType op) const
+{
+  return latency_[op];
+}
+
+bool TraceSimulator::decode()
+{
+  // one message is parsed into again and again, saving allocations
+  if (!reader_.nextRaw(record_) || !msg_.ParseFromString(record_)) {
+    return false;
+  }
+  const hadoop::hdfs::log* msg = &msg_;
+
+  records_++;
+  long time = clock_.since(*msg);
+  decoded_ = std::max(decoded_, time);
+
+  auto found = thread_index_.find(msg->threadid());
+  if (found == thread_index_.end()) {
+    found = thread_index_.insert(std::make_pair(msg->threadid(), 
+          threads_.size())).first;
+    threads_.push_back(Thread{std::deque<Call>(), 0, 0, false, nullptr, 
+        leads_.end(), -1, 0});
+    rest(threads_.back());
+  }
+  size_t index = found->second;
+  Thread &thread = threads_[index];
+  Call call = {TraceStats::OPEN, 0, 0, 0, std::max(time - thread.ret, 0L)};
+
+  switch (msg->type()) {
+    case hadoop::hdfs::log_FuncType_OPEN:
+      call.file = std::hash<std::string>()(msg->path());
+      opening_[msg->threadid()] = call.file;
+      break;
+    case hadoop::hdfs::log_FuncType_READ: {
+      if (msg->argument_size() < 5) return true;
+
+      // files opened before the log started are told apart by handle
+      auto file = files_.find(msg->argument(1));
+      call.file = file != files_.end() ? file->second : msg->argument(1);
+      call.op = TraceStats::READ;
+      call.offset = msg->argument(2);
+      call.length = msg->argument(4);
+      break;
+    }
+    case hadoop::hdfs::log_FuncType_CLOSE:
+      if (msg->argument_size() >= 2) {
+        files_.erase(msg->argument(1));
+        positions_.erase(msg->argument(1));
+      }
+      call.op = TraceStats::CLOSE;
+      break;
+    case hadoop::hdfs::log_FuncType_WRITE:
+    case hadoop::hdfs::log_FuncType_FLUSH:
+    case hadoop::hdfs::log_FuncType_HSYNC:
+    case hadoop::hdfs::log_FuncType_SEEK: {
+      if (msg->argument_size() < 2) return true;
+
+      bool is_call;
+      auto file = files_.find(msg->argument(1));
+      call.file = file != files_.end() ? file->second : msg->argument(1);
+      call.op = TraceStats::opOf(msg->type(), is_call);
+
+      // writes go where the stream is, which seeks move and writes
+      // advance; a flush or hsync is on the block being written
+      long &position = positions_[msg->argument(1)];
+      if (call.op == TraceStats::SEEK && msg->argument_size() >= 3) {
+        position = msg->argument(2);
+      }
+      call.offset = position;
+      if (call.op == TraceStats::WRITE && msg->argument_size() >= 4) {
+        call.length = msg->argument(3);
+        position += call.length;
+      }
+      break;
+    }
+    case hadoop::hdfs::log_FuncType_GETFILEINFO:
+    case hadoop::hdfs::log_FuncType_LISTDIR: {
+      bool is_call;
+      call.file = std::hash<std::string>()(msg->path());
+      call.op = TraceStats::opOf(msg->type(), is_call);
+      break;
+    }
+    default: {
+      if (msg->type() == hadoop::hdfs::log_FuncType_OPEN_RET) {
+        auto file = opening_.find(msg->threadid());
+        if (file != opening_.end()) {
+          if (msg->argument_size() >= 1) {
+            files_[msg->argument(0)] = file->second;
+          }
+          opening_.erase(file);
+        }
+      }
+
+      bool is_call;
+      int op = TraceStats::opOf(msg->type(), is_call);
+      if (op < 0 || is_call) return true;   //not known to the simulator
+      if (thread.pending == op) {
+        recorded_[op].record(time - thread.call);
+      }
+      thread.pending = -1;
+      thread.ret = time;
+      if (thread.idle) {
+        wake(thread);
+        rest(thread);
+      }
+      return true;
+    }
+  }
+
+  thread.pending = call.op;
+  thread.call = time;
+  queue(thread, index, call);
+
+  return true;
+}
+
+void TraceSimulator::queue(Thread &thread, size_t index, const Call &call)
+{
+  thread.calls.push_back(call);
+  if (thread.idle) {
+    wake(thread);
+    events_.push(Event{thread.done + call.think, index});
+  }
+}
+
+/* Whether a call not read yet may be sent before the given time. A
+ * thread without calls sends its next one after the trace time read so
+ * far, plus its lead over the trace; a new thread has no lead. A thread
+ * whose last call has not returned in trace yet may send right after
+ * it is done. */
+bool TraceSimulator::mayPrecede(long time) const
+{
+  long lead = leads_.empty() ? 0 : std::min(0L, *leads_.begin());
+  return decoded_ + lead <= time || (!waits_.empty() && *waits_.begin() <= time);
+}
+
+void TraceSimulator::rest(Thread &thread)
+{
+  thread.idle = true;
+  if (thread.pending >= 0) {
+    thread.bounds = &waits_;
+    thread.bound = waits_.insert(thread.done);
+  } else {
+    thread.bounds = &leads_;
+    thread.bound = leads_.insert(thread.done - thread.ret);
+  }
+}
+
+void TraceSimulator::wake(Thread &thread)
+{
+  thread.idle = false;
+  thread.bounds->erase(thread.bound);
+}
+
+/* Sends the next call of a thread to storage, and queues the one after */
+void TraceSimulator::serve(const Event &event)
+{
+  Thread &thread = threads_[event.thread];
+  Call call = thread.calls.front();
+  thread.calls.pop_front();
+
+  long done;
+  switch (call.op) {
+    case TraceStats::OPEN:
+      done = storage_.open(event.time);
+      break;
+    case TraceStats::READ:
+      done = storage_.read(event.time, call.file, call.offset, call.length);
+      break;
+    case TraceStats::WRITE:
+    case TraceStats::FLUSH:
+    case TraceStats::HSYNC:
+      // data and acks pass the pipeline of every replica
+      done = storage_.write(event.time, call.file, call.offset, call.length);
+      break;
+    case TraceStats::SEEK:
+      done = event.time;    //the client only moves its position
+      break;
+    case TraceStats::GETFILEINFO:
+    case TraceStats::LISTDIR:
+      done = storage_.open(event.time);
+      break;
+    default:
+      done = storage_.close(event.time);
+      break;
+  }
+
+  latency_[call.op].record(done - event.time);
+  thread.done = done;
+  end_ = std::max(end_, done);
+  calls_++;
+
+  if (!thread.calls.empty()) {
+    events_.push(Event{done + thread.calls.front().think, event.thread});
+  } else {
+    rest(thread);
+  }
+}
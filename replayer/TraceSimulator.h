@@ -0,0 +1,129 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// TraceSimulator replays a log in simulated time against a
+// StorageModel, so hours of trace take seconds and need no cluster.
+// It is a discrete-event engine whose only events are traced threads
+// sending their next call: a thread sends a call once its last call is
+// done in simulation and it has thought as long as it did in the trace
+// between the return of that call and the next one. A thread thus
+// keeps the order of its calls and waits for them as it did when
+// traced, and a slower store delays its later calls. A thread first
+// calls at the time it did in the trace.
+// The log is read only as far as the events need: as long as a thread
+// may still send a call before the earliest event, given how far ahead
+// of the trace it is in simulation. Memory therefore grows with how far
+// simulation drifts from the trace rather than with the log.
+// Latency the trace recorded from every call to its return is kept
+// too, to compare the prediction with.
+// Writes, flushes and hsyncs go down the pipeline of all replicas of
+// the file and are done with the slowest, at the position of the
+// stream, which writes advance and seeks move; metadata calls go to the
+// NameNode like opens, and seeks cost nothing.
+
+#ifndef LIBHDFSPP_TRACESIMULATOR_H_
+#define LIBHDFSPP_TRACESIMULATOR_H_
+
+#include <set>
+#include <string>
+#include <deque>
+#include <queue>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+
+#include "Histogram.h"
+#include "LogReader.h"
+#include "StorageModel.h"
+#include "TraceStats.h"
+
+namespace hdfs
+{
+
+class TraceSimulator
+{
+ public:
+  TraceSimulator(StorageModel &storage);
+  virtual ~TraceSimulator();
+
+  bool run(const char* logPath);
+  void print(std::ostream &out) const;
+
+  uint64_t calls() const;
+  long end() const;                 //ns of simulated time
+  const Histogram &latency(TraceStats::OpType op) const;
+
+ private:
+  struct Call {
+    int op;
+    uint64_t file;
+    long offset;
+    long length;
+    long think;       //ns since the return of the last call
+  };
+
+  struct Thread {
+    std::deque<Call> calls;
+    long ret;         //trace time of the last return
+    long done;        //simulated time the last call was done
+    bool idle;        //done with calls read so far
+    std::multiset<long>* bounds;          //leads_ or waits_ while idle
+    std::multiset<long>::iterator bound;
+    int pending;      //op of the call waiting for return, or -1
+    long call;        //its trace time
+  };
+
+  struct Event {
+    long time;
+    size_t thread;
+
+    bool operator>(const Event &other) const;
+  };
+
+  bool decode();
+  bool mayPrecede(long time) const;
+  void rest(Thread &thread);
+  void wake(Thread &thread);
+  void queue(Thread &thread, size_t index, const Call &call);
+  void serve(const Event &event);
+
+  StorageModel &storage_;
+  LogReader reader_;
+  std::string record_;
+  hadoop::hdfs::log msg_;
+  TraceClock clock_;
+  long decoded_;        //latest trace time read
+  long end_;
+  uint64_t calls_;
+  uint64_t records_;
+  std::vector<Thread> threads_;
+  std::unordered_map<long, size_t> thread_index_;
+  std::unordered_map<long, uint64_t> files_;    //by handle
+  std::unordered_map<long, uint64_t> opening_;  //by thread
+  std::unordered_map<long, long> positions_;    //of streams, by handle
+  std::multiset<long> leads_;     //of idle threads over the trace
+  std::multiset<long> waits_;     //done of idle threads not returned in trace
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+  Histogram latency_[TraceStats::NUM_OPS];
+  Histogram recorded_[TraceStats::NUM_OPS];
+};
+
+} /* hdfs */ 
+
+#endif
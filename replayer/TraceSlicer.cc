@@ -0,0 +1,227 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogReader.h"
+#include "TraceSlicer.h"
+
+using namespace hdfs;
+
+TraceSlicer::TraceSlicer(const Filter &filter, const TraceClock &clock, 
+    Logger &out)
+  : filter_(filter)
+  , clock_(clock)
+  , out_(out)
+  , last_date_(clock.startDate())
+  , last_time_(clock.startTime())
+  , kept_(0)
+  , orphans_(0)
+{
+}
+
+TraceSlicer::~TraceSlicer()
+{
+}
+
+/* Returns false once the record is past the end of the window, which
+ * is where the slice ends for an ordered log. */
+bool TraceSlicer::add(const hadoop::hdfs::log &msg, const std::string &record)
+{
+  long time = clock_.since(msg);
+  if (filter_.to >= 0 && time > filter_.to) {
+    return false;
+  }
+
+  bool in_window = time >= filter_.from;
+  long thread = msg.threadid();
+  last_date_ = msg.date();
+  last_time_ = msg.time();
+
+  switch (msg.type()) {
+    case hadoop::hdfs::log_FuncType_OPEN: {
+      File &file = opening_[thread];
+      file = File();
+      file.open = record;
+      file.path = msg.path();
+      file.fs = msg.argument_size() > 0 ? msg.argument(0) : 0;
+      file.thread = thread;
+      file.kept = false;
+
+      if (in_window && filter_.opens && wanted(file.path, thread)) {
+        write(record);
+        file.kept = true;
+      }
+      break;
+    }
+    case hadoop::hdfs::log_FuncType_OPEN_RET: {
+      auto opening = opening_.find(thread);
+      if (opening == opening_.end() || msg.argument_size() < 1) break;
+
+      File &file = files_[msg.argument(0)];
+      file = std::move(opening->second);
+      file.open_ret = record;
+      if (file.kept) write(record);
+      opening_.erase(opening);
+      break;
+    }
+    case hadoop::hdfs::log_FuncType_READ:
+    case hadoop::hdfs::log_FuncType_WRITE:
+    case hadoop::hdfs::log_FuncType_FLUSH:
+    case hadoop::hdfs::log_FuncType_HSYNC:
+    case hadoop::hdfs::log_FuncType_SEEK: {
+      bool read = msg.type() == hadoop::hdfs::log_FuncType_READ;
+      if (!in_window || !(read ? filter_.reads : filter_.writes) 
+          || msg.argument_size() < 2) break;
+
+      auto file = files_.find(msg.argument(1));
+      if (file == files_.end()) {
+        orphans_++;
+        break;
+      }
+      if (!wanted(file->second.path, thread)) break;
+
+      // a read or write made up at the end returns its length
+      long length = 0;
+      if (read && msg.argument_size() >= 5) length = msg.argument(4);
+      if (msg.type() == hadoop::hdfs::log_FuncType_WRITE 
+          && msg.argument_size() >= 4) length = msg.argument(3);
+
+      if (!file->second.kept) keepFile(file->second);
+      write(record);
+      calling_[thread] = Call{
+        (hadoop::hdfs::log_FuncType)(msg.type() + 1), length};
+      break;
+    }
+    case hadoop::hdfs::log_FuncType_GETFILEINFO:
+    case hadoop::hdfs::log_FuncType_LISTDIR:
+      if (!in_window || !filter_.metadata || !wanted(msg.path(), thread)) break;
+
+      write(record);
+      calling_[thread] = Call{(hadoop::hdfs::log_FuncType)(msg.type() + 1), 0};
+      break;
+    case hadoop::hdfs::log_FuncType_READ_RET:
+    case hadoop::hdfs::log_FuncType_WRITE_RET:
+    case hadoop::hdfs::log_FuncType_FLUSH_RET:
+    case hadoop::hdfs::log_FuncType_HSYNC_RET:
+    case hadoop::hdfs::log_FuncType_SEEK_RET:
+    case hadoop::hdfs::log_FuncType_GETFILEINFO_RET:
+    case hadoop::hdfs::log_FuncType_LISTDIR_RET:
+      if (calling_.erase(thread) > 0) write(record);
+      break;
+    case hadoop::hdfs::log_FuncType_CLOSE: {
+      if (msg.argument_size() < 2) break;
+
+      auto file = files_.find(msg.argument(1));
+      if (file == files_.end()) break;
+      if (file->second.kept) {
+        write(record);
+        closing_.insert(thread);
+      }
+      files_.erase(file);
+      break;
+    }
+    case hadoop::hdfs::log_FuncType_CLOSE_RET:
+      if (closing_.erase(thread) > 0) write(record);
+      break;
+    default:
+      break;
+  }
+
+  return true;
+}
+
+void TraceSlicer::finish()
+{
+  auto make = [this](hadoop::hdfs::log_FuncType type, long thread) {
+    hadoop::hdfs::log msg;
+    msg.set_date(last_date_);
+    msg.set_time(last_time_);
+    msg.set_threadid(thread);
+    msg.set_type(type);
+    return msg;
+  };
+
+  for (auto &call : calling_) {
+    auto msg = make(call.second.ret, call.first);
+    msg.add_argument(call.second.value);
+    out_.writeDelimitedLog(msg);
+    kept_++;
+  }
+  calling_.clear();
+
+  for (auto thread : closing_) {
+    auto msg = make(hadoop::hdfs::log_FuncType_CLOSE_RET, thread);
+    msg.add_argument(0);
+    out_.writeDelimitedLog(msg);
+    kept_++;
+  }
+  closing_.clear();
+
+  for (auto &file : files_) {
+    if (!file.second.kept) continue;
+
+    auto msg = make(hadoop::hdfs::log_FuncType_CLOSE, file.second.thread);
+    msg.add_argument(file.second.fs);
+    msg.add_argument(file.first);
+    out_.writeDelimitedLog(msg);
+
+    msg = make(hadoop::hdfs::log_FuncType_CLOSE_RET, file.second.thread);
+    msg.add_argument(0);
+    out_.writeDelimitedLog(msg);
+    kept_ += 2;
+  }
+  files_.clear();
+}
+
+long TraceSlicer::kept() const
+{
+  return kept_;
+}
+
+long TraceSlicer::orphans() const
+{
+  return orphans_;
+}
+
+bool TraceSlicer::wanted(const std::string &path, long thread) const
+{
+  if (!filter_.threads.empty() && filter_.threads.count(thread) == 0) {
+    return false;
+  }
+  if (filter_.prefixes.empty()) {
+    return true;
+  }
+
+  for (auto &prefix : filter_.prefixes) {
+    if (path.compare(0, prefix.size(), prefix) == 0) return true;
+  }
+  return false;
+}
+
+void TraceSlicer::write(const std::string &record)
+{
+  out_.writeDelimitedLog(record);
+  kept_++;
+}
+
+/* A file is kept from its first kept call on, which needs its open */
+void TraceSlicer::keepFile(File &file)
+{
+  write(file.open);
+  write(file.open_ret);
+  file.kept = true;
+}
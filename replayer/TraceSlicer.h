@@ -0,0 +1,103 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// TraceSlicer writes the part of a log that passes a filter on time,
+// path prefix, thread and type of call, and keeps the result a log
+// that can be replayed: a kept read, write, flush, hsync or seek brings
+// along the OPEN and OPEN_RET of its file, even when they are older
+// than the time window, and the CLOSE and CLOSE_RET of every file kept
+// are kept as well. Files still open when the window ends get a CLOSE
+// made up at that time, and calls still in flight a return, so the
+// slice does not leak handles.
+//
+// Records are written as they were read, without serializing them
+// again. Only files open at a time are remembered.
+
+#ifndef LIBHDFSPP_TRACESLICER_H_
+#define LIBHDFSPP_TRACESLICER_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "log.pb.h"
+#include "Logger.h"
+#include "LogReader.h"
+
+namespace hdfs
+{
+
+class TraceSlicer
+{
+ public:
+  struct Filter {
+    long from;                        //ns since first record of log
+    long to;
+    std::vector<std::string> prefixes;  //of paths, all if empty
+    std::unordered_set<long> threads;   //all if empty
+    bool opens;                       //keep opens of files not used
+    bool reads;
+    bool writes;                      //and flushes, hsyncs and seeks
+    bool metadata;                    //getfileinfo and listdir
+  };
+
+  TraceSlicer(const Filter &filter, const TraceClock &clock, Logger &out);
+  virtual ~TraceSlicer();
+
+  bool add(const hadoop::hdfs::log &msg, const std::string &record);
+  void finish();      //close what is still open in the slice
+
+  long kept() const;
+  long orphans() const;   //reads dropped, their file opened unseen
+
+ private:
+  struct File {
+    std::string open;       //OPEN and OPEN_RET records
+    std::string open_ret;
+    std::string path;
+    long fs;
+    long thread;
+    bool kept;
+  };
+
+  struct Call {
+    hadoop::hdfs::log_FuncType ret;   //type of its return
+    long value;                       //returned if made up at the end
+  };
+
+  bool wanted(const std::string &path, long thread) const;
+  void write(const std::string &record);
+  void keepFile(File &file);
+
+  Filter filter_;
+  TraceClock clock_;
+  Logger &out_;
+  std::unordered_map<long, File> opening_;      //by thread
+  std::unordered_map<long, File> files_;        //by handle
+  std::unordered_map<long, Call> calling_;      //kept calls by thread
+  std::unordered_set<long> closing_;            //threads
+  int last_date_;
+  long last_time_;
+  long kept_;
+  long orphans_;
+};
+
+} /* hdfs */ 
+
+#endif
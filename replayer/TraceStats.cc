@@ -0,0 +1,661 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include "LogReader.h"
+#include "TraceStats.h"
+#include "WorkerPool.h"
+
+#define BATCH_RECORDS 65536
+
+using namespace hdfs;
+namespace pbio = ::google::protobuf::io;
+namespace pbwire = ::google::protobuf::internal;
+
+TraceStats::TraceStats(const TraceClock &clock, long interval)
+  : clock_(clock)
+  , interval_(interval > 0 ? interval : 1)
+  , records_(0)
+  , calls_()
+  , returns_()
+  , read_bytes_(0)
+  , returned_bytes_(0)
+  , read_errors_(0)
+  , write_bytes_(0)
+  , written_bytes_(0)
+  , write_errors_(0)
+  , out_of_order_(0)
+  , unmatched_(0)
+  , min_time_(0)
+  , max_time_(0)
+  , first_time_(0)
+  , last_time_(0)
+  , cpu_counts_()
+{
+}
+
+TraceStats::~TraceStats()
+{
+}
+
+const char* TraceStats::opName(OpType op)
+{
+  switch (op) {
+    case OPEN:
+      return "open";
+    case READ:
+      return "read";
+    case CLOSE:
+      return "close";
+    case WRITE:
+      return "write";
+    case FLUSH:
+      return "flush";
+    case HSYNC:
+      return "hsync";
+    case SEEK:
+      return "seek";
+    case GETFILEINFO:
+      return "getfileinfo";
+    case LISTDIR:
+      return "listdir";
+    default:
+      return "unknown";
+  }
+}
+
+/* Day of a serialized record, read from its first field where protobuf
+ * writes it, so that days can be followed without parsing records */
+static bool dateOf(const std::string &record, int &date)
+{
+  pbio::CodedInputStream input((const uint8_t*)record.data(), record.size());
+  uint32_t value;
+
+  if (input.ReadTag() == pbwire::WireFormatLite::MakeTag(
+        hadoop::hdfs::log::kDateFieldNumber, 
+        pbwire::WireFormatLite::WIRETYPE_VARINT) 
+      && input.ReadVarint32(&value)) {
+    date = (int)value;
+    return true;
+  }
+
+  hadoop::hdfs::log msg;
+  if (!msg.ParseFromString(record)) {
+    return false;
+  }
+  date = msg.date();
+  return true;
+}
+
+/* Records are cut out of the log in main thread and parsed in batches
+ * by the pool. Batches are appended in log order as they finish. */
+std::unique_ptr<TraceStats> TraceStats::scan(const char* path, 
+    unsigned threads, long interval)
+{
+  struct Batch {
+    std::string data;
+    std::vector<uint32_t> sizes;
+    TraceClock clock;           //at its first record
+  };
+
+  LogReader reader(path);
+  std::string record;
+  hadoop::hdfs::log first;
+
+  if (!reader.nextRaw(record)) {
+    bool empty = reader.isEOF();
+    reader.close();
+    return empty ? std::unique_ptr<TraceStats>(new TraceStats(TraceClock(), 
+          interval)) : nullptr;
+  }
+  if (!first.ParseFromString(record)) {
+    reader.close();
+    return nullptr;
+  }
+
+  TraceClock clock(first.date(), first.time());
+  std::unique_ptr<TraceStats> result(new TraceStats(clock, interval));
+  std::map<long, std::unique_ptr<TraceStats>> done;
+  std::mutex mutex;
+  std::atomic<bool> failed(false);
+  long submitted = 0;
+  long appended = 0;
+
+  auto appendDone = [&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto next = done.find(appended);
+    while (next != done.end()) {
+      std::unique_ptr<TraceStats> stats = std::move(next->second);
+      done.erase(next);
+      lock.unlock();
+      result->append(*stats);
+      lock.lock();
+      next = done.find(++appended);
+    }
+  };
+
+  WorkerPool pool(threads, threads * 2);
+  std::shared_ptr<Batch> batch(new Batch());
+  bool more = true;
+
+  while (more) {
+    int date;
+    if (batch->sizes.empty()) batch->clock = clock;
+    if (!dateOf(record, date)) {
+      failed = true;
+      break;
+    }
+    clock.daysTo(date);
+
+    batch->data.append(record);
+    batch->sizes.push_back(record.size());
+    more = reader.nextRaw(record);
+
+    if (!more || batch->sizes.size() >= BATCH_RECORDS) {
+      long id = submitted++;
+      pool.submit([=, &done, &mutex, &failed](unsigned) {
+          std::unique_ptr<TraceStats> stats(new TraceStats(batch->clock, 
+                interval));
+          hadoop::hdfs::log msg;
+          const char* data = batch->data.data();
+
+          for (uint32_t size : batch->sizes) {
+            if (!msg.ParseFromArray(data, size)) {
+              failed = true;
+              break;
+            }
+            stats->add(msg);
+            data += size;
+          }
+
+          std::lock_guard<std::mutex> lock(mutex);
+          done[id] = std::move(stats);
+      });
+      batch.reset(new Batch());
+      appendDone();
+    }
+  }
+
+  pool.drain();
+  appendDone();
+
+  bool ok = reader.isEOF() && !failed;
+  reader.close();
+  if (!ok) {
+    return nullptr;
+  }
+
+  return result;
+}
+
+void TraceStats::add(const hadoop::hdfs::log &msg)
+{
+  long time = clock_.since(msg);
+
+  if (records_ == 0) {
+    first_time_ = min_time_ = max_time_ = time;
+  } else {
+    if (time < last_time_) out_of_order_++;
+    min_time_ = std::min(min_time_, time);
+    max_time_ = std::max(max_time_, time);
+  }
+  last_time_ = time;
+  records_++;
+
+  if (msg.frame_size() > 0 && frames_.count(msg.site()) == 0) {
+    frames_[msg.site()].assign(msg.frame().begin(), msg.frame().end());
+  }
+
+  bool call;
+  int op = opOf(msg.type(), call);
+  if (op < 0) {
+    return;
+  }
+
+  ThreadCount &thread = threads_[msg.threadid()];
+  if (call) {
+    calls_[op]++;
+    thread.first = thread.calls == 0 ? time : std::min(thread.first, time);
+    thread.last = thread.calls == 0 ? time : std::max(thread.last, time);
+    thread.calls++;
+
+    IntervalCount &interval = intervals_[intervalOf(time)];
+    interval.calls++;
+    if (op == READ && msg.argument_size() >= 5) {
+      read_bytes_ += msg.argument(4);
+      thread.bytes += msg.argument(4);
+      interval.bytes += msg.argument(4);
+    } else if (op == WRITE && msg.argument_size() >= 4) {
+      write_bytes_ += msg.argument(3);
+      thread.bytes += msg.argument(3);
+      interval.bytes += msg.argument(3);
+    }
+
+    // a thread makes one call at a time
+    auto pending = pending_.find(msg.threadid());
+    if (pending != pending_.end()) {
+      unmatched_++;
+    }
+    pending_[msg.threadid()] = callOf(op, time, msg);
+    return;
+  }
+
+  returns_[op]++;
+  if (op == READ && msg.argument_size() >= 1) {
+    if (msg.argument(0) < 0) {
+      read_errors_++;
+    } else {
+      returned_bytes_ += msg.argument(0);
+    }
+  } else if (op == WRITE && msg.argument_size() >= 1) {
+    if (msg.argument(0) < 0) {
+      write_errors_++;
+    } else {
+      written_bytes_ += msg.argument(0);
+    }
+  }
+
+  Call ret = callOf(op, time, msg);
+  auto pending = pending_.find(msg.threadid());
+  if (pending != pending_.end() && pending->second.op == op) {
+    complete(pending->second, ret);
+    pending_.erase(pending);
+  } else if (thread.calls == 0 && orphans_.count(msg.threadid()) == 0) {
+    orphans_[msg.threadid()] = ret;   //called in an earlier segment
+  } else {
+    unmatched_++;
+  }
+}
+
+void TraceStats::append(const TraceStats &next)
+{
+  if (next.records_ == 0) {
+    return;
+  }
+  if (records_ == 0) {
+    first_time_ = next.first_time_;
+  } else if (next.first_time_ < last_time_) {
+    out_of_order_++;
+  }
+
+  for (auto &orphan : next.orphans_) {
+    auto pending = pending_.find(orphan.first);
+    auto thread = threads_.find(orphan.first);
+
+    if (pending != pending_.end() && pending->second.op == orphan.second.op) {
+      complete(pending->second, orphan.second);
+      pending_.erase(pending);
+    } else if (pending == pending_.end() && orphans_.count(orphan.first) == 0 
+        && (thread == threads_.end() || thread->second.calls == 0)) {
+      orphans_[orphan.first] = orphan.second;
+    } else {
+      unmatched_++;
+    }
+  }
+
+  // calls still pending here were never returned if next made new ones
+  for (auto &thread : next.threads_) {
+    auto pending = pending_.find(thread.first);
+    if (thread.second.calls > 0 && pending != pending_.end()) {
+      unmatched_++;
+      pending_.erase(pending);
+    }
+  }
+  for (auto &call : next.pending_) {
+    pending_[call.first] = call.second;
+  }
+
+  mergeCounts(next);
+  last_time_ = next.last_time_;
+}
+
+void TraceStats::print(std::ostream &out, size_t top) const
+{
+  auto mb = [](double bytes) { return bytes / 1024 / 1024; };
+  double seconds = (max_time_ - min_time_) / 1000000000.0;
+  double span = seconds > 0 ? seconds : 1;
+  uint64_t calls = 0;
+
+  // operations other than open, read and close only if the log has them
+  auto shown = [this](int op) {
+    return op <= CLOSE || calls_[op] > 0 || returns_[op] > 0;
+  };
+  for (int op = 0; op < NUM_OPS; ++op) {
+    calls += calls_[op];
+  }
+
+  out << "Records: " << records_ << " out of order: " << out_of_order_;
+  out << " unmatched: " << unmatched_ << " in flight at end: ";
+  out << pending_.size() << "\n";
+  for (int op = 0; op < NUM_OPS; ++op) {
+    if (!shown(op)) continue;
+    out << opName((OpType)op) << ": " << calls_[op];
+    out << " " << opName((OpType)op) << "_ret: " << returns_[op] << "\n";
+  }
+  out << "Read: " << mb(read_bytes_) << " MB asked, ";
+  out << mb(returned_bytes_) << " MB returned, " << read_errors_;
+  out << " errors\n";
+  if (shown(WRITE)) {
+    out << "Write: " << mb(write_bytes_) << " MB asked, ";
+    out << mb(written_bytes_) << " MB written, " << write_errors_;
+    out << " errors\n";
+  }
+  out << "\nTotal: " << calls << "\tTime: " << seconds << " s\t";
+  out << "Throughput: " << calls / span << " ops/s, " << mb(read_bytes_) / span;
+  out << " MB/s read";
+  if (shown(WRITE)) out << ", " << mb(write_bytes_) / span << " MB/s written";
+  out << "\n";
+
+  out << "\nLatency (us) from call to return:\n";
+  for (int op = 0; op < NUM_OPS; ++op) {
+    if (!shown(op)) continue;
+    const Histogram &h = latency_[op];
+    out << "  " << opName((OpType)op) << "\tcount: " << h.count();
+    out << " mean: " << h.mean() / 1000;
+    out << " p50: " << h.percentile(50) / 1000.0;
+    out << " p90: " << h.percentile(90) / 1000.0;
+    out << " p99: " << h.percentile(99) / 1000.0;
+    out << " max: " << h.max() / 1000.0 << "\n";
+  }
+
+  printSites(out, top);
+
+  bool captured = false;
+  for (int op = 0; op < NUM_OPS; ++op) {
+    captured |= cpu_counts_[op].calls > 0 || cpu_counts_[op].switched > 0;
+  }
+  if (captured) {
+    out << "\nCPU time (us) from call to return, where captured:\n";
+    for (int op = 0; op < NUM_OPS; ++op) {
+      if (!shown(op)) continue;
+      const Histogram &h = cpu_[op];
+      const CpuCount &count = cpu_counts_[op];
+      out << "  " << opName((OpType)op) << "\tcount: " << h.count();
+      out << " mean: " << h.mean() / 1000;
+      out << " p50: " << h.percentile(50) / 1000.0;
+      out << " p99: " << h.percentile(99) / 1000.0;
+      out << " on cpu: " << (count.wall > 0 ? count.cpu / count.wall * 100 : 0);
+      out << "%";
+      if (count.switched > 0) {
+        out << " switches per call, voluntary: ";
+        out << (double)count.voluntary / count.switched << " involuntary: ";
+        out << (double)count.involuntary / count.switched;
+      }
+      out << "\n";
+    }
+  }
+
+  std::vector<std::pair<long, ThreadCount>> threads(threads_.begin(), 
+      threads_.end());
+  std::sort(threads.begin(), threads.end(), 
+      [](const std::pair<long, ThreadCount> &l, 
+        const std::pair<long, ThreadCount> &r) {
+        return l.second.calls != r.second.calls ? 
+          l.second.calls > r.second.calls : l.first < r.first;
+      });
+  out << "\nThreads: " << threads.size() << ", top ";
+  out << std::min(top, threads.size()) << " by calls:\n";
+  out << "  thread\tcalls\tMB\tops/s\tMB/s\n";
+  for (size_t i = 0; i < threads.size() && i < top; ++i) {
+    const ThreadCount &thread = threads[i].second;
+    double active = (thread.last - thread.first) / 1000000000.0;
+    if (active <= 0) active = span;
+
+    out << "  " << threads[i].first << "\t" << thread.calls << "\t";
+    out << mb(thread.bytes) << "\t" << thread.calls / active << "\t";
+    out << mb(thread.bytes) / active << "\n";
+  }
+
+  double length = interval_ / 1000000000.0;
+  out << "\nIntervals of " << length << " s:\n";
+  out << "  time_s\tcalls\tops/s\tMB/s\tconcurrency\n";
+  for (auto &interval : intervals_) {
+    out << "  " << interval.first * length << "\t" << interval.second.calls;
+    out << "\t" << interval.second.calls / length << "\t";
+    out << mb(interval.second.bytes) / length << "\t";
+    out << interval.second.busy / interval_ << "\n";
+  }
+  out.flush();
+}
+
+uint64_t TraceStats::records() const
+{
+  return records_;
+}
+
+int TraceStats::opOf(hadoop::hdfs::log_FuncType type, bool &call)
+{
+  // a call and its return are next to each other, the call first
+  call = type % 2 == 0;
+
+  switch (type) {
+    case hadoop::hdfs::log_FuncType_OPEN:
+    case hadoop::hdfs::log_FuncType_OPEN_RET:
+      return OPEN;
+    case hadoop::hdfs::log_FuncType_READ:
+    case hadoop::hdfs::log_FuncType_READ_RET:
+      return READ;
+    case hadoop::hdfs::log_FuncType_CLOSE:
+    case hadoop::hdfs::log_FuncType_CLOSE_RET:
+      return CLOSE;
+    case hadoop::hdfs::log_FuncType_WRITE:
+    case hadoop::hdfs::log_FuncType_WRITE_RET:
+      return WRITE;
+    case hadoop::hdfs::log_FuncType_FLUSH:
+    case hadoop::hdfs::log_FuncType_FLUSH_RET:
+      return FLUSH;
+    case hadoop::hdfs::log_FuncType_HSYNC:
+    case hadoop::hdfs::log_FuncType_HSYNC_RET:
+      return HSYNC;
+    case hadoop::hdfs::log_FuncType_SEEK:
+    case hadoop::hdfs::log_FuncType_SEEK_RET:
+      return SEEK;
+    case hadoop::hdfs::log_FuncType_GETFILEINFO:
+    case hadoop::hdfs::log_FuncType_GETFILEINFO_RET:
+      return GETFILEINFO;
+    case hadoop::hdfs::log_FuncType_LISTDIR:
+    case hadoop::hdfs::log_FuncType_LISTDIR_RET:
+      return LISTDIR;
+    default:
+      return -1;
+  }
+}
+
+TraceStats::Call TraceStats::callOf(int op, long time, 
+    const hadoop::hdfs::log &msg)
+{
+  Call call = {op, time, -1, -1, -1, msg.site(), 0};
+  if (op == READ && msg.type() == hadoop::hdfs::log_FuncType_READ_RET 
+      && msg.argument_size() >= 1 && msg.argument(0) > 0) {
+    call.bytes = msg.argument(0);
+  }
+  if (msg.has_cputime()) {
+    call.cpu = msg.cputime();
+  }
+  if (msg.has_voluntaryswitches() && msg.has_involuntaryswitches()) {
+    call.voluntary = msg.voluntaryswitches();
+    call.involuntary = msg.involuntaryswitches();
+  }
+  return call;
+}
+
+long TraceStats::intervalOf(long time) const
+{
+  return time >= 0 ? time / interval_ : (time - interval_ + 1) / interval_;
+}
+
+/* Count latency of a call, its CPU time if captured, and the time it
+ * was in flight in every interval it spans */
+void TraceStats::complete(const Call &call, const Call &ret)
+{
+  long time = ret.time;
+  latency_[call.op].record(time - call.time);
+
+  CpuCount &count = cpu_counts_[call.op];
+  if (call.cpu >= 0 && ret.cpu >= call.cpu) {
+    cpu_[call.op].record(ret.cpu - call.cpu);
+    count.calls++;
+    count.wall += std::max(time - call.time, 0L);
+    count.cpu += ret.cpu - call.cpu;
+  }
+  if (call.voluntary >= 0 && ret.voluntary >= call.voluntary 
+      && ret.involuntary >= call.involuntary) {
+    count.switched++;
+    count.voluntary += ret.voluntary - call.voluntary;
+    count.involuntary += ret.involuntary - call.involuntary;
+  }
+
+  if (call.site != 0 && (call.op == OPEN || call.op == READ)) {
+    SiteCount &site = sites_[call.site];
+    if (call.op == OPEN) {
+      site.opens++;
+      site.open_latency.record(time - call.time);
+    } else {
+      site.reads++;
+      site.bytes += ret.bytes;
+      site.read_latency.record(time - call.time);
+    }
+  }
+
+  long from = call.time;
+  while (from < time) {
+    long interval = intervalOf(from);
+    long to = std::min(time, (interval + 1) * interval_);
+
+    intervals_[interval].busy += to - from;
+    from = to;
+  }
+}
+
+void TraceStats::mergeCounts(const TraceStats &other)
+{
+  if (records_ == 0) {
+    min_time_ = other.min_time_;
+    max_time_ = other.max_time_;
+  } else {
+    min_time_ = std::min(min_time_, other.min_time_);
+    max_time_ = std::max(max_time_, other.max_time_);
+  }
+
+  records_ += other.records_;
+  for (int op = 0; op < NUM_OPS; ++op) {
+    calls_[op] += other.calls_[op];
+    returns_[op] += other.returns_[op];
+    latency_[op].merge(other.latency_[op]);
+    cpu_[op].merge(other.cpu_[op]);
+    cpu_counts_[op].calls += other.cpu_counts_[op].calls;
+    cpu_counts_[op].wall += other.cpu_counts_[op].wall;
+    cpu_counts_[op].cpu += other.cpu_counts_[op].cpu;
+    cpu_counts_[op].switched += other.cpu_counts_[op].switched;
+    cpu_counts_[op].voluntary += other.cpu_counts_[op].voluntary;
+    cpu_counts_[op].involuntary += other.cpu_counts_[op].involuntary;
+  }
+  read_bytes_ += other.read_bytes_;
+  returned_bytes_ += other.returned_bytes_;
+  read_errors_ += other.read_errors_;
+  write_bytes_ += other.write_bytes_;
+  written_bytes_ += other.written_bytes_;
+  write_errors_ += other.write_errors_;
+  out_of_order_ += other.out_of_order_;
+  unmatched_ += other.unmatched_;
+
+  for (auto &thread : other.threads_) {
+    ThreadCount &count = threads_[thread.first];
+    if (thread.second.calls > 0) {
+      count.first = count.calls == 0 ? thread.second.first 
+        : std::min(count.first, thread.second.first);
+      count.last = count.calls == 0 ? thread.second.last 
+        : std::max(count.last, thread.second.last);
+    }
+    count.calls += thread.second.calls;
+    count.bytes += thread.second.bytes;
+  }
+
+  for (auto &interval : other.intervals_) {
+    IntervalCount &count = intervals_[interval.first];
+    count.calls += interval.second.calls;
+    count.bytes += interval.second.bytes;
+    count.busy += interval.second.busy;
+  }
+
+  for (auto &site : other.sites_) {
+    SiteCount &count = sites_[site.first];
+    count.opens += site.second.opens;
+    count.reads += site.second.reads;
+    count.bytes += site.second.bytes;
+    count.open_latency.merge(site.second.open_latency);
+    count.read_latency.merge(site.second.read_latency);
+  }
+  for (auto &frames : other.frames_) {
+    if (frames_.count(frames.first) == 0) frames_.insert(frames);
+  }
+}
+
+/* Sampled call sites by bytes read, then by opens, each followed by its
+ * frames, innermost first */
+void TraceStats::printSites(std::ostream &out, size_t top) const
+{
+  if (sites_.empty()) {
+    return;
+  }
+
+  std::vector<std::pair<uint64_t, const SiteCount*>> sites;
+  for (auto &site : sites_) {
+    sites.push_back(std::make_pair(site.first, &site.second));
+  }
+  std::sort(sites.begin(), sites.end(), 
+      [](const std::pair<uint64_t, const SiteCount*> &l, 
+        const std::pair<uint64_t, const SiteCount*> &r) {
+        if (l.second->bytes != r.second->bytes) {
+          return l.second->bytes > r.second->bytes;
+        }
+        if (l.second->opens != r.second->opens) {
+          return l.second->opens > r.second->opens;
+        }
+        return l.first < r.first;
+      });
+
+  out << "\nCall sites of sampled calls: " << sites.size() << ", top ";
+  out << std::min(top, sites.size()) << " by bytes read:\n";
+  out << "  site\t\t\topens\topen p50 us\treads\tMB\tread p50 us\tp99 us\n";
+  for (size_t i = 0; i < sites.size() && i < top; ++i) {
+    const SiteCount &site = *sites[i].second;
+    out << "  " << std::hex << sites[i].first << std::dec;
+    out << "\t" << site.opens << "\t";
+    out << site.open_latency.percentile(50) / 1000.0 << "\t\t";
+    out << site.reads << "\t" << site.bytes / 1024.0 / 1024 << "\t";
+    out << site.read_latency.percentile(50) / 1000.0 << "\t\t";
+    out << site.read_latency.percentile(99) / 1000.0 << "\n";
+
+    auto frames = frames_.find(sites[i].first);
+    if (frames == frames_.end()) {
+      out << "    (frames not in log)\n";
+      continue;
+    }
+    for (auto &frame : frames->second) {
+      out << "    " << frame << "\n";
+    }
+  }
+}
@@ -0,0 +1,164 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// TraceStats summarizes a log: records and bytes per operation, calls
+// and bytes read or written per traced thread and per interval of
+// trace time, latency of calls from the time between a call and its
+// return, and how many calls were in flight on average in every
+// interval. If the logger captured the thread's CPU time and context
+// switches, it also splits the latency of calls into time on CPU and
+// waiting, and if it sampled call sites, it adds up opens, reads, bytes
+// and latency by site, with the frames or tag the log gave for it.
+// Counters are 64 bits wide, and records may come slightly out of time
+// order; they are counted rather than rejected.
+//
+// A log can be cut into segments summarized on their own, in parallel,
+// and appended in log order afterwards. A segment remembers calls that
+// were not returned by its end and returns whose call came before its
+// start, and appending pairs them up across the cut. scan() does this
+// with a pool of threads parsing batches of records; only the day of
+// every record is read in order, for the clock a batch starts with.
+
+#ifndef LIBHDFSPP_TRACESTATS_H_
+#define LIBHDFSPP_TRACESTATS_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+
+#include "log.pb.h"
+#include "Histogram.h"
+#include "LogReader.h"
+
+namespace hdfs
+{
+
+class TraceStats
+{
+ public:
+  typedef enum {
+    OPEN,
+    READ,
+    CLOSE,
+    WRITE,
+    FLUSH,
+    HSYNC,
+    SEEK,
+    GETFILEINFO,
+    LISTDIR,
+    NUM_OPS
+  } OpType;
+
+  TraceStats(const TraceClock &clock, long interval);   //interval in ns
+  virtual ~TraceStats();
+
+  static const char* opName(OpType op);
+  static int opOf(hadoop::hdfs::log_FuncType type, bool &call); //-1 if none
+  static std::unique_ptr<TraceStats> scan(const char* path, unsigned threads, 
+      long interval);   //nullptr on a parse error
+
+  void add(const hadoop::hdfs::log &msg);
+  void append(const TraceStats &next);  //next segment of the log
+  void print(std::ostream &out, size_t top) const;
+
+  uint64_t records() const;
+
+ private:
+  struct Call {
+    int op;
+    long time;
+    long cpu;           //thread totals, -1 if not captured
+    long voluntary;
+    long involuntary;
+    uint64_t site;      //0 if not sampled
+    long bytes;         //returned by a read
+  };
+
+  struct SiteCount {
+    uint64_t opens;     //sampled ones
+    uint64_t reads;
+    uint64_t bytes;     //returned by sampled reads
+    Histogram open_latency;
+    Histogram read_latency;
+  };
+
+  struct CpuCount {
+    uint64_t calls;     //with CPU time at call and return
+    double wall;        //ns from call to return of these
+    double cpu;
+    uint64_t switched;  //with context switches at call and return
+    uint64_t voluntary;
+    uint64_t involuntary;
+  };
+
+  struct ThreadCount {
+    uint64_t calls;
+    uint64_t bytes;
+    long first;
+    long last;
+  };
+
+  struct IntervalCount {
+    uint64_t calls;
+    uint64_t bytes;
+    double busy;        //ns spent in calls
+  };
+
+  static Call callOf(int op, long time, const hadoop::hdfs::log &msg);
+  long intervalOf(long time) const;
+  void complete(const Call &call, const Call &ret);
+  void mergeCounts(const TraceStats &other);
+  void printSites(std::ostream &out, size_t top) const;
+
+  TraceClock clock_;
+  long interval_;
+
+  uint64_t records_;
+  uint64_t calls_[NUM_OPS];
+  uint64_t returns_[NUM_OPS];
+  uint64_t read_bytes_;       //asked for by reads
+  uint64_t returned_bytes_;   //returned by reads
+  uint64_t read_errors_;
+  uint64_t write_bytes_;      //asked for by writes
+  uint64_t written_bytes_;    //returned by writes
+  uint64_t write_errors_;
+  uint64_t out_of_order_;
+  uint64_t unmatched_;        //calls or returns without the other
+  long min_time_;
+  long max_time_;
+  long first_time_;           //in log order
+  long last_time_;
+
+  Histogram latency_[NUM_OPS];
+  Histogram cpu_[NUM_OPS];
+  CpuCount cpu_counts_[NUM_OPS];
+  std::unordered_map<long, ThreadCount> threads_;
+  std::unordered_map<uint64_t, SiteCount> sites_;
+  std::unordered_map<uint64_t, std::vector<std::string>> frames_;
+  std::map<long, IntervalCount> intervals_;
+  std::unordered_map<long, Call> pending_;    //calls waiting for return
+  std::unordered_map<long, Call> orphans_;    //returns before any call
+};
+
+} /* hdfs */ 
+
+#endif
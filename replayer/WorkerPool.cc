@@ -0,0 +1,94 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "WorkerPool.h"
+
+using namespace hdfs;
+
+WorkerPool::WorkerPool(unsigned size, size_t capacity)
+  : mutex_()
+  , capacity_(capacity > 0 ? capacity : 1)
+  , running_(0)
+  , stop_(false)
+{
+  if (size == 0) size = 1;
+
+  for (unsigned i = 0; i < size; ++i) {
+    workers_.push_back(std::thread(&WorkerPool::run, this, i));
+  }
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  ready_.notify_all();
+
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+unsigned WorkerPool::size() const
+{
+  return (unsigned)workers_.size();
+}
+
+void WorkerPool::submit(Job job)
+{
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    space_.wait(lock, [this]{ return jobs_.size() < capacity_; });
+    jobs_.push_back(std::move(job));
+  }
+  ready_.notify_one();
+}
+
+void WorkerPool::drain()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock, [this]{ return jobs_.empty() && running_ == 0; });
+}
+
+void WorkerPool::run(unsigned index)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (true) {
+    ready_.wait(lock, [this]{ return stop_ || !jobs_.empty(); });
+    if (jobs_.empty()) {
+      return;   //stopped and nothing left to do
+    }
+
+    Job job = std::move(jobs_.front());
+    jobs_.pop_front();
+    running_++;
+    space_.notify_one();
+
+    lock.unlock();
+    job(index);
+    lock.lock();
+
+    running_--;
+    if (jobs_.empty() && running_ == 0) {
+      idle_.notify_all();
+    }
+  }
+}
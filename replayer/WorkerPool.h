@@ -0,0 +1,67 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A fixed group of worker threads executing jobs in submission order.
+// Threads are created once up front, so handing a file operation to a
+// worker costs a queue push rather than a thread creation. Each job is
+// told the index of the worker running it, which lets callers keep
+// per-worker state without locking. At most 'capacity' jobs wait in
+// the queue; submitting more blocks until a worker takes one.
+
+#ifndef LIBHDFSPP_WORKERPOOL_H_
+#define LIBHDFSPP_WORKERPOOL_H_
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+namespace hdfs
+{
+
+class WorkerPool
+{
+ public:
+  typedef std::function<void(unsigned)> Job;
+
+  WorkerPool(unsigned size, size_t capacity);
+  virtual ~WorkerPool();
+
+  unsigned size() const;
+  void submit(Job job);
+  void drain();         //block until every submitted job has finished
+
+ private:
+  void run(unsigned index);
+
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::condition_variable idle_;
+  std::condition_variable space_;
+  std::deque<Job> jobs_;
+  size_t capacity_;
+  unsigned running_;
+  bool stop_;
+  std::vector<std::thread> workers_;
+};
+
+} /* hdfs */ 
+
+#endif
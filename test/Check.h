@@ -0,0 +1,63 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks used by the tests. A failed check prints where it is and what
+// it compared, and the test goes on, so one run shows every failure;
+// main returns failures() so that ctest sees the test fail.
+
+#ifndef LIBHDFSPP_CHECK_H_
+#define LIBHDFSPP_CHECK_H_
+
+#include <cmath>
+#include <iostream>
+
+namespace hdfs
+{
+
+inline int& failures()
+{
+  static int count = 0;
+  return count;
+}
+
+} /* hdfs */ 
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": " << #cond << std::endl; \
+      hdfs::failures()++; \
+    } \
+  } while (0)
+
+#define CHECK_EQ(a, b) do { \
+    if (!((a) == (b))) { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": " << #a << " == " << #b; \
+      std::cerr << " (" << (a) << " vs " << (b) << ")" << std::endl; \
+      hdfs::failures()++; \
+    } \
+  } while (0)
+
+#define CHECK_NEAR(a, b, tolerance) do { \
+    if (!(std::fabs((double)(a) - (double)(b)) <= (tolerance))) { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": " << #a << " ~ " << #b; \
+      std::cerr << " (" << (a) << " vs " << (b) << ")" << std::endl; \
+      hdfs::failures()++; \
+    } \
+  } while (0)
+
+#endif
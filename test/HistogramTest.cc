@@ -0,0 +1,126 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Percentiles of a histogram are within its bucket error of the exact
+// ones, and merged or saved histograms answer like one that recorded
+// every value itself.
+
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+#include "Check.h"
+#include "Histogram.h"
+
+using namespace hdfs;
+
+/* Exact percentile with the rank Histogram uses */
+static long exactPercentile(std::vector<long> values, double p)
+{
+  std::sort(values.begin(), values.end());
+  size_t rank = (size_t)(p / 100 * values.size() + 0.5);
+  if (rank < 1) rank = 1;
+  if (rank > values.size()) rank = values.size();
+  return values[rank - 1];
+}
+
+static void testPercentiles()
+{
+  Histogram histogram;
+  std::vector<long> values;
+  unsigned long seed = 1;
+
+  CHECK_EQ(histogram.percentile(50), 0);
+  for (int i = 0; i < 100000; ++i) {
+    seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+    long value = (long)(seed >> 40);    //up to 2^24
+    values.push_back(value);
+    histogram.record(value);
+  }
+
+  CHECK_EQ(histogram.count(), values.size());
+  CHECK_EQ(histogram.min(), *std::min_element(values.begin(), values.end()));
+  CHECK_EQ(histogram.max(), *std::max_element(values.begin(), values.end()));
+  for (double p : {1.0, 10.0, 50.0, 90.0, 99.0, 99.9}) {
+    long exact = exactPercentile(values, p);
+    CHECK_NEAR(histogram.percentile(p), exact, exact * 0.03 + 1);
+  }
+  CHECK_EQ(histogram.percentile(100), histogram.max());
+}
+
+static void testSmallValues()
+{
+  Histogram histogram;
+
+  // values below 32 have a bucket each
+  for (long value = 0; value < 32; ++value) histogram.record(value);
+  histogram.record(-5);   //counted as 0
+
+  CHECK_EQ(histogram.count(), 33u);
+  CHECK_EQ(histogram.min(), 0);
+  CHECK_EQ(histogram.percentile(50), 15);
+  CHECK_EQ(histogram.max(), 31);
+}
+
+static void testMerge()
+{
+  Histogram all, low, high;
+
+  for (long value = 1; value <= 2000; ++value) {
+    all.record(value * 1000);
+    (value % 2 == 0 ? low : high).record(value * 1000);
+  }
+  low.merge(high);
+
+  CHECK_EQ(low.count(), all.count());
+  CHECK_EQ(low.min(), all.min());
+  CHECK_EQ(low.max(), all.max());
+  CHECK_NEAR(low.mean(), all.mean(), 1e-6);
+  for (double p : {5.0, 50.0, 95.0, 99.0}) {
+    CHECK_EQ(low.percentile(p), all.percentile(p));
+  }
+  CHECK_NEAR(low.distance(all), 0, 1e-12);
+}
+
+static void testSaveLoad()
+{
+  Histogram histogram, loaded;
+  std::stringstream text;
+
+  for (long value = 0; value < 5000; value += 7) histogram.record(value);
+  histogram.save(text);
+  CHECK(loaded.load(text));
+
+  CHECK_EQ(loaded.count(), histogram.count());
+  CHECK_EQ(loaded.min(), histogram.min());
+  CHECK_EQ(loaded.max(), histogram.max());
+  CHECK_EQ(loaded.percentile(90), histogram.percentile(90));
+
+  std::stringstream garbage("not a histogram");
+  CHECK(!loaded.load(garbage));
+}
+
+int main()
+{
+  testPercentiles();
+  testSmallValues();
+  testMerge();
+  testSaveLoad();
+
+  return failures();
+}
@@ -0,0 +1,181 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A log index finds, for any time, a place to start reading from that
+// no record of that time or later comes before, and it is saved and
+// loaded next to its log. Times of records over new year count the
+// days of a leap year only if it has a day 365.
+
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+
+#include "Check.h"
+#include "LogIndex.h"
+#include "LogReader.h"
+
+#define LOG_PATH "logindex_test.log"
+#define NS_PER_DAY (24L * 3600 * 1000000000)
+
+using namespace hdfs;
+namespace pbio = ::google::protobuf::io;
+
+/* A log of reads and their returns over new year, a little out of
+ * order; gives the offset and time of every record */
+static bool writeLog(std::vector<long> &offsets, std::vector<long> &times, 
+    long shift = 0)
+{
+  int fd = open(LOG_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return false;
+  pbio::FileOutputStream file(fd);
+  long start = NS_PER_DAY - 500000 + shift;
+
+  {
+    pbio::CodedOutputStream out(&file);
+    for (int i = 0; i < 1000; ++i) {
+      hadoop::hdfs::log msg;
+      long time = start + i * 1000 + (i % 7 == 3 ? -2500 : 0);
+
+      msg.set_type(i % 2 == 0 ? hadoop::hdfs::log_FuncType_READ 
+          : hadoop::hdfs::log_FuncType_READ_RET);
+      msg.set_date(time < NS_PER_DAY ? 364 : 0);
+      msg.set_time(time % NS_PER_DAY);
+      msg.set_threadid(1 + i % 3);
+      msg.add_argument(4096);
+      std::string record;
+      msg.SerializeToString(&record);
+      offsets.push_back(out.ByteCount());
+      times.push_back(time - start);
+      out.WriteVarint32(record.size());
+      out.WriteString(record);
+    }
+    offsets.push_back(out.ByteCount());
+  }
+  return file.Close();
+}
+
+/* No record of the time or later is before the offset given for it */
+static void checkOffsets(const LogIndex &index, 
+    const std::vector<long> &offsets, const std::vector<long> &times)
+{
+  for (size_t i = 0; i < times.size(); ++i) {
+    long from = index.offsetBefore(times[i]);
+    for (size_t j = 0; j < times.size(); ++j) {
+      if (times[j] >= times[i]) CHECK(offsets[j] >= from);
+    }
+  }
+}
+
+static void testBuild(const std::vector<long> &offsets, 
+    const std::vector<long> &times)
+{
+  LogIndex index;
+
+  CHECK(index.build(LOG_PATH, 16));
+  CHECK_EQ(index.startDate(), 364);
+  CHECK_EQ(index.offsetBefore(-1), 0);
+  CHECK_EQ(index.offsetBefore(times.back() + 1), offsets.back());
+  checkOffsets(index, offsets, times);
+
+  // the offset is the start of a record
+  LogReader reader(LOG_PATH);
+  CHECK(reader.seek(index.offsetBefore(times[500])));
+  auto msg = reader.next();
+  CHECK(msg != nullptr);
+}
+
+static void testSaveLoad(const std::vector<long> &offsets, 
+    const std::vector<long> &times)
+{
+  LogIndex index, loaded;
+  std::string path = LogIndex::pathOf(LOG_PATH);
+
+  CHECK(index.build(LOG_PATH, 10));
+  CHECK(index.save(path));
+  CHECK(loaded.load(path, LOG_PATH));
+  CHECK_EQ(loaded.startTime(), index.startTime());
+  for (long time : times) {
+    CHECK_EQ(loaded.offsetBefore(time), index.offsetBefore(time));
+  }
+  checkOffsets(loaded, offsets, times);
+
+  // an index of a log longer than the log is stale
+  CHECK(truncate(LOG_PATH, offsets.back() / 2) == 0);
+  CHECK(!loaded.load(path, LOG_PATH));
+
+  // nor is an index of a log written anew since, however long
+  std::vector<long> other_offsets, other_times;
+  CHECK(writeLog(other_offsets, other_times, 1000));
+  CHECK(!loaded.load(path, LOG_PATH));
+  unlink(path.c_str());
+}
+
+static hadoop::hdfs::log at(int date, long time)
+{
+  hadoop::hdfs::log msg;
+  msg.set_date(date);
+  msg.set_time(time);
+  return msg;
+}
+
+static void testClock()
+{
+  long minute = 60L * 1000000000;
+
+  // a leap year, known as the trace starts on its last day
+  TraceClock leap(365, NS_PER_DAY - minute);
+  CHECK_EQ(leap.since(at(0, minute)), 2 * minute);
+  CHECK_EQ(leap.since(at(365, NS_PER_DAY - 2 * minute)), -minute);
+  CHECK_EQ(leap.since(at(1, 0)), NS_PER_DAY + minute);
+  CHECK_EQ(timeSince(365, NS_PER_DAY - minute, at(0, minute)), 2 * minute);
+
+  // a leap year seen through a record on its day 365, then another year
+  TraceClock seen;
+  CHECK_EQ(seen.since(at(300, 0)), 0);
+  CHECK_EQ(seen.since(at(365, 0)), 65 * NS_PER_DAY);
+  CHECK_EQ(seen.since(at(0, 0)), 66 * NS_PER_DAY);
+  CHECK_EQ(seen.since(at(200, 0)), (66 + 200) * NS_PER_DAY);
+  CHECK_EQ(seen.since(at(364, 0)), (66 + 364) * NS_PER_DAY);
+  CHECK_EQ(seen.since(at(2, 0)), (66 + 365 + 2) * NS_PER_DAY);
+
+  // a common year
+  TraceClock common(300, 0);
+  CHECK_EQ(common.since(at(364, 0)), 64 * NS_PER_DAY);
+  CHECK_EQ(common.since(at(0, 0)), 65 * NS_PER_DAY);
+
+  // a clock resumed mid-log goes on in the year an index tells
+  TraceClock resumed(300, 0);
+  resumed.resume(at(1, minute), 66 * NS_PER_DAY);
+  CHECK_EQ(resumed.since(at(1, minute)), 66 * NS_PER_DAY + minute);
+  CHECK_EQ(resumed.since(at(2, 0)), 67 * NS_PER_DAY);
+}
+
+int main()
+{
+  std::vector<long> offsets, times;
+
+  CHECK(writeLog(offsets, times));
+  testBuild(offsets, times);
+  testSaveLoad(offsets, times);
+  unlink(LOG_PATH);
+  testClock();
+
+  return failures();
+}
@@ -0,0 +1,125 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Logger counters are kept per thread, and a snapshot saved to a file
+// loads back as it was taken, which is what tstat reads.
+
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+#include "Check.h"
+#include "LoggerStats.h"
+
+#define STATS_PATH "loggerstats_test.stats"
+
+using namespace hdfs;
+
+static void count(LoggerStats &stats, int records)
+{
+  for (int i = 0; i < records; ++i) {
+    stats.call(600 + i);
+    stats.lock(10);
+    stats.write(100, 64);
+  }
+  stats.flush(5000);
+  stats.drop();
+  stats.error();
+}
+
+static void testBuckets()
+{
+  CHECK_EQ(LoggerStats::bucketOf(0), 0);
+  CHECK_EQ(LoggerStats::bucketOf(1), 0);
+  CHECK_EQ(LoggerStats::bucketOf(2), 1);
+  CHECK_EQ(LoggerStats::bucketOf(1023), 9);
+  CHECK_EQ(LoggerStats::bucketOf(1024), 10);
+  CHECK_EQ(LoggerStats::bucketOf(1UL << 50), CALL_BUCKETS - 1);
+}
+
+static void testThreads()
+{
+  LoggerStats stats;
+
+  std::thread other(count, std::ref(stats), 30);
+  other.join();
+  count(stats, 20);
+  stats.enterWait();
+  stats.enterWait();
+  stats.leaveWait();
+
+  auto snapshot = stats.snapshot("test.log");
+  CHECK_EQ(snapshot.threads.size(), 2u);
+  CHECK_EQ(snapshot.waiting, 1);
+  CHECK_EQ(snapshot.max_waiting, 2);
+
+  uint64_t records = 0;
+  for (auto &counts : snapshot.threads) {
+    records += counts.records;
+    CHECK_EQ(counts.bytes, counts.records * 64);
+    CHECK_EQ(counts.lock_ns, counts.records * 10);
+    CHECK_EQ(counts.flush_ns, 5000u);
+    CHECK_EQ(counts.dropped, 1u);
+    CHECK_EQ(counts.errors, 1u);
+    CHECK_EQ(counts.calls[LoggerStats::bucketOf(600)], counts.records);
+  }
+  CHECK_EQ(records, 50u);
+}
+
+static void testSaveLoad()
+{
+  LoggerStats stats;
+  LoggerStats::Snapshot loaded;
+
+  count(stats, 10);
+  stats.call(1L << 30);
+  CHECK(stats.save(STATS_PATH, "/logs/with space_42.log"));
+  auto saved = stats.snapshot("/logs/with space_42.log");
+
+  std::ifstream in(STATS_PATH);
+  CHECK(loaded.load(in));
+  CHECK_EQ(loaded.pid, saved.pid);
+  CHECK_EQ(loaded.log, saved.log);
+  CHECK_EQ(loaded.start, saved.start);
+  CHECK_EQ(loaded.threads.size(), 1u);
+  if (loaded.threads.size() == 1) {
+    auto &a = loaded.threads[0];
+    auto &b = saved.threads[0];
+    CHECK_EQ(a.thread, b.thread);
+    CHECK_EQ(a.records, b.records);
+    CHECK_EQ(a.bytes, b.bytes);
+    CHECK_EQ(a.call_ns, b.call_ns);
+    CHECK_EQ(a.write_ns, b.write_ns);
+    CHECK_EQ(a.dropped, b.dropped);
+    for (int i = 0; i < CALL_BUCKETS; ++i) CHECK_EQ(a.calls[i], b.calls[i]);
+  }
+  std::remove(STATS_PATH);
+
+  std::istringstream other("libhdfspp-logger-stats 99\n");
+  CHECK(!loaded.load(other));
+}
+
+int main()
+{
+  testBuckets();
+  testThreads();
+  testSaveLoad();
+
+  return failures();
+}
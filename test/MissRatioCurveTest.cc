@@ -0,0 +1,162 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The miss ratio curve matches an LRU cache simulated access by access:
+// exactly when every block is tracked, and closely when blocks are
+// sampled.
+
+#include <map>
+#include <list>
+#include <vector>
+#include <sstream>
+#include <cstdint>
+
+#include "Check.h"
+#include "MissRatioCurve.h"
+
+#define BLOCK 4096
+
+using namespace hdfs;
+
+struct Access {
+  uint64_t file;
+  long block;
+};
+
+/* Skewed accesses: a few hot blocks, sequential runs and a cold tail */
+static std::vector<Access> makeAccesses(size_t count, long blocks)
+{
+  std::vector<Access> accesses;
+  unsigned long seed = 7;
+
+  while (accesses.size() < count) {
+    seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+    long r = (long)(seed >> 33);
+    if (r % 4 == 0) {
+      for (long block = r % blocks; block < r % blocks + 8; ++block) {
+        accesses.push_back(Access{1, block});
+      }
+    } else if (r % 4 == 1) {
+      accesses.push_back(Access{2, r % blocks});
+    } else {
+      accesses.push_back(Access{(uint64_t)(r % 3), r % (blocks / 20)});
+    }
+  }
+  accesses.resize(count);
+  return accesses;
+}
+
+/* Miss ratio of an LRU cache of the given number of blocks */
+static double lruMissRatio(const std::vector<Access> &accesses, size_t size)
+{
+  typedef std::pair<uint64_t, long> Key;
+  std::list<Key> cache;   //most recent first
+  std::map<Key, std::list<Key>::iterator> where;
+  long misses = 0;
+
+  for (auto &access : accesses) {
+    Key key = std::make_pair(access.file, access.block);
+    auto found = where.find(key);
+    if (found != where.end()) {
+      cache.erase(found->second);
+    } else {
+      misses++;
+      if (cache.size() == size) {
+        where.erase(cache.back());
+        cache.pop_back();
+      }
+    }
+    cache.push_front(key);
+    where[key] = cache.begin();
+  }
+
+  return (double)misses / accesses.size();
+}
+
+/* Points of the curve, cache size in blocks and miss ratio */
+static std::vector<std::pair<long, double>> curveOf(
+    const std::vector<Access> &accesses, double rate)
+{
+  MissRatioCurve curve(BLOCK, rate, 1 << 16, 1000000000L);
+  std::vector<std::pair<long, double>> points;
+  std::stringstream out;
+  std::string line;
+
+  for (size_t i = 0; i < accesses.size(); ++i) {
+    curve.access(accesses[i].file, accesses[i].block * BLOCK, BLOCK, i);
+  }
+  curve.finish();
+  curve.print(out);
+
+  std::getline(out, line);    //summary
+  std::getline(out, line);    //header
+  long bytes;
+  double ratio;
+  while (out >> bytes >> ratio) {
+    points.push_back(std::make_pair(bytes / BLOCK, ratio));
+  }
+  return points;
+}
+
+static void testExact()
+{
+  auto accesses = makeAccesses(3000, 400);
+  auto points = curveOf(accesses, 1);
+
+  CHECK(points.size() > 8);
+  for (auto &point : points) {
+    //ratios are printed with 6 digits
+    CHECK_NEAR(point.second, lruMissRatio(accesses, point.first), 1e-5);
+  }
+}
+
+static void testSampled()
+{
+  auto accesses = makeAccesses(20000, 4000);
+  auto points = curveOf(accesses, 0.25);
+
+  CHECK(points.size() > 8);
+  for (auto &point : points) {
+    CHECK_NEAR(point.second, lruMissRatio(accesses, point.first), 0.05);
+  }
+}
+
+static void testSpan()
+{
+  MissRatioCurve curve(BLOCK, 1, 1024, 1000000000L);
+  std::stringstream out;
+  std::string line;
+
+  // a read over three blocks is three accesses, twice is all cold
+  curve.access(1, BLOCK / 2, 2 * BLOCK, 0);
+  curve.access(1, BLOCK / 2, 2 * BLOCK, 1);
+  curve.finish();
+  curve.print(out);
+  std::getline(out, line);
+
+  CHECK(line.find(": 6 block accesses") != std::string::npos);
+}
+
+int main()
+{
+  testExact();
+  testSampled();
+  testSpan();
+
+  return failures();
+}
@@ -0,0 +1,283 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Joining calls with their returns and splitting the ops again gives
+// back every record as it was logged, and a compact log reads, and is
+// indexed, like the log it was made from.
+
+#include <vector>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+
+#include "Check.h"
+#include "LogIndex.h"
+#include "LogReader.h"
+#include "OpJoiner.h"
+
+#define COMPACT_PATH "opjoiner_test.log"
+
+using namespace hdfs;
+namespace pbio = ::google::protobuf::io;
+
+static hadoop::hdfs::log record(hadoop::hdfs::log_FuncType type, long time, 
+    long thread, std::vector<long> arguments, long cpu = -1, int date = 100)
+{
+  hadoop::hdfs::log msg;
+
+  msg.set_type(type);
+  msg.set_date(date);
+  msg.set_time(time);
+  msg.set_threadid(thread);
+  for (long argument : arguments) msg.add_argument(argument);
+  if (cpu >= 0) {
+    msg.set_cputime(cpu);
+    msg.set_voluntaryswitches(cpu / 100);
+    msg.set_involuntaryswitches(cpu / 1000);
+  }
+  return msg;
+}
+
+/* One thread's records, each call right before its return */
+static std::vector<hadoop::hdfs::log> sequentialLog()
+{
+  std::vector<hadoop::hdfs::log> log;
+
+  auto open = record(hadoop::hdfs::log_FuncType_OPEN, 1000, 7, 
+      {1, 0, 0, 0, 0}, 5000);
+  open.set_path("/data/a");
+  log.push_back(open);
+  log.push_back(record(hadoop::hdfs::log_FuncType_OPEN_RET, 1900, 7, 
+        {42}, 5800));
+  for (long i = 0; i < 20; ++i) {
+    long time = 2000 + i * 1000;
+    log.push_back(record(hadoop::hdfs::log_FuncType_READ, time, 7, 
+          {1, 42, i * 4096, 0, 4096}, 6000 + i * 300));
+    log.push_back(record(hadoop::hdfs::log_FuncType_READ_RET, time + 500, 7, 
+          {4096}, 6200 + i * 300));
+  }
+  log.push_back(record(hadoop::hdfs::log_FuncType_SEEK, 30000, 7, {1, 42, 8}));
+  log.push_back(record(hadoop::hdfs::log_FuncType_SEEK_RET, 30100, 7, {0}));
+  log.push_back(record(hadoop::hdfs::log_FuncType_CLOSE, 31000, 7, {1, 42}));
+  log.push_back(record(hadoop::hdfs::log_FuncType_CLOSE_RET, 31500, 7, {0}));
+  return log;
+}
+
+static std::vector<hadoop::hdfs::op> join(
+    const std::vector<hadoop::hdfs::log> &log, OpJoiner &joiner)
+{
+  std::vector<hadoop::hdfs::op> ops;
+  hadoop::hdfs::op op;
+
+  for (auto &msg : log) {
+    joiner.push(msg);
+    while (joiner.pop(op)) ops.push_back(op);
+  }
+  joiner.finish();
+  while (joiner.pop(op)) ops.push_back(op);
+  return ops;
+}
+
+static std::vector<std::string> split(const std::vector<hadoop::hdfs::op> &ops)
+{
+  std::vector<std::string> records;
+
+  for (auto &op : ops) {
+    hadoop::hdfs::log call, ret;
+    bool has_call, has_ret;
+    OpJoiner::split(op, call, has_call, ret, has_ret);
+    if (has_call) records.push_back(call.SerializeAsString());
+    if (has_ret) records.push_back(ret.SerializeAsString());
+  }
+  return records;
+}
+
+static void testRoundTrip()
+{
+  auto log = sequentialLog();
+  OpJoiner joiner;
+  auto ops = join(log, joiner);
+
+  CHECK_EQ(ops.size(), log.size() / 2);
+  CHECK_EQ(joiner.unreturned(), 0u);
+  CHECK_EQ(joiner.lone(), 0u);
+
+  // reads have their own fields, and the file of their open
+  auto &read = ops[3];
+  CHECK_EQ(read.handle(), 42);
+  CHECK_EQ(read.offset(), 2 * 4096);
+  CHECK_EQ(read.length(), 4096);
+  CHECK_EQ(read.ret(), 4096);
+  CHECK_EQ(read.duration(), 500);
+  CHECK_EQ(read.cputime(), 200);
+  CHECK_EQ(read.pathid(), ops[0].pathid());
+  CHECK_EQ(ops[0].handle(), 42);
+
+  auto records = split(ops);
+  CHECK_EQ(records.size(), log.size());
+  for (size_t i = 0; i < log.size() && i < records.size(); ++i) {
+    CHECK(records[i] == log[i].SerializeAsString());
+  }
+}
+
+/* Returns on the day after day 365 of a leap year, and on the same */
+static void testNewYear()
+{
+  std::vector<hadoop::hdfs::log> log;
+  long day = 24L * 3600 * 1000000000;
+
+  log.push_back(record(hadoop::hdfs::log_FuncType_GETFILEINFO, day - 1000, 
+        3, {1}, -1, 365));
+  log.push_back(record(hadoop::hdfs::log_FuncType_GETFILEINFO_RET, 500, 
+        3, {0}, -1, 0));
+  log.push_back(record(hadoop::hdfs::log_FuncType_LISTDIR, day - 3000, 
+        4, {1}, -1, 365));
+  log.push_back(record(hadoop::hdfs::log_FuncType_LISTDIR_RET, day - 2000, 
+        4, {0}, -1, 365));
+  OpJoiner joiner;
+  auto ops = join(log, joiner);
+
+  CHECK_EQ(ops.size(), 2u);
+  CHECK_EQ(ops[0].duration(), 1500);
+  CHECK_EQ(ops[1].duration(), 1000);
+  auto records = split(ops);
+  CHECK_EQ(records.size(), log.size());
+  for (size_t i = 0; i < log.size() && i < records.size(); ++i) {
+    CHECK(records[i] == log[i].SerializeAsString());
+  }
+}
+
+static void testUnmatched()
+{
+  std::vector<hadoop::hdfs::log> log;
+  OpJoiner joiner;
+
+  log.push_back(record(hadoop::hdfs::log_FuncType_READ_RET, 10, 1, {5}, 900));
+  log.push_back(record(hadoop::hdfs::log_FuncType_READ, 20, 2, 
+        {1, 3, 0, 0, 5}));
+  log.push_back(record(hadoop::hdfs::log_FuncType_READ, 30, 2, 
+        {1, 3, 5, 0, 5}));
+  log.push_back(record(hadoop::hdfs::log_FuncType_READ_RET, 40, 2, {5}));
+  log.push_back(record(hadoop::hdfs::log_FuncType_CLOSE, 50, 3, {1, 3}));
+  auto ops = join(log, joiner);
+
+  CHECK_EQ(ops.size(), 4u);
+  CHECK_EQ(joiner.lone(), 1u);
+  CHECK_EQ(joiner.unreturned(), 2u);
+  CHECK(!ops[1].has_duration());
+  CHECK_EQ(ops[2].duration(), 10);
+
+  auto records = split(ops);
+  CHECK_EQ(records.size(), log.size());
+  for (size_t i = 0; i < log.size() && i < records.size(); ++i) {
+    CHECK(records[i] == log[i].SerializeAsString());
+  }
+}
+
+static void testRelease()
+{
+  OpJoiner joiner(4, 1000000);
+  hadoop::hdfs::op op;
+  int ops = 0;
+
+  // a call that never returns only holds back a few ops
+  joiner.push(record(hadoop::hdfs::log_FuncType_READ, 0, 1, {1, 3, 0, 0, 5}));
+  for (long i = 1; i <= 10; ++i) {
+    joiner.push(record(hadoop::hdfs::log_FuncType_READ, i * 10, 2, 
+          {1, 4, 0, 0, 5}));
+    joiner.push(record(hadoop::hdfs::log_FuncType_READ_RET, i * 10 + 5, 2, 
+          {5}));
+    while (joiner.pop(op)) ops++;
+  }
+  CHECK_EQ(joiner.released(), 1u);
+  CHECK(ops >= 7);
+
+  // nor for long in trace time
+  joiner.push(record(hadoop::hdfs::log_FuncType_READ, 200, 3, {1, 5, 0, 0, 5}));
+  joiner.push(record(hadoop::hdfs::log_FuncType_READ, 2000000, 2, 
+        {1, 4, 0, 0, 5}));
+  CHECK(joiner.pop(op));
+  CHECK_EQ(op.threadid(), 3);
+  CHECK(!op.has_duration());
+  CHECK_EQ(joiner.released(), 2u);
+}
+
+/* Write ops as a compact log, as tcompact does */
+static bool writeCompact(const std::vector<hadoop::hdfs::op> &ops)
+{
+  int fd = open(COMPACT_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return false;
+  pbio::FileOutputStream file(fd);
+
+  {
+    pbio::CodedOutputStream out(&file);
+    std::string record;
+    out.WriteVarint32(0);
+    out.WriteVarint32(std::strlen(COMPACT_MAGIC));
+    out.WriteString(COMPACT_MAGIC);
+    for (auto &op : ops) {
+      op.SerializeToString(&record);
+      out.WriteVarint32(record.size());
+      out.WriteString(record);
+    }
+  }
+  return file.Close();
+}
+
+static void testCompactLog()
+{
+  auto log = sequentialLog();
+  OpJoiner joiner;
+  CHECK(writeCompact(join(log, joiner)));
+
+  LogReader reader(COMPACT_PATH);
+  std::vector<std::string> records;
+  std::string record;
+  CHECK(reader.isCompact());
+  while (reader.nextRaw(record)) records.push_back(record);
+  CHECK_EQ(records.size(), log.size());
+
+  // a block of the index never starts at a return, so seeking to the
+  // block of any record reads that record again
+  LogIndex index;
+  CHECK(index.build(COMPACT_PATH, 3));
+  for (size_t i = 0; i < log.size(); ++i) {
+    LogReader from(COMPACT_PATH);
+    bool found = false;
+    CHECK(from.seek(index.offsetBefore(
+            timeSince(index.startDate(), index.startTime(), log[i]))));
+    while (!found && from.nextRaw(record)) {
+      found = record == log[i].SerializeAsString();
+    }
+    CHECK(found);
+  }
+  unlink(COMPACT_PATH);
+}
+
+int main()
+{
+  testRoundTrip();
+  testNewYear();
+  testUnmatched();
+  testRelease();
+  testCompactLog();
+
+  return failures();
+}
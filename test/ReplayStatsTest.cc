@@ -0,0 +1,99 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Results saved by a replay load back as they were, and results of
+// several replays add up, which is how a coordinator puts the results
+// of its workers together.
+
+#include <sstream>
+
+#include "Check.h"
+#include "ReplayStats.h"
+
+using namespace hdfs;
+
+static void fill(ReplayStats &stats)
+{
+  std::ostringstream ignored;
+
+  for (long i = 0; i < 1000; ++i) {
+    stats.record(i % 2, ReplayStats::READ, 1000 + i, 4096);
+  }
+  stats.record(0, ReplayStats::OPEN, 20000, 0);
+  stats.record(1, ReplayStats::WRITE, 3000, 65536);
+  stats.recordError(1, ReplayStats::CLOSE);
+  stats.sample(ignored);
+  stats.finish();
+
+  Histogram lateness;
+  lateness.record(500);
+  stats.setLateness(lateness);
+}
+
+static void testRoundTrip()
+{
+  ReplayStats stats(2), loaded(1);
+  std::stringstream saved, again;
+
+  fill(stats);
+  stats.save(saved);
+  CHECK(loaded.load(saved));
+  loaded.save(again);
+
+  CHECK_EQ(loaded.operations(), stats.operations());
+  CHECK_EQ(loaded.operations(), 1002u);
+  CHECK_EQ(loaded.elapsed(), stats.elapsed());
+  CHECK_EQ(again.str(), saved.str());
+}
+
+static void testAddUp()
+{
+  ReplayStats stats(2), both(1);
+  std::ostringstream saved;
+
+  fill(stats);
+  stats.save(saved);
+  for (int i = 0; i < 2; ++i) {
+    std::istringstream in(saved.str());
+    CHECK(both.load(in));
+  }
+
+  CHECK_EQ(both.operations(), 2 * stats.operations());
+  CHECK_EQ(both.elapsed(), stats.elapsed());
+}
+
+static void testBadInput()
+{
+  ReplayStats stats(1);
+  std::istringstream cut("elapsed 1.5\nop 1 10 40960 0 ");
+  std::istringstream unknown("elapsed 1.5\nbogus\nend\n");
+  std::istringstream op("op 99 1 1 0\nend\n");
+
+  CHECK(!stats.load(cut));
+  CHECK(!stats.load(unknown));
+  CHECK(!stats.load(op));
+}
+
+int main()
+{
+  testRoundTrip();
+  testAddUp();
+  testBadInput();
+
+  return failures();
+}
@@ -0,0 +1,91 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A token bucket lets operations through at its rate, saves no more
+// than its burst while the caller is away, and ramps its rate. Times
+// are checked with slack, since the test may be descheduled.
+
+#include <chrono>
+#include <thread>
+
+#include "Check.h"
+#include "TokenBucket.h"
+
+using namespace hdfs;
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+static void testRate()
+{
+  TokenBucket bucket(2000, 2000, 0, 0.01);
+  auto start = std::chrono::steady_clock::now();
+
+  for (int i = 0; i < 400; ++i) bucket.take(1);
+
+  double seconds = secondsSince(start);
+  CHECK(seconds >= 0.18);
+  CHECK(seconds < 0.6);
+}
+
+static void testLargeTake()
+{
+  TokenBucket bucket(5000, 5000, 0, 0.01);
+  auto start = std::chrono::steady_clock::now();
+
+  bucket.take(500);   //more than the bucket holds, waits for the debt
+
+  double seconds = secondsSince(start);
+  CHECK(seconds >= 0.09);
+  CHECK(seconds < 0.5);
+}
+
+static void testBurst()
+{
+  TokenBucket bucket(1000, 1000, 0, 0.01);
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  auto start = std::chrono::steady_clock::now();
+
+  // only 10 of the 200 tokens of the pause were saved
+  for (int i = 0; i < 60; ++i) bucket.take(1);
+
+  CHECK(secondsSince(start) >= 0.04);
+}
+
+static void testRamp()
+{
+  TokenBucket bucket(1000, 3000, 0.05, 0.01);
+
+  CHECK(bucket.rate() >= 1000);
+  CHECK(bucket.rate() < 3000);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  CHECK_EQ(bucket.rate(), 3000);
+}
+
+int main()
+{
+  testRate();
+  testLargeTake();
+  testBurst();
+  testRamp();
+
+  return failures();
+}